@@ -0,0 +1,695 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dlfcn.h>
+
+// Ahead-of-time backend: the program becomes one C translation unit, the
+// system compiler builds it into a shared object and dlopen loads it.
+//
+// Each node function compiles to a static C function taking int32_t
+// parameters, so calls inside the module are plain C calls the compiler can
+// inline and turn into loops. The module exports a fixed ABI:
+//
+//   uint32_t        uns_abi_version;
+//   size_t          uns_function_count;
+//   UnsNativeEntry  uns_functions[];      name, arity, entry point
+//   int32_t         uns_main(void);       top-level statements
+//
+// Every entry point has the signature int32_t (*)(const int32_t* args), so
+// the host calls any function without knowing its arity at compile time.
+// Arithmetic wraps like the bytecode VM, INT32_MIN / -1 included; division
+// by zero aborts with the same message. UNS names may contain characters C
+// identifiers can't ($Node), so they are mangled: letters and digits are
+// kept, '_' becomes "__" and anything else "_xx" in hex. C leaves operand
+// order unspecified, so when more than one operand of a call or operator
+// contains a call (or any argument of print does), the operands are first
+// assigned to temporaries in a comma expression, which runs left to right
+// as the interpreter does.
+//
+// aot_run_program builds in a fresh mkdtemp directory that only this user
+// can enter, so nobody can plant a symlink at the source path or swap the
+// library between the compiler and dlopen; the directory is removed once
+// the library is loaded.
+#define UNS_AOT_ABI_VERSION 1
+#define MAX_AOT_FUNCTIONS 1024
+#define AOT_NO_TEMPORARIES ((size_t)-1)
+
+typedef int32_t (*UnsNativeFunction)(const int32_t* args);
+
+typedef struct {
+    const char* name;
+    uint32_t arg_count;
+    UnsNativeFunction entry;
+} UnsNativeEntry;
+
+typedef struct {
+    void* handle;
+    const UnsNativeEntry* functions;
+    size_t function_count;
+    int32_t (*main)(void);
+} AotModule;
+
+typedef struct {
+    ASTNode* definitions[MAX_AOT_FUNCTIONS];
+    size_t count;
+} AotFunctionList;
+
+typedef struct {
+    char** names;
+    size_t count;
+    size_t capacity;
+} AotLocals;
+
+AotModule* loaded_aot_module = NULL;
+size_t aot_temporary_count = 0;   // Temporaries used so far by the function being emitted
+const char* aot_load_error = NULL;
+
+// The prelude is part of the generated source so the .so has no link-time
+// dependency on the interpreter.
+const char* aot_prelude =
+    "#include <stdint.h>\n"
+    "#include <stddef.h>\n"
+    "#include <stdio.h>\n"
+    "#include <stdlib.h>\n"
+    "\n"
+    "typedef int32_t (*UnsNativeFunction)(const int32_t* args);\n"
+    "typedef struct { const char* name; uint32_t arg_count; UnsNativeFunction entry; } UnsNativeEntry;\n"
+    "\n"
+    "#define UNS_ADD(a, b) ((int32_t)((uint32_t)(a) + (uint32_t)(b)))\n"
+    "#define UNS_SUB(a, b) ((int32_t)((uint32_t)(a) - (uint32_t)(b)))\n"
+    "#define UNS_MUL(a, b) ((int32_t)((uint32_t)(a) * (uint32_t)(b)))\n"
+    "\n"
+    "static int32_t uns_div(int32_t a, int32_t b, const char* function) {\n"
+    "    if (b == 0) {\n"
+    "        fflush(stdout);\n"
+    "        fprintf(stderr, \"Runtime error: division by zero in %s\\n\", function);\n"
+    "        exit(EXIT_FAILURE);\n"
+    "    }\n"
+    "    if (b == -1) return (int32_t)(0u - (uint32_t)a);\n"
+    "    return a / b;\n"
+    "}\n"
+    "\n";
+
+void collect_aot_functions(ASTNode* node, AotFunctionList* list) {
+    if (!node) return;
+
+    switch (node->type) {
+        case NODE_FUNCTION_DEF:
+            for (size_t i = 0; i < list->count; i++) {
+                if (strcmp(list->definitions[i]->function_def.function_name, node->function_def.function_name) == 0) {
+                    fprintf(stderr, "Function '%s' is defined twice; the AOT backend needs one static definition!\n", node->function_def.function_name);
+                    exit(EXIT_FAILURE);
+                }
+            }
+            if (list->count >= MAX_AOT_FUNCTIONS) {
+                fprintf(stderr, "Too many functions for the AOT backend!\n");
+                exit(EXIT_FAILURE);
+            }
+            list->definitions[list->count++] = node;
+            collect_aot_functions(node->function_def.body, list);
+            break;
+        case NODE_IF:
+            collect_aot_functions(node->if_node.then_branch, list);
+            collect_aot_functions(node->if_node.else_branch, list);
+            break;
+        case NODE_WHILE:
+            collect_aot_functions(node->while_node.body, list);
+            break;
+        case NODE_BLOCK:
+            for (size_t i = 0; i < node->block.size; i++) {
+                collect_aot_functions(node->block.statements[i], list);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+ASTNode* find_aot_function(AotFunctionList* list, const char* name) {
+    for (size_t i = 0; i < list->count; i++) {
+        if (strcmp(list->definitions[i]->function_def.function_name, name) == 0) return list->definitions[i];
+    }
+    return NULL;
+}
+
+void add_aot_local(AotLocals* locals, const char* name) {
+    for (size_t i = 0; i < locals->count; i++) {
+        if (strcmp(locals->names[i], name) == 0) return;
+    }
+    if (locals->count == locals->capacity) {
+        locals->capacity = locals->capacity ? locals->capacity * 2 : 16;
+        locals->names = realloc(locals->names, sizeof(char*) * locals->capacity);
+    }
+    locals->names[locals->count++] = (char*)name;
+}
+
+// Every name read or written in the body is a frame local, as in the bytecode emitter
+void collect_aot_locals(ASTNode* node, AotLocals* locals) {
+    if (!node) return;
+
+    switch (node->type) {
+        case NODE_IDENTIFIER:
+            add_aot_local(locals, node->identifier);
+            break;
+        case NODE_ASSIGNMENT:
+            add_aot_local(locals, node->assignment.identifier);
+            collect_aot_locals(node->assignment.value, locals);
+            break;
+        case NODE_BINARY_EXPR:
+            collect_aot_locals(node->binary.left, locals);
+            collect_aot_locals(node->binary.right, locals);
+            break;
+        case NODE_IF:
+            collect_aot_locals(node->if_node.condition, locals);
+            collect_aot_locals(node->if_node.then_branch, locals);
+            collect_aot_locals(node->if_node.else_branch, locals);
+            break;
+        case NODE_WHILE:
+            collect_aot_locals(node->while_node.condition, locals);
+            collect_aot_locals(node->while_node.body, locals);
+            break;
+        case NODE_RETURN:
+            collect_aot_locals(node->return_node.value, locals);
+            break;
+        case NODE_BLOCK:
+            for (size_t i = 0; i < node->block.size; i++) {
+                collect_aot_locals(node->block.statements[i], locals);
+            }
+            break;
+        case NODE_FUNCTION_CALL:
+        case NODE_TAIL_CALL:
+            for (size_t i = 0; i < node->function_call.arg_count; i++) {
+                collect_aot_locals(node->function_call.arguments[i], locals);
+            }
+            break;
+        default:
+            break; // Nested definitions have their own frame
+    }
+}
+
+// A C identifier for an UNS name (see the header)
+void emit_c_name(FILE* out, const char* prefix, const char* name) {
+    fprintf(out, "%s", prefix);
+    for (const unsigned char* c = (const unsigned char*)name; *c; c++) {
+        if ((*c >= 'a' && *c <= 'z') || (*c >= 'A' && *c <= 'Z') || (*c >= '0' && *c <= '9')) fputc(*c, out);
+        else if (*c == '_') fprintf(out, "__");
+        else fprintf(out, "_%02x", *c);
+    }
+}
+
+void emit_c_string(FILE* out, const char* text) {
+    fputc('"', out);
+    for (const unsigned char* c = (const unsigned char*)text; *c; c++) {
+        if (*c == '"' || *c == '\\') fprintf(out, "\\%c", *c);
+        else if (*c < 0x20 || *c >= 0x7F) fprintf(out, "\\%03o", *c);
+        else fputc(*c, out);
+    }
+    fputc('"', out);
+}
+
+// Only calls have side effects (output); a callee can't see the caller's locals
+int aot_contains_call(ASTNode* node) {
+    if (!node) return 0;
+    switch (node->type) {
+        case NODE_BINARY_EXPR:
+            return aot_contains_call(node->binary.left) || aot_contains_call(node->binary.right);
+        case NODE_FUNCTION_CALL:
+        case NODE_TAIL_CALL:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+// print writes its arguments one by one, so any call among them must run
+// before the first write, as it does in the stack code
+int aot_operands_need_order(ASTNode** operands, size_t count, int is_print) {
+    size_t calls = 0;
+    for (size_t i = 0; i < count; i++) calls += aot_contains_call(operands[i]);
+    return calls > (is_print ? 0 : 1);
+}
+
+// Temporaries the function body will use, so they can be declared up front
+size_t count_aot_temporaries(ASTNode* node) {
+    if (!node) return 0;
+
+    size_t count = 0;
+    switch (node->type) {
+        case NODE_ASSIGNMENT:
+            return count_aot_temporaries(node->assignment.value);
+        case NODE_BINARY_EXPR: {
+            ASTNode* operands[2] = { node->binary.left, node->binary.right };
+            if (aot_operands_need_order(operands, 2, 0)) count += 2;
+            return count + count_aot_temporaries(node->binary.left) + count_aot_temporaries(node->binary.right);
+        }
+        case NODE_IF:
+            return count_aot_temporaries(node->if_node.condition) + count_aot_temporaries(node->if_node.then_branch) +
+                   count_aot_temporaries(node->if_node.else_branch);
+        case NODE_WHILE:
+            return count_aot_temporaries(node->while_node.condition) + count_aot_temporaries(node->while_node.body);
+        case NODE_RETURN:
+            return count_aot_temporaries(node->return_node.value);
+        case NODE_BLOCK:
+            for (size_t i = 0; i < node->block.size; i++) count += count_aot_temporaries(node->block.statements[i]);
+            return count;
+        case NODE_FUNCTION_CALL:
+        case NODE_TAIL_CALL:
+            if (aot_operands_need_order(node->function_call.arguments, node->function_call.arg_count,
+                                        strcmp(node->function_call.function_name, "print") == 0)) {
+                count += node->function_call.arg_count;
+            }
+            for (size_t i = 0; i < node->function_call.arg_count; i++) count += count_aot_temporaries(node->function_call.arguments[i]);
+            return count;
+        default:
+            return 0; // Nested definitions have their own frame
+    }
+}
+
+void emit_c_expression(FILE* out, AotFunctionList* list, const char* function_name, ASTNode* node);
+
+// Open "(t0 = a, t1 = b, " when the operands need ordering and return the
+// first temporary; otherwise emit nothing and return AOT_NO_TEMPORARIES
+size_t emit_c_hoisted_operands(FILE* out, AotFunctionList* list, const char* function_name, ASTNode** operands, size_t count, int is_print) {
+    if (!aot_operands_need_order(operands, count, is_print)) return AOT_NO_TEMPORARIES;
+
+    size_t first = aot_temporary_count;
+    aot_temporary_count += count;
+    fprintf(out, "(");
+    for (size_t i = 0; i < count; i++) {
+        fprintf(out, "t%zu = ", first + i);
+        emit_c_expression(out, list, function_name, operands[i]);
+        fprintf(out, ", ");
+    }
+    return first;
+}
+
+void emit_c_operand(FILE* out, AotFunctionList* list, const char* function_name, ASTNode* operand, size_t temporary) {
+    if (temporary == AOT_NO_TEMPORARIES) emit_c_expression(out, list, function_name, operand);
+    else fprintf(out, "t%zu", temporary);
+}
+
+void emit_c_expression(FILE* out, AotFunctionList* list, const char* function_name, ASTNode* node) {
+    switch (node->type) {
+        case NODE_NUMBER:
+            fprintf(out, "%d", (int32_t)atoi(node->number_value));
+            break;
+        case NODE_IDENTIFIER:
+            emit_c_name(out, "v_", node->identifier);
+            break;
+        case NODE_BINARY_EXPR: {
+            const char* macro = NULL;
+            switch (node->binary.op) {
+                case '+': macro = "UNS_ADD"; break;
+                case '-': macro = "UNS_SUB"; break;
+                case '*': macro = "UNS_MUL"; break;
+                case '/': macro = "uns_div"; break;
+                case '<':
+                case '>': break;
+                default:
+                    fprintf(stderr, "Unknown operator '%c'!\n", node->binary.op);
+                    exit(EXIT_FAILURE);
+            }
+            ASTNode* operands[2] = { node->binary.left, node->binary.right };
+            size_t first = emit_c_hoisted_operands(out, list, function_name, operands, 2, 0);
+            size_t second = first == AOT_NO_TEMPORARIES ? first : first + 1;
+            if (macro) {
+                fprintf(out, "%s(", macro);
+                emit_c_operand(out, list, function_name, operands[0], first);
+                fprintf(out, ", ");
+                emit_c_operand(out, list, function_name, operands[1], second);
+                if (node->binary.op == '/') {
+                    fprintf(out, ", ");
+                    emit_c_string(out, function_name);
+                }
+                fprintf(out, ")");
+            } else {
+                fprintf(out, "(");
+                emit_c_operand(out, list, function_name, operands[0], first);
+                fprintf(out, " %c ", node->binary.op);
+                emit_c_operand(out, list, function_name, operands[1], second);
+                fprintf(out, ")");
+            }
+            if (first != AOT_NO_TEMPORARIES) fprintf(out, ")");
+            break;
+        }
+        case NODE_FUNCTION_CALL:
+        case NODE_TAIL_CALL: {
+            const char* name = node->function_call.function_name;
+            if (strcmp(name, "print") == 0) {
+                // print is an expression worth 0, like in the stack code
+                size_t first = emit_c_hoisted_operands(out, list, function_name, node->function_call.arguments, node->function_call.arg_count, 1);
+                fprintf(out, "(");
+                for (size_t i = 0; i < node->function_call.arg_count; i++) {
+                    fprintf(out, "printf(\"%%d \", ");
+                    emit_c_operand(out, list, function_name, node->function_call.arguments[i], first == AOT_NO_TEMPORARIES ? first : first + i);
+                    fprintf(out, "), ");
+                }
+                fprintf(out, "printf(\"\\n\"), 0)");
+                if (first != AOT_NO_TEMPORARIES) fprintf(out, ")");
+                break;
+            }
+
+            ASTNode* callee = find_aot_function(list, name);
+            if (!callee) {
+                fprintf(stderr, "Undefined function '%s'\n", name);
+                exit(EXIT_FAILURE);
+            }
+            if (callee->function_def.arg_count != node->function_call.arg_count) {
+                fprintf(stderr, "Function '%s' expected %zu arguments but got %zu\n", name, callee->function_def.arg_count, node->function_call.arg_count);
+                exit(EXIT_FAILURE);
+            }
+            size_t first = emit_c_hoisted_operands(out, list, function_name, node->function_call.arguments, node->function_call.arg_count, 0);
+            emit_c_name(out, "f_", name);
+            fprintf(out, "(");
+            for (size_t i = 0; i < node->function_call.arg_count; i++) {
+                if (i > 0) fprintf(out, ", ");
+                emit_c_operand(out, list, function_name, node->function_call.arguments[i], first == AOT_NO_TEMPORARIES ? first : first + i);
+            }
+            fprintf(out, ")");
+            if (first != AOT_NO_TEMPORARIES) fprintf(out, ")");
+            break;
+        }
+        default:
+            fprintf(stderr, "Unsupported expression in AOT backend!\n");
+            exit(EXIT_FAILURE);
+    }
+}
+
+void emit_c_statement(FILE* out, AotFunctionList* list, const char* function_name, ASTNode* node, int depth) {
+    if (!node) return;
+
+    switch (node->type) {
+        case NODE_FUNCTION_DEF:
+            break; // Hoisted to file scope
+        case NODE_ASSIGNMENT:
+            fprintf(out, "%*s", depth * 4, "");
+            emit_c_name(out, "v_", node->assignment.identifier);
+            fprintf(out, " = ");
+            emit_c_expression(out, list, function_name, node->assignment.value);
+            fprintf(out, ";\n");
+            break;
+        case NODE_IF:
+            fprintf(out, "%*sif (", depth * 4, "");
+            emit_c_expression(out, list, function_name, node->if_node.condition);
+            fprintf(out, ") {\n");
+            emit_c_statement(out, list, function_name, node->if_node.then_branch, depth + 1);
+            if (node->if_node.else_branch) {
+                fprintf(out, "%*s} else {\n", depth * 4, "");
+                emit_c_statement(out, list, function_name, node->if_node.else_branch, depth + 1);
+            }
+            fprintf(out, "%*s}\n", depth * 4, "");
+            break;
+        case NODE_WHILE:
+            fprintf(out, "%*swhile (", depth * 4, "");
+            emit_c_expression(out, list, function_name, node->while_node.condition);
+            fprintf(out, ") {\n");
+            emit_c_statement(out, list, function_name, node->while_node.body, depth + 1);
+            fprintf(out, "%*s}\n", depth * 4, "");
+            break;
+        case NODE_RETURN:
+            fprintf(out, "%*sreturn ", depth * 4, "");
+            if (node->return_node.value) {
+                emit_c_expression(out, list, function_name, node->return_node.value);
+            } else {
+                fprintf(out, "0");
+            }
+            fprintf(out, ";\n");
+            break;
+        case NODE_BLOCK:
+            for (size_t i = 0; i < node->block.size; i++) {
+                emit_c_statement(out, list, function_name, node->block.statements[i], depth);
+            }
+            break;
+        default:
+            fprintf(out, "%*s(void)", depth * 4, "");
+            emit_c_expression(out, list, function_name, node);
+            fprintf(out, ";\n");
+            break;
+    }
+}
+
+// Locals that are not parameters start at zero; so do the temporaries
+void emit_c_locals(FILE* out, ASTNode* body, ASTNode* def) {
+    AotLocals locals = { NULL, 0, 0 };
+    collect_aot_locals(body, &locals);
+    for (size_t i = 0; i < locals.count; i++) {
+        int is_parameter = 0;
+        for (size_t p = 0; def && p < def->function_def.arg_count; p++) {
+            if (strcmp(def->function_def.parameters[p], locals.names[i]) == 0) is_parameter = 1;
+        }
+        if (is_parameter) continue;
+        fprintf(out, "    int32_t ");
+        emit_c_name(out, "v_", locals.names[i]);
+        fprintf(out, " = 0;\n");
+    }
+    free(locals.names);
+
+    size_t temporaries = count_aot_temporaries(body);
+    for (size_t i = 0; i < temporaries; i++) fprintf(out, "    int32_t t%zu = 0;\n", i);
+    aot_temporary_count = 0;
+}
+
+void emit_c_signature(FILE* out, ASTNode* def) {
+    fprintf(out, "static int32_t ");
+    emit_c_name(out, "f_", def->function_def.function_name);
+    fprintf(out, "(");
+    if (def->function_def.arg_count == 0) fprintf(out, "void");
+    for (size_t i = 0; i < def->function_def.arg_count; i++) {
+        if (i > 0) fprintf(out, ", ");
+        emit_c_name(out, "int32_t v_", def->function_def.parameters[i]);
+    }
+    fprintf(out, ")");
+}
+
+// Write the whole module as a C translation unit
+void generate_c_module(FILE* out, ASTNode* root) {
+    AotFunctionList list = { .count = 0 };
+    collect_aot_functions(root, &list);
+
+    fprintf(out, "%s", aot_prelude);
+    for (size_t i = 0; i < list.count; i++) {
+        emit_c_signature(out, list.definitions[i]);
+        fprintf(out, ";\n");
+    }
+    fprintf(out, "\n");
+
+    for (size_t i = 0; i < list.count; i++) {
+        ASTNode* def = list.definitions[i];
+        emit_c_signature(out, def);
+        fprintf(out, " {\n");
+        emit_c_locals(out, def->function_def.body, def);
+        emit_c_statement(out, &list, def->function_def.function_name, def->function_def.body, 1);
+        fprintf(out, "    return 0;\n}\n\n");
+    }
+
+    // Uniform entry points for the host
+    for (size_t i = 0; i < list.count; i++) {
+        ASTNode* def = list.definitions[i];
+        emit_c_name(out, "static int32_t entry_", def->function_def.function_name);
+        fprintf(out, "(const int32_t* args) {\n    (void)args;\n    return ");
+        emit_c_name(out, "f_", def->function_def.function_name);
+        fprintf(out, "(");
+        for (size_t a = 0; a < def->function_def.arg_count; a++) {
+            fprintf(out, "%sargs[%zu]", a > 0 ? ", " : "", a);
+        }
+        fprintf(out, ");\n}\n\n");
+    }
+
+    fprintf(out, "const uint32_t uns_abi_version = %d;\n", UNS_AOT_ABI_VERSION);
+    fprintf(out, "const size_t uns_function_count = %zu;\n", list.count);
+    fprintf(out, "const UnsNativeEntry uns_functions[] = {\n");
+    for (size_t i = 0; i < list.count; i++) {
+        ASTNode* def = list.definitions[i];
+        fprintf(out, "    { ");
+        emit_c_string(out, def->function_def.function_name);
+        fprintf(out, ", %zu, ", def->function_def.arg_count);
+        emit_c_name(out, "entry_", def->function_def.function_name);
+        fprintf(out, " },\n");
+    }
+    fprintf(out, "    { NULL, 0, NULL }\n};\n\n");
+
+    fprintf(out, "int32_t uns_main(void) {\n");
+    emit_c_locals(out, root, NULL);
+    emit_c_statement(out, &list, "<main>", root, 1);
+    fprintf(out, "    return 0;\n}\n");
+}
+
+AotModule* aot_load_module(const char* library_path);
+
+// Append text to a shell command as one single-quoted word; an embedded
+// quote becomes '\''
+void append_shell_word(char* command, size_t size, const char* text) {
+    size_t length = strlen(command);
+    int fits = length + 2 < size;
+    if (fits) command[length++] = '\'';
+    for (const char* c = text; fits && *c; c++) {
+        const char* piece = *c == '\'' ? "'\\''" : NULL;
+        size_t piece_length = piece ? 4 : 1;
+        fits = length + piece_length + 1 < size;
+        if (!fits) break;
+        if (piece) memcpy(command + length, piece, 4);
+        else command[length] = *c;
+        length += piece_length;
+    }
+    if (!fits) {
+        fprintf(stderr, "Compiler command too long for %s\n", text);
+        exit(EXIT_FAILURE);
+    }
+    command[length++] = '\'';
+    command[length] = '\0';
+}
+
+// Generate, compile and load. CC overrides the compiler. output_path must be
+// in a directory only this user can write (a mkdtemp directory or the
+// compile cache). The generated .c is removed once compiled; the .so stays
+// at output_path.so, since a loaded library may be kept (see Compilation
+// Cache.c), and the caller unlinks it when done.
+AotModule* aot_compile_module(ASTNode* root, const char* output_path) {
+    char source_path[1024];
+    char library_path[1024];
+    char command[4096];
+    snprintf(source_path, sizeof(source_path), "%s.c", output_path);
+    snprintf(library_path, sizeof(library_path), "%s.so", output_path);
+
+    unlink(source_path); // Left over from a crashed run; never write through it
+    int fd = open(source_path, O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW, 0600);
+    FILE* out = fd >= 0 ? fdopen(fd, "w") : NULL;
+    if (!out) {
+        fprintf(stderr, "Failed to open %s for writing\n", source_path);
+        exit(EXIT_FAILURE);
+    }
+    generate_c_module(out, root);
+    fclose(out);
+
+    const char* compiler = getenv("CC");
+    snprintf(command, sizeof(command), "%s -O2 -shared -fPIC -o ", compiler ? compiler : "cc");
+    append_shell_word(command, sizeof(command), library_path);
+    strncat(command, " ", sizeof(command) - strlen(command) - 1);
+    append_shell_word(command, sizeof(command), source_path);
+    int status = system(command);
+    unlink(source_path);
+    if (status != 0) {
+        unlink(library_path);
+        fprintf(stderr, "C compiler failed: %s\n", command);
+        exit(EXIT_FAILURE);
+    }
+
+    return aot_load_module(library_path);
+}
+
+// NULL if the library is missing or not a compatible module; the reason is
+// left in aot_load_error
+AotModule* aot_try_load_module(const char* library_path) {
+    void* handle = dlopen(library_path, RTLD_NOW | RTLD_LOCAL);
+    if (!handle) {
+        aot_load_error = dlerror();
+        return NULL;
+    }
+
+    const uint32_t* version = dlsym(handle, "uns_abi_version");
+    const size_t* count = dlsym(handle, "uns_function_count");
+    const UnsNativeEntry* functions = dlsym(handle, "uns_functions");
+    void* main_symbol = dlsym(handle, "uns_main");
+    if (!version || !count || !functions || !main_symbol || *version != UNS_AOT_ABI_VERSION) {
+        aot_load_error = "not a compatible native module";
+        dlclose(handle);
+        return NULL;
+    }
+
+    AotModule* module = (AotModule*)malloc(sizeof(AotModule));
+    module->handle = handle;
+    module->functions = functions;
+    module->function_count = *count;
+    *(void**)&module->main = main_symbol; // dlsym returns data pointers; POSIX guarantees this cast
+    return module;
+}
+
+AotModule* aot_load_module(const char* library_path) {
+    AotModule* module = aot_try_load_module(library_path);
+    if (!module) {
+        fprintf(stderr, "Failed to load %s: %s\n", library_path, aot_load_error);
+        exit(EXIT_FAILURE);
+    }
+    return module;
+}
+
+void aot_unload_module(AotModule* module) {
+    if (loaded_aot_module == module) loaded_aot_module = NULL;
+    dlclose(module->handle);
+    free(module);
+}
+
+const UnsNativeEntry* find_native_function(AotModule* module, const char* name) {
+    if (!module) return NULL;
+    for (size_t i = 0; i < module->function_count; i++) {
+        if (strcmp(module->functions[i].name, name) == 0) return &module->functions[i];
+    }
+    return NULL;
+}
+
+// Modify function call execution to dispatch to native code when the loaded module has it
+int execute_function_call(RuntimeEnvironment* env, ASTNode* node) {
+    if (strcmp(node->function_call.function_name, "print") == 0) {
+        stdlib_print(env, node->function_call.arguments, node->function_call.arg_count);
+        return 0;
+    }
+
+    const UnsNativeEntry* native = find_native_function(loaded_aot_module, node->function_call.function_name);
+    if (native) {
+        if (native->arg_count != node->function_call.arg_count) {
+            fprintf(stderr, "Function '%s' expected %u arguments but got %zu\n", native->name, native->arg_count, node->function_call.arg_count);
+            exit(EXIT_FAILURE);
+        }
+        int32_t args[256];
+        for (size_t i = 0; i < node->function_call.arg_count && i < 256; i++) {
+            args[i] = evaluate_expression(env, node->function_call.arguments[i]);
+        }
+        return native->entry(args);
+    }
+
+    Function* function = resolve_call_site(node);
+    if (!function) {
+        fprintf(stderr, "Undefined function '%s'\n", node->function_call.function_name);
+        exit(EXIT_FAILURE);
+    }
+    return execute_function(env, function, node->function_call.arguments, node->function_call.arg_count);
+}
+
+// Compile the whole program natively and run it
+int aot_run_program(ASTNode* root) {
+    char directory[256];
+    const char* temp = getenv("TMPDIR");
+    snprintf(directory, sizeof(directory), "%s/uns_aot_XXXXXX", temp ? temp : "/tmp");
+    if (!mkdtemp(directory)) {
+        perror("Failed to create a build directory");
+        exit(EXIT_FAILURE);
+    }
+    char output_path[300];
+    snprintf(output_path, sizeof(output_path), "%s/module", directory);
+
+    loaded_aot_module = aot_compile_module(root, output_path);
+    char library_path[310];
+    snprintf(library_path, sizeof(library_path), "%s.so", output_path);
+    unlink(library_path); // The mapping outlives the file
+    rmdir(directory);
+    int result = loaded_aot_module->main();
+    fflush(stdout);
+    aot_unload_module(loaded_aot_module);
+    return result;
+}
+
+int main() {
+    const char* source_code =
+        "function sum(n, acc) { if (n < 1) { return acc; } return sum(n - 1, acc + n); }"
+        "i = 0; total = 0;"
+        "while (i < 100000000) { total = total + i * 2; i = i + 1; }"
+        "print(total, sum(100000, 0));";
+    Lexer* lexer = create_lexer(source_code);
+    Parser* parser = create_parser(lexer);
+
+    ASTNode* root = parse_block(parser);
+    return aot_run_program(root);
+}
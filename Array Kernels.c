@@ -0,0 +1,512 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#if defined(__x86_64__) // The SSE sum extracts 64-bit lanes, which 32-bit x86 can't
+#include <immintrin.h>
+#define KERNELS_X86 1
+#endif
+
+// Vectorized int32 array kernels, chosen at run time per CPU.
+//
+// Each operation has a portable scalar version, and on x86-64 also an
+// SSE4.1 and/or an AVX2 version. The SIMD versions are compiled with
+// target attributes, so no special compiler flags are needed.
+// init_array_kernels fills the 'kernels' table with the best version the
+// CPU supports, and callers always go through that table.
+//
+// Arithmetic wraps like the scalar interpreter does. Sums are accumulated in
+// 64 bits. Comparisons write bit masks, with bit i of word i / 64 set for
+// element i. Gather and scatter don't check bounds: every index must be
+// within the array.
+//
+// map() recognizes the element functions that have kernels (square, negate
+// and absolute) and runs the kernel instead of calling through the
+// pointer for every element.
+
+typedef void (*UnaryKernel)(const int32_t* a, int32_t* out, size_t n);
+typedef void (*BinaryKernel)(const int32_t* a, const int32_t* b, int32_t* out, size_t n);
+typedef void (*ScalarKernel)(const int32_t* a, int32_t scalar, int32_t* out, size_t n);
+typedef void (*CompareKernel)(const int32_t* a, const int32_t* b, uint64_t* mask, size_t n);
+
+typedef struct {
+    const char* level;          // "scalar", "sse4.1" or "avx2"
+    BinaryKernel add;
+    BinaryKernel sub;
+    BinaryKernel mul;
+    ScalarKernel add_scalar;
+    ScalarKernel mul_scalar;
+    UnaryKernel square;
+    UnaryKernel negate;
+    UnaryKernel abs;
+    UnaryKernel prefix_sum;     // Inclusive
+    int64_t (*sum)(const int32_t* a, size_t n);
+    int32_t (*min)(const int32_t* a, size_t n);
+    int32_t (*max)(const int32_t* a, size_t n);
+    CompareKernel less;
+    CompareKernel greater;
+    CompareKernel equal;
+    void (*gather)(const int32_t* source, const int32_t* indices, int32_t* out, size_t n);
+    void (*scatter)(const int32_t* source, const int32_t* indices, int32_t* destination, size_t n);
+} ArrayKernels;
+
+ArrayKernels kernels;
+
+// Scalar versions: the fallback, and the tail loop of the SIMD versions
+
+void scalar_add(const int32_t* a, const int32_t* b, int32_t* out, size_t n) {
+    for (size_t i = 0; i < n; i++) out[i] = (int32_t)((uint32_t)a[i] + (uint32_t)b[i]);
+}
+
+void scalar_sub(const int32_t* a, const int32_t* b, int32_t* out, size_t n) {
+    for (size_t i = 0; i < n; i++) out[i] = (int32_t)((uint32_t)a[i] - (uint32_t)b[i]);
+}
+
+void scalar_mul(const int32_t* a, const int32_t* b, int32_t* out, size_t n) {
+    for (size_t i = 0; i < n; i++) out[i] = (int32_t)((uint32_t)a[i] * (uint32_t)b[i]);
+}
+
+void scalar_add_scalar(const int32_t* a, int32_t scalar, int32_t* out, size_t n) {
+    for (size_t i = 0; i < n; i++) out[i] = (int32_t)((uint32_t)a[i] + (uint32_t)scalar);
+}
+
+void scalar_mul_scalar(const int32_t* a, int32_t scalar, int32_t* out, size_t n) {
+    for (size_t i = 0; i < n; i++) out[i] = (int32_t)((uint32_t)a[i] * (uint32_t)scalar);
+}
+
+void scalar_square(const int32_t* a, int32_t* out, size_t n) {
+    scalar_mul(a, a, out, n);
+}
+
+void scalar_negate(const int32_t* a, int32_t* out, size_t n) {
+    for (size_t i = 0; i < n; i++) out[i] = (int32_t)(0u - (uint32_t)a[i]);
+}
+
+void scalar_abs(const int32_t* a, int32_t* out, size_t n) {
+    for (size_t i = 0; i < n; i++) out[i] = a[i] < 0 ? (int32_t)(0u - (uint32_t)a[i]) : a[i];
+}
+
+void scalar_prefix_sum(const int32_t* a, int32_t* out, size_t n) {
+    uint32_t running = 0;
+    for (size_t i = 0; i < n; i++) {
+        running += (uint32_t)a[i];
+        out[i] = (int32_t)running;
+    }
+}
+
+int64_t scalar_sum(const int32_t* a, size_t n) {
+    int64_t total = 0;
+    for (size_t i = 0; i < n; i++) total += a[i];
+    return total;
+}
+
+int32_t scalar_min(const int32_t* a, size_t n) {
+    int32_t result = INT32_MAX;
+    for (size_t i = 0; i < n; i++) if (a[i] < result) result = a[i];
+    return result;
+}
+
+int32_t scalar_max(const int32_t* a, size_t n) {
+    int32_t result = INT32_MIN;
+    for (size_t i = 0; i < n; i++) if (a[i] > result) result = a[i];
+    return result;
+}
+
+// Mask words are always written whole; the bits past n are zero
+void clear_mask(uint64_t* mask, size_t n) {
+    memset(mask, 0, sizeof(uint64_t) * ((n + 63) / 64));
+}
+
+void scalar_less(const int32_t* a, const int32_t* b, uint64_t* mask, size_t n) {
+    clear_mask(mask, n);
+    for (size_t i = 0; i < n; i++) mask[i / 64] |= (uint64_t)(a[i] < b[i]) << (i % 64);
+}
+
+void scalar_greater(const int32_t* a, const int32_t* b, uint64_t* mask, size_t n) {
+    scalar_less(b, a, mask, n);
+}
+
+void scalar_equal(const int32_t* a, const int32_t* b, uint64_t* mask, size_t n) {
+    clear_mask(mask, n);
+    for (size_t i = 0; i < n; i++) mask[i / 64] |= (uint64_t)(a[i] == b[i]) << (i % 64);
+}
+
+void scalar_gather(const int32_t* source, const int32_t* indices, int32_t* out, size_t n) {
+    for (size_t i = 0; i < n; i++) out[i] = source[indices[i]];
+}
+
+void scalar_scatter(const int32_t* source, const int32_t* indices, int32_t* destination, size_t n) {
+    for (size_t i = 0; i < n; i++) destination[indices[i]] = source[i];
+}
+
+#ifdef KERNELS_X86
+
+// SSE4.1: 4 lanes
+
+__attribute__((target("sse4.1")))
+void sse_add(const int32_t* a, const int32_t* b, int32_t* out, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(a + i));
+        __m128i y = _mm_loadu_si128((const __m128i*)(b + i));
+        _mm_storeu_si128((__m128i*)(out + i), _mm_add_epi32(x, y));
+    }
+    scalar_add(a + i, b + i, out + i, n - i);
+}
+
+__attribute__((target("sse4.1")))
+void sse_sub(const int32_t* a, const int32_t* b, int32_t* out, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(a + i));
+        __m128i y = _mm_loadu_si128((const __m128i*)(b + i));
+        _mm_storeu_si128((__m128i*)(out + i), _mm_sub_epi32(x, y));
+    }
+    scalar_sub(a + i, b + i, out + i, n - i);
+}
+
+__attribute__((target("sse4.1")))
+void sse_mul(const int32_t* a, const int32_t* b, int32_t* out, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(a + i));
+        __m128i y = _mm_loadu_si128((const __m128i*)(b + i));
+        _mm_storeu_si128((__m128i*)(out + i), _mm_mullo_epi32(x, y));
+    }
+    scalar_mul(a + i, b + i, out + i, n - i);
+}
+
+__attribute__((target("sse4.1")))
+void sse_square(const int32_t* a, int32_t* out, size_t n) {
+    sse_mul(a, a, out, n);
+}
+
+__attribute__((target("sse4.1")))
+int64_t sse_sum(const int32_t* a, size_t n) {
+    __m128i low = _mm_setzero_si128(), high = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(a + i));
+        low = _mm_add_epi64(low, _mm_cvtepi32_epi64(x));
+        high = _mm_add_epi64(high, _mm_cvtepi32_epi64(_mm_srli_si128(x, 8)));
+    }
+    __m128i total = _mm_add_epi64(low, high);
+    return _mm_extract_epi64(total, 0) + _mm_extract_epi64(total, 1) + scalar_sum(a + i, n - i);
+}
+
+__attribute__((target("sse4.1")))
+int32_t sse_min(const int32_t* a, size_t n) {
+    __m128i best = _mm_set1_epi32(INT32_MAX);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) best = _mm_min_epi32(best, _mm_loadu_si128((const __m128i*)(a + i)));
+    best = _mm_min_epi32(best, _mm_shuffle_epi32(best, _MM_SHUFFLE(1, 0, 3, 2)));
+    best = _mm_min_epi32(best, _mm_shuffle_epi32(best, _MM_SHUFFLE(2, 3, 0, 1)));
+    int32_t result = _mm_cvtsi128_si32(best);
+    int32_t tail = scalar_min(a + i, n - i);
+    return tail < result ? tail : result;
+}
+
+__attribute__((target("sse4.1")))
+int32_t sse_max(const int32_t* a, size_t n) {
+    __m128i best = _mm_set1_epi32(INT32_MIN);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) best = _mm_max_epi32(best, _mm_loadu_si128((const __m128i*)(a + i)));
+    best = _mm_max_epi32(best, _mm_shuffle_epi32(best, _MM_SHUFFLE(1, 0, 3, 2)));
+    best = _mm_max_epi32(best, _mm_shuffle_epi32(best, _MM_SHUFFLE(2, 3, 0, 1)));
+    int32_t result = _mm_cvtsi128_si32(best);
+    int32_t tail = scalar_max(a + i, n - i);
+    return tail > result ? tail : result;
+}
+
+// AVX2: 8 lanes
+
+__attribute__((target("avx2")))
+void avx2_add(const int32_t* a, const int32_t* b, int32_t* out, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(a + i));
+        __m256i y = _mm256_loadu_si256((const __m256i*)(b + i));
+        _mm256_storeu_si256((__m256i*)(out + i), _mm256_add_epi32(x, y));
+    }
+    scalar_add(a + i, b + i, out + i, n - i);
+}
+
+__attribute__((target("avx2")))
+void avx2_sub(const int32_t* a, const int32_t* b, int32_t* out, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(a + i));
+        __m256i y = _mm256_loadu_si256((const __m256i*)(b + i));
+        _mm256_storeu_si256((__m256i*)(out + i), _mm256_sub_epi32(x, y));
+    }
+    scalar_sub(a + i, b + i, out + i, n - i);
+}
+
+__attribute__((target("avx2")))
+void avx2_mul(const int32_t* a, const int32_t* b, int32_t* out, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(a + i));
+        __m256i y = _mm256_loadu_si256((const __m256i*)(b + i));
+        _mm256_storeu_si256((__m256i*)(out + i), _mm256_mullo_epi32(x, y));
+    }
+    scalar_mul(a + i, b + i, out + i, n - i);
+}
+
+__attribute__((target("avx2")))
+void avx2_add_scalar(const int32_t* a, int32_t scalar, int32_t* out, size_t n) {
+    __m256i s = _mm256_set1_epi32(scalar);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_si256((__m256i*)(out + i), _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)(a + i)), s));
+    }
+    scalar_add_scalar(a + i, scalar, out + i, n - i);
+}
+
+__attribute__((target("avx2")))
+void avx2_mul_scalar(const int32_t* a, int32_t scalar, int32_t* out, size_t n) {
+    __m256i s = _mm256_set1_epi32(scalar);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_si256((__m256i*)(out + i), _mm256_mullo_epi32(_mm256_loadu_si256((const __m256i*)(a + i)), s));
+    }
+    scalar_mul_scalar(a + i, scalar, out + i, n - i);
+}
+
+__attribute__((target("avx2")))
+void avx2_square(const int32_t* a, int32_t* out, size_t n) {
+    avx2_mul(a, a, out, n);
+}
+
+__attribute__((target("avx2")))
+void avx2_negate(const int32_t* a, int32_t* out, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_si256((__m256i*)(out + i), _mm256_sub_epi32(_mm256_setzero_si256(), _mm256_loadu_si256((const __m256i*)(a + i))));
+    }
+    scalar_negate(a + i, out + i, n - i);
+}
+
+__attribute__((target("avx2")))
+void avx2_abs(const int32_t* a, int32_t* out, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_si256((__m256i*)(out + i), _mm256_abs_epi32(_mm256_loadu_si256((const __m256i*)(a + i))));
+    }
+    scalar_abs(a + i, out + i, n - i);
+}
+
+// In-register scan: log-step shifts within each 128-bit half, then carry the
+// low half's total into the high half and the previous block's total into both
+__attribute__((target("avx2")))
+void avx2_prefix_sum(const int32_t* a, int32_t* out, size_t n) {
+    __m256i running = _mm256_setzero_si256();
+    const __m256i third = _mm256_set1_epi32(3), last = _mm256_set1_epi32(7);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(a + i));
+        x = _mm256_add_epi32(x, _mm256_slli_si256(x, 4));
+        x = _mm256_add_epi32(x, _mm256_slli_si256(x, 8));
+        __m256i carry = _mm256_permutevar8x32_epi32(x, third);
+        x = _mm256_add_epi32(x, _mm256_blend_epi32(_mm256_setzero_si256(), carry, 0xF0));
+        x = _mm256_add_epi32(x, running);
+        _mm256_storeu_si256((__m256i*)(out + i), x);
+        running = _mm256_permutevar8x32_epi32(x, last);
+    }
+    uint32_t total = i ? (uint32_t)out[i - 1] : 0;
+    for (; i < n; i++) {
+        total += (uint32_t)a[i];
+        out[i] = (int32_t)total;
+    }
+}
+
+__attribute__((target("avx2")))
+int64_t avx2_sum(const int32_t* a, size_t n) {
+    __m256i low = _mm256_setzero_si256(), high = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(a + i));
+        low = _mm256_add_epi64(low, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(x)));
+        high = _mm256_add_epi64(high, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(x, 1)));
+    }
+    int64_t lanes[4];
+    _mm256_storeu_si256((__m256i*)lanes, _mm256_add_epi64(low, high));
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + scalar_sum(a + i, n - i);
+}
+
+__attribute__((target("avx2")))
+int32_t avx2_min(const int32_t* a, size_t n) {
+    __m256i best = _mm256_set1_epi32(INT32_MAX);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) best = _mm256_min_epi32(best, _mm256_loadu_si256((const __m256i*)(a + i)));
+    __m128i half = _mm_min_epi32(_mm256_castsi256_si128(best), _mm256_extracti128_si256(best, 1));
+    half = _mm_min_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+    half = _mm_min_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+    int32_t result = _mm_cvtsi128_si32(half);
+    int32_t tail = scalar_min(a + i, n - i);
+    return tail < result ? tail : result;
+}
+
+__attribute__((target("avx2")))
+int32_t avx2_max(const int32_t* a, size_t n) {
+    __m256i best = _mm256_set1_epi32(INT32_MIN);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) best = _mm256_max_epi32(best, _mm256_loadu_si256((const __m256i*)(a + i)));
+    __m128i half = _mm_max_epi32(_mm256_castsi256_si128(best), _mm256_extracti128_si256(best, 1));
+    half = _mm_max_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+    half = _mm_max_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+    int32_t result = _mm_cvtsi128_si32(half);
+    int32_t tail = scalar_max(a + i, n - i);
+    return tail > result ? tail : result;
+}
+
+// 8 compare bits per step; 8 steps fill one mask word
+__attribute__((target("avx2")))
+void avx2_compare(const int32_t* a, const int32_t* b, uint64_t* mask, size_t n, int equal) {
+    clear_mask(mask, n);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(a + i));
+        __m256i y = _mm256_loadu_si256((const __m256i*)(b + i));
+        __m256i result = equal ? _mm256_cmpeq_epi32(x, y) : _mm256_cmpgt_epi32(y, x);
+        uint64_t bits = (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(result));
+        mask[i / 64] |= bits << (i % 64);
+    }
+    for (; i < n; i++) mask[i / 64] |= (uint64_t)(equal ? a[i] == b[i] : a[i] < b[i]) << (i % 64);
+}
+
+__attribute__((target("avx2")))
+void avx2_less(const int32_t* a, const int32_t* b, uint64_t* mask, size_t n) {
+    avx2_compare(a, b, mask, n, 0);
+}
+
+__attribute__((target("avx2")))
+void avx2_greater(const int32_t* a, const int32_t* b, uint64_t* mask, size_t n) {
+    avx2_compare(b, a, mask, n, 0);
+}
+
+__attribute__((target("avx2")))
+void avx2_equal(const int32_t* a, const int32_t* b, uint64_t* mask, size_t n) {
+    avx2_compare(a, b, mask, n, 1);
+}
+
+__attribute__((target("avx2")))
+void avx2_gather(const int32_t* source, const int32_t* indices, int32_t* out, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i index = _mm256_loadu_si256((const __m256i*)(indices + i));
+        _mm256_storeu_si256((__m256i*)(out + i), _mm256_i32gather_epi32((const int*)source, index, 4));
+    }
+    scalar_gather(source, indices + i, out + i, n - i);
+}
+
+#endif
+
+void init_array_kernels() {
+    kernels = (ArrayKernels){
+        "scalar", scalar_add, scalar_sub, scalar_mul, scalar_add_scalar, scalar_mul_scalar,
+        scalar_square, scalar_negate, scalar_abs, scalar_prefix_sum, scalar_sum, scalar_min, scalar_max,
+        scalar_less, scalar_greater, scalar_equal, scalar_gather, scalar_scatter
+    };
+#ifdef KERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.1")) {
+        kernels.level = "sse4.1";
+        kernels.add = sse_add;
+        kernels.sub = sse_sub;
+        kernels.mul = sse_mul;
+        kernels.square = sse_square;
+        kernels.sum = sse_sum;
+        kernels.min = sse_min;
+        kernels.max = sse_max;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        kernels.level = "avx2";
+        kernels.add = avx2_add;
+        kernels.sub = avx2_sub;
+        kernels.mul = avx2_mul;
+        kernels.add_scalar = avx2_add_scalar;
+        kernels.mul_scalar = avx2_mul_scalar;
+        kernels.square = avx2_square;
+        kernels.negate = avx2_negate;
+        kernels.abs = avx2_abs;
+        kernels.prefix_sum = avx2_prefix_sum;
+        kernels.sum = avx2_sum;
+        kernels.min = avx2_min;
+        kernels.max = avx2_max;
+        kernels.less = avx2_less;
+        kernels.greater = avx2_greater;
+        kernels.equal = avx2_equal;
+        kernels.gather = avx2_gather;
+        // No AVX2 scatter instruction; the scalar loop stays
+    }
+#endif
+}
+
+double kernel_mean(const int32_t* a, size_t n) {
+    return n ? (double)kernels.sum(a, n) / (double)n : 0.0;
+}
+
+// Element functions wrap like their kernels, INT_MIN included
+int square(int x) {
+    return (int)((unsigned)x * (unsigned)x);
+}
+
+int negate(int x) {
+    return (int)(0u - (unsigned)x);
+}
+
+int absolute(int x) {
+    return x < 0 ? (int)(0u - (unsigned)x) : x;
+}
+
+// Element functions map() can replace with a kernel
+UnaryKernel find_unary_kernel(int (*func)(int)) {
+    if (!kernels.level) init_array_kernels();
+    if (func == square) return kernels.square;
+    if (func == negate) return kernels.negate;
+    if (func == absolute) return kernels.abs;
+    return NULL;
+}
+
+// Modify map: known element functions run as vector kernels
+int* map(int* array, size_t size, int (*func)(int)) {
+    int* result = malloc(size * sizeof(int));  // Dynamically allocate memory for result array
+    UnaryKernel kernel = find_unary_kernel(func);
+    if (kernel) {
+        kernel(array, result, size);
+        return result;
+    }
+    for (size_t i = 0; i < size; i++) {
+        result[i] = func(array[i]);  // Apply the function to each element
+    }
+    return result;
+}
+
+int main() {
+    init_array_kernels();
+    printf("Kernels: %s\n", kernels.level);
+
+    size_t n = 1000003;
+    int32_t* values = malloc(sizeof(int32_t) * n);
+    for (size_t i = 0; i < n; i++) values[i] = (int32_t)(i % 2001) - 1000;
+
+    int* squared = map(values, n, square);
+    int32_t* scanned = malloc(sizeof(int32_t) * n);
+    kernels.prefix_sum(values, scanned, n);
+    uint64_t* negative = malloc(sizeof(uint64_t) * ((n + 63) / 64));
+    int32_t* zeros = calloc(n, sizeof(int32_t));
+    kernels.less(values, zeros, negative, n);
+
+    size_t negative_count = 0;
+    for (size_t w = 0; w < (n + 63) / 64; w++) negative_count += __builtin_popcountll(negative[w]);
+    printf("sum %lld, mean %.3f, min %d, max %d\n", (long long)kernels.sum(values, n), kernel_mean(values, n), kernels.min(values, n), kernels.max(values, n));
+    printf("sum of squares %lld, last prefix %d, negatives %zu\n", (long long)kernels.sum(squared, n), scanned[n - 1], negative_count);
+
+    free(values);
+    free(squared);
+    free(scanned);
+    free(negative);
+    free(zeros);
+    return 0;
+}
@@ -0,0 +1,515 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/mman.h>
+
+// Tiered execution: interpreter -> baseline JIT -> optimizing JIT.
+//
+// These are the three stages of Triangulated Compilation. Tier 0 interprets
+// register code, tier 1 runs templates over the same code and tier 2 runs
+// templates over the peephole-optimized register code (see Register
+// Bytecode.c). Every tier keeps its virtual registers in one frame array,
+// so a frame can move from the interpreter into machine code at any loop
+// header (on-stack replacement) without translating state.
+//
+// Functions move up a tier through per-function call counters. Back-edge
+// counters let a long loop in the interpreter jump into baseline code
+// mid-frame. Promotion to tier 2 happens at the next call. If code can't
+// be generated (a non-x86-64 host, mmap refused, an unknown instruction),
+// the function stays in the interpreter.
+#define TIER_BASELINE_CALLS 8
+#define TIER_BASELINE_LOOPS 1000
+#define TIER_OPTIMIZED_CALLS 1000
+#define TIER_MAX_DEPTH 20000
+#define TIER_STACK_SIZE (1024 * 1024)
+
+typedef enum {
+    TIER_INTERPRETER,
+    TIER_BASELINE,
+    TIER_OPTIMIZED
+} ExecutionTier;
+
+struct TieredRuntime;
+
+// registers: the frame; start: machine address of the first instruction to run
+typedef int32_t (*JitEntry)(int32_t* registers, struct TieredRuntime* runtime, const void* start);
+
+typedef struct {
+    uint8_t* memory;       // Executable mapping, NULL if not compiled
+    size_t size;
+    uint32_t* offsets;     // Machine-code offset of every register instruction
+} JitCode;
+
+typedef struct {
+    RegFunction baseline_code;    // One-to-one translation; the interpreter runs this too
+    RegFunction optimized_code;
+    JitCode baseline;
+    JitCode optimized;
+    ExecutionTier tier;
+    uint32_t call_count;
+    uint32_t loop_count;
+    int compile_failed;
+} TieredFunction;
+
+typedef struct TieredRuntime {
+    CodeModule* module;
+    TieredFunction* functions;
+    size_t function_count;
+    int32_t* stack;
+    int32_t* stack_end;
+    size_t depth;
+} TieredRuntime;
+
+int32_t tiered_invoke(TieredRuntime* runtime, uint32_t function_index, int32_t* registers);
+
+void tier_error(const char* message, const char* detail) {
+    fflush(stdout);
+    fprintf(stderr, "Runtime error: %s%s%s\n", message, detail ? " " : "", detail ? detail : "");
+    exit(EXIT_FAILURE);
+}
+
+// Entry points called from generated code
+
+int32_t jit_call_helper(TieredRuntime* runtime, int32_t* callee_registers, uint32_t function_index, uint32_t arg_count) {
+    TieredFunction* callee = &runtime->functions[function_index];
+    if (arg_count != callee->baseline_code.arg_count) tier_error("wrong number of arguments to", callee->baseline_code.name);
+    return tiered_invoke(runtime, function_index, callee_registers);
+}
+
+void jit_print_helper(TieredRuntime* runtime, int32_t* values, uint32_t count) {
+    (void)runtime;
+    for (uint32_t i = 0; i < count; i++) printf("%d ", values[i]);
+    printf("\n");
+}
+
+void jit_division_by_zero(TieredRuntime* runtime, uint32_t function_index) {
+    tier_error("division by zero in", runtime->functions[function_index].baseline_code.name);
+}
+
+void jit_undefined_function(TieredRuntime* runtime, uint32_t symbol) {
+    tier_error("undefined function", runtime->module->symbols[symbol]);
+}
+
+#if defined(__x86_64__)
+
+// x86-64 templates. rbx holds the frame, r12 the runtime; eax, ecx, edx and
+// the argument registers are scratch. Virtual register r lives at [rbx + 4r].
+
+void emit_u64(ByteBuffer* buffer, uint64_t value) {
+    emit_u32(buffer, (uint32_t)value);
+    emit_u32(buffer, (uint32_t)(value >> 32));
+}
+
+// mov eax/ecx, RK operand
+void x64_load_operand(ByteBuffer* code, const int32_t* constants, uint16_t operand, int to_ecx) {
+    if (RK_IS_CONSTANT(operand)) {
+        emit_u8(code, to_ecx ? 0xB9 : 0xB8);
+        emit_u32(code, (uint32_t)constants[operand & ~RK_CONSTANT]);
+    } else {
+        emit_u8(code, 0x8B);
+        emit_u8(code, to_ecx ? 0x8B : 0x83);
+        emit_u32(code, (uint32_t)operand * 4);
+    }
+}
+
+// mov [rbx + 4r], eax
+void x64_store_eax(ByteBuffer* code, uint32_t r) {
+    emit_u8(code, 0x89);
+    emit_u8(code, 0x83);
+    emit_u32(code, r * 4);
+}
+
+// mov rdi, r12 ; the runtime is every helper's first argument
+void x64_runtime_argument(ByteBuffer* code) {
+    emit_u8(code, 0x4C); emit_u8(code, 0x89); emit_u8(code, 0xE7);
+}
+
+// lea rsi, [rbx + 4r]
+void x64_frame_address_argument(ByteBuffer* code, uint32_t r) {
+    emit_u8(code, 0x48); emit_u8(code, 0x8D); emit_u8(code, 0xB3);
+    emit_u32(code, r * 4);
+}
+
+// mov rax, helper ; call rax
+void x64_call_helper(ByteBuffer* code, void* helper) {
+    emit_u8(code, 0x48); emit_u8(code, 0xB8);
+    emit_u64(code, (uint64_t)(uintptr_t)helper);
+    emit_u8(code, 0xFF); emit_u8(code, 0xD0);
+}
+
+void x64_epilogue(ByteBuffer* code) {
+    emit_u8(code, 0x41); emit_u8(code, 0x5D);   // pop r13
+    emit_u8(code, 0x41); emit_u8(code, 0x5C);   // pop r12
+    emit_u8(code, 0x5B);                        // pop rbx
+    emit_u8(code, 0xC3);                        // ret
+}
+
+// Emits a rel32 branch to a register instruction, patched once all offsets are known
+void x64_branch(ByteBuffer* code, ByteBuffer* patches, const uint8_t* opcode, size_t opcode_size, uint32_t target) {
+    for (size_t i = 0; i < opcode_size; i++) emit_u8(code, opcode[i]);
+    emit_u32(patches, (uint32_t)code->size);
+    emit_u32(patches, target);
+    emit_u32(code, 0);
+}
+
+int jit_compile_function(TieredRuntime* runtime, uint32_t function_index, RegFunction* function, JitCode* jit) {
+    const int32_t* constants = runtime->module->constants;
+    ByteBuffer code = { NULL, 0, 0 };
+    ByteBuffer patches = { NULL, 0, 0 };   // (operand offset, target instruction) pairs
+    uint32_t* offsets = malloc(sizeof(uint32_t) * (function->length + 1));
+    static const uint8_t jmp[] = { 0xE9 };
+    static const uint8_t jz[] = { 0x0F, 0x84 };
+    static const uint8_t jge[] = { 0x0F, 0x8D };
+    static const uint8_t jle[] = { 0x0F, 0x8E };
+
+    // Prologue: save callee-saved registers, keep rsp 16-byte aligned, enter at rdx
+    emit_u8(&code, 0x53);                                           // push rbx
+    emit_u8(&code, 0x41); emit_u8(&code, 0x54);                     // push r12
+    emit_u8(&code, 0x41); emit_u8(&code, 0x55);                     // push r13
+    emit_u8(&code, 0x48); emit_u8(&code, 0x89); emit_u8(&code, 0xFB); // mov rbx, rdi
+    emit_u8(&code, 0x49); emit_u8(&code, 0x89); emit_u8(&code, 0xF4); // mov r12, rsi
+    emit_u8(&code, 0xFF); emit_u8(&code, 0xE2);                     // jmp rdx
+
+    for (size_t i = 0; i < function->length; i++) {
+        RegInstruction* instruction = &function->code[i];
+        offsets[i] = (uint32_t)code.size;
+
+        switch (instruction->op) {
+            case R_MOVE:
+                x64_load_operand(&code, constants, instruction->b, 0);
+                x64_store_eax(&code, instruction->a);
+                break;
+            case R_ADD:
+            case R_SUB:
+            case R_MUL:
+                x64_load_operand(&code, constants, instruction->b, 0);
+                x64_load_operand(&code, constants, instruction->c, 1);
+                if (instruction->op == R_ADD) { emit_u8(&code, 0x01); emit_u8(&code, 0xC8); }                      // add eax, ecx
+                if (instruction->op == R_SUB) { emit_u8(&code, 0x29); emit_u8(&code, 0xC8); }                      // sub eax, ecx
+                if (instruction->op == R_MUL) { emit_u8(&code, 0x0F); emit_u8(&code, 0xAF); emit_u8(&code, 0xC1); } // imul eax, ecx
+                x64_store_eax(&code, instruction->a);
+                break;
+            case R_DIV:
+                x64_load_operand(&code, constants, instruction->b, 0);
+                x64_load_operand(&code, constants, instruction->c, 1);
+                emit_u8(&code, 0x85); emit_u8(&code, 0xC9);                 // test ecx, ecx
+                emit_u8(&code, 0x75); emit_u8(&code, 20);                   // jnz over the error call
+                x64_runtime_argument(&code);                                // 3 bytes
+                emit_u8(&code, 0xBE); emit_u32(&code, function_index);      // mov esi, imm32 (5 bytes)
+                x64_call_helper(&code, (void*)jit_division_by_zero);        // 12 bytes
+                // x / -1 is -x, and INT32_MIN / -1 wraps instead of raising #DE
+                emit_u8(&code, 0x83); emit_u8(&code, 0xF9); emit_u8(&code, 0xFF); // cmp ecx, -1
+                emit_u8(&code, 0x75); emit_u8(&code, 4);                    // jne to cdq
+                emit_u8(&code, 0xF7); emit_u8(&code, 0xD8);                 // neg eax
+                emit_u8(&code, 0xEB); emit_u8(&code, 3);                    // jmp over cdq, idiv
+                emit_u8(&code, 0x99);                                       // cdq
+                emit_u8(&code, 0xF7); emit_u8(&code, 0xF9);                 // idiv ecx
+                x64_store_eax(&code, instruction->a);
+                break;
+            case R_LT:
+            case R_GT:
+                x64_load_operand(&code, constants, instruction->b, 0);
+                x64_load_operand(&code, constants, instruction->c, 1);
+                emit_u8(&code, 0x39); emit_u8(&code, 0xC8);                 // cmp eax, ecx
+                emit_u8(&code, 0x0F); emit_u8(&code, instruction->op == R_LT ? 0x9C : 0x9F); emit_u8(&code, 0xC0); // setl/setg al
+                emit_u8(&code, 0x0F); emit_u8(&code, 0xB6); emit_u8(&code, 0xC0); // movzx eax, al
+                x64_store_eax(&code, instruction->a);
+                break;
+            case R_JUMP:
+                x64_branch(&code, &patches, jmp, sizeof(jmp), instruction->a);
+                break;
+            case R_JUMP_IF_FALSE:
+                x64_load_operand(&code, constants, instruction->b, 0);
+                emit_u8(&code, 0x85); emit_u8(&code, 0xC0);                 // test eax, eax
+                x64_branch(&code, &patches, jz, sizeof(jz), instruction->a);
+                break;
+            case R_JUMP_IF_NOT_LT:
+            case R_JUMP_IF_NOT_GT:
+                x64_load_operand(&code, constants, instruction->b, 0);
+                x64_load_operand(&code, constants, instruction->c, 1);
+                emit_u8(&code, 0x39); emit_u8(&code, 0xC8);                 // cmp eax, ecx
+                if (instruction->op == R_JUMP_IF_NOT_LT) {
+                    x64_branch(&code, &patches, jge, sizeof(jge), instruction->a);
+                } else {
+                    x64_branch(&code, &patches, jle, sizeof(jle), instruction->a);
+                }
+                break;
+            case R_CALL:
+            case R_TAIL_CALL:
+                if (instruction->op == R_TAIL_CALL && instruction->b == function_index) {
+                    // Self tail call: move the arguments down, clear the other locals, loop
+                    for (uint32_t a = 0; a < instruction->c; a++) {
+                        x64_load_operand(&code, constants, (uint16_t)(instruction->a + a), 0);
+                        x64_store_eax(&code, a);
+                    }
+                    for (uint32_t l = instruction->c; l < function->local_count; l++) {
+                        emit_u8(&code, 0xC7); emit_u8(&code, 0x83); emit_u32(&code, l * 4); emit_u32(&code, 0); // mov dword [rbx + 4l], 0
+                    }
+                    x64_branch(&code, &patches, jmp, sizeof(jmp), 0);
+                    break;
+                }
+                x64_runtime_argument(&code);
+                x64_frame_address_argument(&code, instruction->a);
+                emit_u8(&code, 0xBA); emit_u32(&code, instruction->b);      // mov edx, function index
+                emit_u8(&code, 0xB9); emit_u32(&code, instruction->c);      // mov ecx, argument count
+                x64_call_helper(&code, (void*)jit_call_helper);
+                if (instruction->op == R_TAIL_CALL) {
+                    x64_epilogue(&code);
+                } else {
+                    x64_store_eax(&code, instruction->a);
+                }
+                break;
+            case R_UNDEFINED:
+                x64_runtime_argument(&code);
+                emit_u8(&code, 0xBE); emit_u32(&code, instruction->b);      // mov esi, symbol
+                x64_call_helper(&code, (void*)jit_undefined_function);
+                break;
+            case R_PRINT:
+                x64_runtime_argument(&code);
+                x64_frame_address_argument(&code, instruction->a);
+                emit_u8(&code, 0xBA); emit_u32(&code, instruction->c);      // mov edx, count
+                x64_call_helper(&code, (void*)jit_print_helper);
+                break;
+            case R_RETURN:
+                x64_load_operand(&code, constants, instruction->b, 0);
+                x64_epilogue(&code);
+                break;
+            case R_HALT:
+                emit_u8(&code, 0x31); emit_u8(&code, 0xC0);                 // xor eax, eax
+                x64_epilogue(&code);
+                break;
+            default:
+                free(code.data);
+                free(patches.data);
+                free(offsets);
+                return 0; // Stays in the interpreter
+        }
+    }
+    offsets[function->length] = (uint32_t)code.size;
+
+    for (size_t p = 0; p < patches.size; p += 8) {
+        uint32_t at = read_u32(patches.data + p);
+        uint32_t target = read_u32(patches.data + p + 4);
+        patch_u32(&code, at, offsets[target] - (at + 4));
+    }
+
+    // Written while writable, then flipped to read+execute
+    size_t page = 4096;
+    size_t size = (code.size + page - 1) & ~(page - 1);
+    uint8_t* memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        free(code.data);
+        free(patches.data);
+        free(offsets);
+        return 0;
+    }
+    memcpy(memory, code.data, code.size);
+    if (mprotect(memory, size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(memory, size);
+        free(code.data);
+        free(patches.data);
+        free(offsets);
+        return 0;
+    }
+
+    jit->memory = memory;
+    jit->size = size;
+    jit->offsets = offsets;
+    free(code.data);
+    free(patches.data);
+    return 1;
+}
+
+#else
+
+int jit_compile_function(TieredRuntime* runtime, uint32_t function_index, RegFunction* function, JitCode* jit) {
+    (void)runtime; (void)function_index; (void)function; (void)jit;
+    return 0;
+}
+
+#endif
+
+void free_jit_code(JitCode* jit) {
+    if (jit->memory) munmap(jit->memory, jit->size);
+    free(jit->offsets);
+    jit->memory = NULL;
+    jit->offsets = NULL;
+}
+
+int32_t run_jit_code(TieredRuntime* runtime, JitCode* jit, int32_t* registers, size_t instruction) {
+    JitEntry entry = (JitEntry)(void*)jit->memory;
+    return entry(registers, runtime, jit->memory + jit->offsets[instruction]);
+}
+
+void try_promote(TieredRuntime* runtime, uint32_t function_index, ExecutionTier tier) {
+    TieredFunction* function = &runtime->functions[function_index];
+    if (function->compile_failed || function->tier >= tier) return;
+
+    if (tier == TIER_BASELINE) {
+        if (!jit_compile_function(runtime, function_index, &function->baseline_code, &function->baseline)) {
+            function->compile_failed = 1;
+            return;
+        }
+    } else {
+        if (!jit_compile_function(runtime, function_index, &function->optimized_code, &function->optimized)) {
+            function->compile_failed = 1;
+            return;
+        }
+    }
+    function->tier = tier;
+}
+
+#define TIER_RK(x) (RK_IS_CONSTANT(x) ? constants[(x) & ~RK_CONSTANT] : registers[(x)])
+
+// Tier 0: one frame of the unoptimized register code
+int32_t tiered_interpret(TieredRuntime* runtime, uint32_t function_index, int32_t* registers) {
+    TieredFunction* tiered = &runtime->functions[function_index];
+    RegFunction* function = &tiered->baseline_code;
+    const int32_t* constants = runtime->module->constants;
+    size_t pc = 0;
+
+    for (;;) {
+        RegInstruction* instruction = &function->code[pc];
+        switch (instruction->op) {
+            case R_MOVE: registers[instruction->a] = TIER_RK(instruction->b); pc++; break;
+            case R_ADD: registers[instruction->a] = (int32_t)((uint32_t)TIER_RK(instruction->b) + (uint32_t)TIER_RK(instruction->c)); pc++; break;
+            case R_SUB: registers[instruction->a] = (int32_t)((uint32_t)TIER_RK(instruction->b) - (uint32_t)TIER_RK(instruction->c)); pc++; break;
+            case R_MUL: registers[instruction->a] = (int32_t)((uint32_t)TIER_RK(instruction->b) * (uint32_t)TIER_RK(instruction->c)); pc++; break;
+            case R_DIV:
+                if (TIER_RK(instruction->c) == 0) jit_division_by_zero(runtime, function_index);
+                registers[instruction->a] = TIER_RK(instruction->c) == -1 ? (int32_t)(0u - (uint32_t)TIER_RK(instruction->b))
+                                                                          : TIER_RK(instruction->b) / TIER_RK(instruction->c);
+                pc++;
+                break;
+            case R_LT: registers[instruction->a] = TIER_RK(instruction->b) < TIER_RK(instruction->c); pc++; break;
+            case R_GT: registers[instruction->a] = TIER_RK(instruction->b) > TIER_RK(instruction->c); pc++; break;
+            case R_JUMP:
+                if (instruction->a <= pc && ++tiered->loop_count >= TIER_BASELINE_LOOPS) {
+                    // Hot loop: continue this frame in machine code from the loop header
+                    try_promote(runtime, function_index, TIER_BASELINE);
+                    if (tiered->tier == TIER_BASELINE) return run_jit_code(runtime, &tiered->baseline, registers, instruction->a);
+                }
+                pc = instruction->a;
+                break;
+            case R_JUMP_IF_FALSE: pc = TIER_RK(instruction->b) ? pc + 1 : instruction->a; break;
+            case R_JUMP_IF_NOT_LT: pc = TIER_RK(instruction->b) < TIER_RK(instruction->c) ? pc + 1 : instruction->a; break;
+            case R_JUMP_IF_NOT_GT: pc = TIER_RK(instruction->b) > TIER_RK(instruction->c) ? pc + 1 : instruction->a; break;
+            case R_CALL:
+                registers[instruction->a] = jit_call_helper(runtime, registers + instruction->a, instruction->b, instruction->c);
+                pc++;
+                break;
+            case R_TAIL_CALL:
+                if (instruction->b == function_index) {
+                    memmove(registers, registers + instruction->a, sizeof(int32_t) * instruction->c);
+                    memset(registers + instruction->c, 0, sizeof(int32_t) * (function->local_count - instruction->c));
+                    pc = 0;
+                    break;
+                }
+                return jit_call_helper(runtime, registers + instruction->a, instruction->b, instruction->c);
+            case R_UNDEFINED:
+                jit_undefined_function(runtime, instruction->b);
+                break;
+            case R_PRINT:
+                jit_print_helper(runtime, registers + instruction->a, instruction->c);
+                pc++;
+                break;
+            case R_RETURN:
+                return TIER_RK(instruction->b);
+            case R_HALT:
+                return 0;
+            default:
+                pc++;
+                break;
+        }
+    }
+}
+
+// Arguments are already in registers[0..arg_count); run at the best available tier
+int32_t tiered_invoke(TieredRuntime* runtime, uint32_t function_index, int32_t* registers) {
+    TieredFunction* function = &runtime->functions[function_index];
+    RegFunction* code = &function->baseline_code;
+
+    if (runtime->depth >= TIER_MAX_DEPTH) tier_error("call stack overflow in", code->name);
+    if (registers + code->register_count > runtime->stack_end) tier_error("register stack overflow in", code->name);
+    memset(registers + code->arg_count, 0, sizeof(int32_t) * (code->local_count - code->arg_count));
+
+    function->call_count++;
+    if (function->call_count >= TIER_OPTIMIZED_CALLS) {
+        try_promote(runtime, function_index, TIER_OPTIMIZED);
+    } else if (function->call_count >= TIER_BASELINE_CALLS) {
+        try_promote(runtime, function_index, TIER_BASELINE);
+    }
+
+    runtime->depth++;
+    int32_t result;
+    switch (function->tier) {
+        case TIER_OPTIMIZED: result = run_jit_code(runtime, &function->optimized, registers, 0); break;
+        case TIER_BASELINE: result = run_jit_code(runtime, &function->baseline, registers, 0); break;
+        default: result = tiered_interpret(runtime, function_index, registers); break;
+    }
+    runtime->depth--;
+    return result;
+}
+
+TieredRuntime* create_tiered_runtime(CodeModule* module) {
+    TieredRuntime* runtime = (TieredRuntime*)calloc(1, sizeof(TieredRuntime));
+    runtime->module = module;
+    runtime->function_count = module->function_count;
+    runtime->functions = calloc(module->function_count ? module->function_count : 1, sizeof(TieredFunction));
+    for (size_t f = 0; f < module->function_count; f++) {
+        TieredFunction* function = &runtime->functions[f];
+        translate_to_registers(module, f, &function->baseline_code);
+        translate_to_registers(module, f, &function->optimized_code);
+        peephole_optimize(&function->optimized_code);
+    }
+    runtime->stack = calloc(TIER_STACK_SIZE, sizeof(int32_t));
+    if (!runtime->stack) tier_error("out of memory creating runtime", NULL);
+    runtime->stack_end = runtime->stack + TIER_STACK_SIZE;
+    return runtime;
+}
+
+void free_tiered_runtime(TieredRuntime* runtime) {
+    for (size_t f = 0; f < runtime->function_count; f++) {
+        TieredFunction* function = &runtime->functions[f];
+        free_jit_code(&function->baseline);
+        free_jit_code(&function->optimized);
+        free(function->baseline_code.code);
+        free(function->optimized_code.code);
+    }
+    free(runtime->functions);
+    free(runtime->stack);
+    free(runtime);
+}
+
+void print_tier_statistics(TieredRuntime* runtime) {
+    static const char* tier_names[] = { "interpreter", "baseline", "optimized" };
+    for (size_t f = 0; f < runtime->function_count; f++) {
+        TieredFunction* function = &runtime->functions[f];
+        printf("%s: %s, %u calls, %u back-edges\n", function->baseline_code.name, tier_names[function->tier], function->call_count, function->loop_count);
+    }
+}
+
+int tiered_run_program(ASTNode* root) {
+    CodeModule* module = compile_module(root);
+    TieredRuntime* runtime = create_tiered_runtime(module);
+    int result = tiered_invoke(runtime, 0, runtime->stack);
+    fflush(stdout);
+    print_tier_statistics(runtime);
+    free_tiered_runtime(runtime);
+    free_code_module(module);
+    return result;
+}
+
+int main() {
+    const char* source_code =
+        "function fact(n) { if (n < 2) { return 1; } return n * fact(n - 1); }"
+        "i = 0; total = 0;"
+        "while (i < 100000000) { total = total + fact(i / 10000000); i = i + 1; }"
+        "print(total);";
+    Lexer* lexer = create_lexer(source_code);
+    Parser* parser = create_parser(lexer);
+
+    ASTNode* root = parse_block(parser);
+    return tiered_run_program(root);
+}
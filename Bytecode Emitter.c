@@ -0,0 +1,731 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+// Binary form of the stack-machine sequence generate_code prints (PUSH, LOAD,
+// ADD, ...). Code is emitted into in-memory buffers grouped in a CodeModule:
+// a constant pool, a symbol table of function names and one code object per
+// function. Function 0 is the module's top-level code.
+//
+// Encoding: one opcode byte followed by little-endian operands.
+//   u16 operands: constant index, local slot, symbol index
+//   u32 operands: absolute jump target within the function's code
+//   u8  operands: argument count
+#define BYTECODE_MAGIC 0x424E5355u   // "UNSB"
+#define BYTECODE_VERSION 1
+#define MAX_CODE_LOCALS 65535
+
+typedef enum {
+    OP_PUSH_CONST,      // u16 constant         -> push constants[k]
+    OP_LOAD,            // u16 slot             -> push locals[slot]
+    OP_STORE,           // u16 slot             pop -> locals[slot]
+    OP_ADD,
+    OP_SUB,
+    OP_MUL,
+    OP_DIV,
+    OP_LT,
+    OP_GT,
+    OP_JUMP,            // u32 target
+    OP_JUMP_IF_FALSE,   // u32 target           pop condition
+    OP_CALL,            // u16 symbol, u8 argc  pop args -> push result
+    OP_TAIL_CALL,       // u16 symbol, u8 argc  reuse the current frame
+    OP_PRINT,           // u8 argc              pop args
+    OP_POP,
+    OP_RETURN,          // pop result, leave frame
+    OP_HALT,
+    OP_COUNT
+} OpCode;
+
+// Operand layout of each opcode, used by the emitter, disassembler and loaders
+const char* opcode_names[OP_COUNT] = {
+    "PUSH", "LOAD", "STORE", "ADD", "SUB", "MUL", "DIV", "LT", "GT",
+    "JUMP", "JUMP_IF_FALSE", "CALL", "TAIL_CALL", "PRINT", "POP", "RETURN", "HALT"
+};
+
+const uint8_t opcode_sizes[OP_COUNT] = {
+    3, 3, 3, 1, 1, 1, 1, 1, 1,
+    5, 5, 4, 4, 2, 1, 1, 1
+};
+
+typedef struct {
+    uint8_t* data;
+    size_t size;
+    size_t capacity;
+} ByteBuffer;
+
+typedef struct {
+    char* name;
+    uint16_t arg_count;     // Parameters occupy slots 0..arg_count-1
+    uint16_t local_count;
+    char** local_names;     // Slot -> name, kept for diagnostics
+    ByteBuffer code;
+    uint32_t max_stack;     // Deepest operand stack above the locals; set by validate_code_object
+} CodeObject;
+
+typedef struct {
+    int32_t* constants;
+    size_t constant_count;
+    size_t constant_capacity;
+
+    char** symbols;         // Function names referenced by CALL
+    size_t symbol_count;
+    size_t symbol_capacity;
+
+    CodeObject* functions;
+    size_t function_count;
+    size_t function_capacity;
+} CodeModule;
+
+void* grow_array(void* array, size_t* capacity, size_t needed, size_t element_size) {
+    if (needed <= *capacity) return array;
+    size_t new_capacity = *capacity ? *capacity : 16;
+    while (new_capacity < needed) new_capacity *= 2;
+    array = realloc(array, new_capacity * element_size);
+    if (!array) {
+        fprintf(stderr, "Out of memory while emitting bytecode!\n");
+        exit(EXIT_FAILURE);
+    }
+    *capacity = new_capacity;
+    return array;
+}
+
+void emit_u8(ByteBuffer* buffer, uint8_t value) {
+    buffer->data = grow_array(buffer->data, &buffer->capacity, buffer->size + 1, 1);
+    buffer->data[buffer->size++] = value;
+}
+
+void emit_u16(ByteBuffer* buffer, uint16_t value) {
+    emit_u8(buffer, value & 0xFF);
+    emit_u8(buffer, value >> 8);
+}
+
+void emit_u32(ByteBuffer* buffer, uint32_t value) {
+    emit_u16(buffer, value & 0xFFFF);
+    emit_u16(buffer, value >> 16);
+}
+
+void patch_u32(ByteBuffer* buffer, size_t offset, uint32_t value) {
+    buffer->data[offset] = value & 0xFF;
+    buffer->data[offset + 1] = (value >> 8) & 0xFF;
+    buffer->data[offset + 2] = (value >> 16) & 0xFF;
+    buffer->data[offset + 3] = value >> 24;
+}
+
+uint16_t read_u16(const uint8_t* code) {
+    return (uint16_t)(code[0] | (code[1] << 8));
+}
+
+uint32_t read_u32(const uint8_t* code) {
+    return (uint32_t)code[0] | ((uint32_t)code[1] << 8) | ((uint32_t)code[2] << 16) | ((uint32_t)code[3] << 24);
+}
+
+CodeModule* create_code_module() {
+    CodeModule* module = (CodeModule*)calloc(1, sizeof(CodeModule));
+    return module;
+}
+
+// Constants are deduplicated so repeated literals share one pool entry
+uint16_t add_constant(CodeModule* module, int32_t value) {
+    for (size_t i = 0; i < module->constant_count; i++) {
+        if (module->constants[i] == value) return (uint16_t)i;
+    }
+    if (module->constant_count >= 65535) {
+        fprintf(stderr, "Too many constants in one module!\n");
+        exit(EXIT_FAILURE);
+    }
+    module->constants = grow_array(module->constants, &module->constant_capacity, module->constant_count + 1, sizeof(int32_t));
+    module->constants[module->constant_count] = value;
+    return (uint16_t)module->constant_count++;
+}
+
+uint16_t intern_symbol(CodeModule* module, const char* name) {
+    for (size_t i = 0; i < module->symbol_count; i++) {
+        if (strcmp(module->symbols[i], name) == 0) return (uint16_t)i;
+    }
+    if (module->symbol_count >= 65535) {
+        fprintf(stderr, "Too many symbols in one module!\n");
+        exit(EXIT_FAILURE);
+    }
+    module->symbols = grow_array(module->symbols, &module->symbol_capacity, module->symbol_count + 1, sizeof(char*));
+    module->symbols[module->symbol_count] = strdup(name);
+    return (uint16_t)module->symbol_count++;
+}
+
+CodeObject* add_code_object(CodeModule* module, const char* name) {
+    module->functions = grow_array(module->functions, &module->function_capacity, module->function_count + 1, sizeof(CodeObject));
+    CodeObject* code = &module->functions[module->function_count++];
+    memset(code, 0, sizeof(CodeObject));
+    code->name = strdup(name);
+    return code;
+}
+
+// Function index for a symbol, or -1 if the module doesn't define it
+int find_code_object(CodeModule* module, const char* name) {
+    for (size_t i = 0; i < module->function_count; i++) {
+        if (strcmp(module->functions[i].name, name) == 0) return (int)i;
+    }
+    return -1;
+}
+
+// Per-function compile state: variable names resolve to frame slots
+typedef struct {
+    CodeModule* module;
+    CodeObject* code;
+    size_t local_capacity;
+    ASTNode* body;          // Scope searched for assignments when a name is read
+} Emitter;
+
+// Whether 'node' assigns 'name' outside any nested definition
+int assigns_name(ASTNode* node, const char* name) {
+    if (!node) return 0;
+
+    switch (node->type) {
+        case NODE_ASSIGNMENT:
+            return strcmp(node->assignment.identifier, name) == 0;
+        case NODE_IF:
+            return assigns_name(node->if_node.then_branch, name) || assigns_name(node->if_node.else_branch, name);
+        case NODE_WHILE:
+            return assigns_name(node->while_node.body, name);
+        case NODE_BLOCK:
+            for (size_t i = 0; i < node->block.size; i++) {
+                if (assigns_name(node->block.statements[i], name)) return 1;
+            }
+            return 0;
+        default:
+            return 0;
+    }
+}
+
+uint16_t resolve_local(Emitter* emitter, const char* name) {
+    CodeObject* code = emitter->code;
+    for (uint16_t i = 0; i < code->local_count; i++) {
+        if (strcmp(code->local_names[i], name) == 0) return i;
+    }
+    if (code->local_count >= MAX_CODE_LOCALS) {
+        fprintf(stderr, "Too many locals in '%s'!\n", code->name);
+        exit(EXIT_FAILURE);
+    }
+    code->local_names = grow_array(code->local_names, &emitter->local_capacity, code->local_count + 1, sizeof(char*));
+    code->local_names[code->local_count] = strdup(name);
+    return code->local_count++;
+}
+
+// Slot for a read. Only parameters and names the scope assigns have one;
+// the interpreter reports any other name as not found, and so do we.
+uint16_t resolve_read(Emitter* emitter, const char* name) {
+    CodeObject* code = emitter->code;
+    for (uint16_t i = 0; i < code->local_count; i++) {
+        if (strcmp(code->local_names[i], name) == 0) return i;
+    }
+    if (!assigns_name(emitter->body, name)) {
+        fprintf(stderr, "Variable '%s' not found in '%s'!\n", name, code->name);
+        exit(EXIT_FAILURE);
+    }
+    return resolve_local(emitter, name);
+}
+
+void emit_op(Emitter* emitter, OpCode op) {
+    emit_u8(&emitter->code->code, (uint8_t)op);
+}
+
+// Emits a jump with a placeholder target and returns the operand offset to patch
+size_t emit_jump(Emitter* emitter, OpCode op) {
+    emit_op(emitter, op);
+    size_t offset = emitter->code->code.size;
+    emit_u32(&emitter->code->code, 0);
+    return offset;
+}
+
+void patch_jump_here(Emitter* emitter, size_t offset) {
+    patch_u32(&emitter->code->code, offset, (uint32_t)emitter->code->code.size);
+}
+
+void emit_function(CodeModule* module, ASTNode* def);
+void emit_expression(Emitter* emitter, ASTNode* node);
+
+void emit_call(Emitter* emitter, ASTNode* node, int is_tail) {
+    size_t arg_count = node->function_call.arg_count;
+    if (arg_count > 255) {
+        fprintf(stderr, "Too many arguments in call to '%s'!\n", node->function_call.function_name);
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < arg_count; i++) {
+        emit_expression(emitter, node->function_call.arguments[i]);
+    }
+
+    if (strcmp(node->function_call.function_name, "print") == 0) {
+        emit_op(emitter, OP_PRINT);
+        emit_u8(&emitter->code->code, (uint8_t)arg_count);
+        // print yields 0 so it can still be used as an expression
+        emit_op(emitter, OP_PUSH_CONST);
+        emit_u16(&emitter->code->code, add_constant(emitter->module, 0));
+        if (is_tail) emit_op(emitter, OP_RETURN); // Builtins have no frame to reuse
+        return;
+    }
+
+    emit_op(emitter, is_tail ? OP_TAIL_CALL : OP_CALL);
+    emit_u16(&emitter->code->code, intern_symbol(emitter->module, node->function_call.function_name));
+    emit_u8(&emitter->code->code, (uint8_t)arg_count);
+}
+
+void emit_expression(Emitter* emitter, ASTNode* node) {
+    switch (node->type) {
+        case NODE_NUMBER:
+            emit_op(emitter, OP_PUSH_CONST);
+            emit_u16(&emitter->code->code, add_constant(emitter->module, atoi(node->number_value)));
+            break;
+        case NODE_IDENTIFIER:
+            emit_op(emitter, OP_LOAD);
+            emit_u16(&emitter->code->code, resolve_read(emitter, node->identifier));
+            break;
+        case NODE_BINARY_EXPR:
+            emit_expression(emitter, node->binary.left);
+            emit_expression(emitter, node->binary.right);
+            switch (node->binary.op) {
+                case '+': emit_op(emitter, OP_ADD); break;
+                case '-': emit_op(emitter, OP_SUB); break;
+                case '*': emit_op(emitter, OP_MUL); break;
+                case '/': emit_op(emitter, OP_DIV); break;
+                case '<': emit_op(emitter, OP_LT); break;
+                case '>': emit_op(emitter, OP_GT); break;
+                default:
+                    fprintf(stderr, "Unknown operator '%c'!\n", node->binary.op);
+                    exit(EXIT_FAILURE);
+            }
+            break;
+        case NODE_FUNCTION_CALL:
+            emit_call(emitter, node, 0);
+            break;
+        case NODE_TAIL_CALL: // Outside a return it behaves like a call
+            emit_call(emitter, node, 0);
+            break;
+        default:
+            fprintf(stderr, "Unsupported expression in bytecode emitter!\n");
+            exit(EXIT_FAILURE);
+    }
+}
+
+void emit_statement(Emitter* emitter, ASTNode* node) {
+    if (!node) return;
+
+    switch (node->type) {
+        case NODE_ASSIGNMENT:
+            emit_expression(emitter, node->assignment.value);
+            emit_op(emitter, OP_STORE);
+            emit_u16(&emitter->code->code, resolve_local(emitter, node->assignment.identifier));
+            break;
+        case NODE_IF: {
+            emit_expression(emitter, node->if_node.condition);
+            size_t else_jump = emit_jump(emitter, OP_JUMP_IF_FALSE);
+            emit_statement(emitter, node->if_node.then_branch);
+            if (node->if_node.else_branch) {
+                size_t end_jump = emit_jump(emitter, OP_JUMP);
+                patch_jump_here(emitter, else_jump);
+                emit_statement(emitter, node->if_node.else_branch);
+                patch_jump_here(emitter, end_jump);
+            } else {
+                patch_jump_here(emitter, else_jump);
+            }
+            break;
+        }
+        case NODE_WHILE: {
+            uint32_t loop_start = (uint32_t)emitter->code->code.size;
+            emit_expression(emitter, node->while_node.condition);
+            size_t exit_jump = emit_jump(emitter, OP_JUMP_IF_FALSE);
+            emit_statement(emitter, node->while_node.body);
+            emit_op(emitter, OP_JUMP);
+            emit_u32(&emitter->code->code, loop_start);
+            patch_jump_here(emitter, exit_jump);
+            break;
+        }
+        case NODE_RETURN:
+            if (node->return_node.value && node->return_node.value->type == NODE_TAIL_CALL) {
+                emit_call(emitter, node->return_node.value, 1);
+            } else {
+                emit_expression(emitter, node->return_node.value);
+                emit_op(emitter, OP_RETURN);
+            }
+            break;
+        case NODE_BLOCK:
+            for (size_t i = 0; i < node->block.size; i++) {
+                emit_statement(emitter, node->block.statements[i]);
+            }
+            break;
+        case NODE_FUNCTION_DEF: {
+            // Definitions are static in bytecode: compiled once, never executed.
+            // Emitting one may grow 'functions', so re-derive our code pointer.
+            size_t index = emitter->code - emitter->module->functions;
+            emit_function(emitter->module, node);
+            emitter->code = &emitter->module->functions[index];
+            break;
+        }
+        default:
+            // Expression statement: evaluate for effects, discard the value
+            emit_expression(emitter, node);
+            emit_op(emitter, OP_POP);
+            break;
+    }
+}
+
+void emit_function(CodeModule* module, ASTNode* def) {
+    if (find_code_object(module, def->function_def.function_name) >= 0) {
+        fprintf(stderr, "Function '%s' defined twice in one module!\n", def->function_def.function_name);
+        exit(EXIT_FAILURE);
+    }
+    intern_symbol(module, def->function_def.function_name);
+
+    Emitter emitter = { module, add_code_object(module, def->function_def.function_name), 0, def->function_def.body };
+    for (size_t i = 0; i < def->function_def.arg_count; i++) {
+        resolve_local(&emitter, def->function_def.parameters[i]);
+    }
+    emitter.code->arg_count = (uint16_t)def->function_def.arg_count;
+
+    emit_statement(&emitter, def->function_def.body);
+
+    // Falling off the end returns 0, as execute_function does
+    emit_op(&emitter, OP_PUSH_CONST);
+    emit_u16(&emitter.code->code, add_constant(module, 0));
+    emit_op(&emitter, OP_RETURN);
+}
+
+// Compile a whole program into a module. Top-level statements become
+// function 0 ("<main>"), terminated by HALT.
+CodeModule* compile_module(ASTNode* root) {
+    CodeModule* module = create_code_module();
+    add_code_object(module, "<main>");
+
+    Emitter emitter = { module, &module->functions[0], 0, root };
+    emit_statement(&emitter, root);
+    emit_op(&emitter, OP_HALT);
+    return module;
+}
+
+void free_code_module(CodeModule* module) {
+    for (size_t i = 0; i < module->function_count; i++) {
+        CodeObject* code = &module->functions[i];
+        for (uint16_t j = 0; j < code->local_count; j++) free(code->local_names[j]);
+        free(code->local_names);
+        free(code->code.data);
+        free(code->name);
+    }
+    for (size_t i = 0; i < module->symbol_count; i++) free(module->symbols[i]);
+    free(module->functions);
+    free(module->symbols);
+    free(module->constants);
+    free(module);
+}
+
+// Human-readable listing; replaces the old printf-per-node output for debugging
+void disassemble_module(CodeModule* module, FILE* out) {
+    for (size_t f = 0; f < module->function_count; f++) {
+        CodeObject* code = &module->functions[f];
+        fprintf(out, "%s (args %u, locals %u):\n", code->name, code->arg_count, code->local_count);
+
+        size_t pc = 0;
+        while (pc < code->code.size) {
+            const uint8_t* ip = code->code.data + pc;
+            OpCode op = (OpCode)ip[0];
+            fprintf(out, "  %04zu %s", pc, opcode_names[op]);
+            switch (op) {
+                case OP_PUSH_CONST: fprintf(out, " %d", module->constants[read_u16(ip + 1)]); break;
+                case OP_LOAD:
+                case OP_STORE: fprintf(out, " %s", code->local_names[read_u16(ip + 1)]); break;
+                case OP_JUMP:
+                case OP_JUMP_IF_FALSE: fprintf(out, " %u", read_u32(ip + 1)); break;
+                case OP_CALL:
+                case OP_TAIL_CALL: fprintf(out, " %s/%u", module->symbols[read_u16(ip + 1)], ip[3]); break;
+                case OP_PRINT: fprintf(out, " %u", ip[1]); break;
+                default: break;
+            }
+            fprintf(out, "\n");
+            pc += opcode_sizes[op];
+        }
+    }
+}
+
+// Serialization: header, constant pool, symbol table, then each code object.
+// All integers are little-endian, strings are u16 length-prefixed.
+void write_string(ByteBuffer* out, const char* text) {
+    size_t length = strlen(text);
+    emit_u16(out, (uint16_t)length);
+    for (size_t i = 0; i < length; i++) emit_u8(out, (uint8_t)text[i]);
+}
+
+ByteBuffer serialize_code_module(CodeModule* module) {
+    ByteBuffer out = { NULL, 0, 0 };
+    emit_u32(&out, BYTECODE_MAGIC);
+    emit_u16(&out, BYTECODE_VERSION);
+
+    emit_u32(&out, (uint32_t)module->constant_count);
+    for (size_t i = 0; i < module->constant_count; i++) emit_u32(&out, (uint32_t)module->constants[i]);
+
+    emit_u32(&out, (uint32_t)module->symbol_count);
+    for (size_t i = 0; i < module->symbol_count; i++) write_string(&out, module->symbols[i]);
+
+    emit_u32(&out, (uint32_t)module->function_count);
+    for (size_t i = 0; i < module->function_count; i++) {
+        CodeObject* code = &module->functions[i];
+        write_string(&out, code->name);
+        emit_u16(&out, code->arg_count);
+        emit_u16(&out, code->local_count);
+        for (uint16_t j = 0; j < code->local_count; j++) write_string(&out, code->local_names[j]);
+        emit_u32(&out, (uint32_t)code->code.size);
+        for (size_t j = 0; j < code->code.size; j++) emit_u8(&out, code->code.data[j]);
+    }
+    return out;
+}
+
+// Operand stack effect of the instruction at 'ip': values it pops, values it pushes
+void stack_effect(const uint8_t* ip, uint32_t* pops, uint32_t* pushes) {
+    *pushes = 0;
+    switch ((OpCode)ip[0]) {
+        case OP_PUSH_CONST:
+        case OP_LOAD: *pops = 0; *pushes = 1; break;
+        case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV: case OP_LT: case OP_GT: *pops = 2; *pushes = 1; break;
+        case OP_CALL: *pops = ip[3]; *pushes = 1; break;
+        case OP_TAIL_CALL: *pops = ip[3]; break;
+        case OP_PRINT: *pops = ip[1]; break;
+        case OP_STORE: case OP_JUMP_IF_FALSE: case OP_POP: case OP_RETURN: *pops = 1; break;
+        default: *pops = 0; break;
+    }
+}
+
+// Follow every path from the entry with its operand stack depth: no
+// instruction may pop more than is there, every jump target and merge point
+// must be reached at one depth, and no path may fall off the end. Sets
+// code->max_stack to the deepest point.
+int check_stack_depths(CodeObject* code) {
+    size_t size = code->code.size;
+    const uint8_t* data = code->code.data;
+    int64_t* depths = malloc(sizeof(int64_t) * size);   // -1 until reached
+    size_t* pending = malloc(sizeof(size_t) * size);
+    if (!depths || !pending) {
+        free(depths);
+        free(pending);
+        return 0;
+    }
+    for (size_t pc = 0; pc < size; pc++) depths[pc] = -1;
+
+    int valid = 1;
+    size_t count = 0;
+    uint32_t max_stack = 0;
+    depths[0] = 0;
+    pending[count++] = 0;
+    while (valid && count > 0) {
+        size_t pc = pending[--count];
+        const uint8_t* ip = data + pc;
+        uint32_t pops, pushes;
+        stack_effect(ip, &pops, &pushes);
+        if ((uint64_t)depths[pc] < pops) {
+            valid = 0;
+            break;
+        }
+        int64_t depth = depths[pc] - pops + pushes;
+        if (depth > max_stack) max_stack = (uint32_t)depth;
+
+        size_t successors[2];
+        size_t successor_count = 0;
+        OpCode op = (OpCode)ip[0];
+        if (op == OP_JUMP || op == OP_JUMP_IF_FALSE) successors[successor_count++] = read_u32(ip + 1);
+        if (op != OP_JUMP && op != OP_RETURN && op != OP_HALT && op != OP_TAIL_CALL) {
+            size_t next = pc + opcode_sizes[op];
+            if (next >= size) {
+                valid = 0;  // Would run off the end of the code
+                break;
+            }
+            successors[successor_count++] = next;
+        }
+        for (size_t i = 0; i < successor_count; i++) {
+            size_t next = successors[i];
+            if (depths[next] < 0) {
+                depths[next] = depth;
+                pending[count++] = next;
+            } else if (depths[next] != depth) {
+                valid = 0;
+            }
+        }
+    }
+    free(depths);
+    free(pending);
+    if (valid) code->max_stack = max_stack;
+    return valid;
+}
+
+// Check loaded code before anything runs or disassembles it: every opcode
+// exists and fits, every constant, local and symbol operand is in range,
+// every jump lands on an instruction, and check_stack_depths proves the
+// operand stack never underflows and records how deep it gets.
+// Returns 0 if any check fails.
+int validate_code_object(const CodeModule* module, CodeObject* code) {
+    size_t size = code->code.size;
+    const uint8_t* data = code->code.data;
+    if (size == 0 || code->arg_count > code->local_count) return 0;
+
+    uint8_t* starts = calloc(size, 1);     // 1 at each instruction boundary
+    if (!starts) return 0;
+    int valid = 1;
+    OpCode last = OP_HALT;
+    for (size_t pc = 0; valid && pc < size; pc += opcode_sizes[last]) {
+        last = (OpCode)data[pc];
+        if (last >= OP_COUNT || pc + opcode_sizes[last] > size) {
+            valid = 0;
+            break;
+        }
+        starts[pc] = 1;
+        switch (last) {
+            case OP_PUSH_CONST: valid = read_u16(data + pc + 1) < module->constant_count; break;
+            case OP_LOAD:
+            case OP_STORE: valid = read_u16(data + pc + 1) < code->local_count; break;
+            case OP_CALL:
+            case OP_TAIL_CALL: valid = read_u16(data + pc + 1) < module->symbol_count; break;
+            default: break;
+        }
+    }
+    if (valid && last != OP_RETURN && last != OP_HALT && last != OP_JUMP && last != OP_TAIL_CALL) valid = 0;
+
+    // Jump targets, once every boundary is known
+    for (size_t pc = 0; valid && pc < size; pc += opcode_sizes[data[pc]]) {
+        if (data[pc] != OP_JUMP && data[pc] != OP_JUMP_IF_FALSE) continue;
+        uint32_t target = read_u32(data + pc + 1);
+        valid = target < size && starts[target];
+    }
+    free(starts);
+    return valid && check_stack_depths(code);
+}
+
+typedef struct {
+    const uint8_t* data;
+    size_t size;
+    size_t pos;
+    int error;
+} ByteReader;
+
+int reader_need(ByteReader* reader, size_t count) {
+    if (reader->error || reader->pos + count > reader->size) {
+        reader->error = 1;
+        return 0;
+    }
+    return 1;
+}
+
+uint16_t reader_u16(ByteReader* reader) {
+    if (!reader_need(reader, 2)) return 0;
+    uint16_t value = read_u16(reader->data + reader->pos);
+    reader->pos += 2;
+    return value;
+}
+
+uint32_t reader_u32(ByteReader* reader) {
+    if (!reader_need(reader, 4)) return 0;
+    uint32_t value = read_u32(reader->data + reader->pos);
+    reader->pos += 4;
+    return value;
+}
+
+char* reader_string(ByteReader* reader) {
+    uint16_t length = reader_u16(reader);
+    if (!reader_need(reader, length)) return strdup("");
+    char* text = malloc(length + 1);
+    memcpy(text, reader->data + reader->pos, length);
+    text[length] = '\0';
+    reader->pos += length;
+    return text;
+}
+
+// Returns NULL on a truncated, foreign or corrupt buffer
+CodeModule* deserialize_code_module(const uint8_t* data, size_t size) {
+    ByteReader reader = { data, size, 0, 0 };
+    if (reader_u32(&reader) != BYTECODE_MAGIC || reader_u16(&reader) != BYTECODE_VERSION) return NULL;
+
+    CodeModule* module = create_code_module();
+    uint32_t constant_count = reader_u32(&reader);
+    for (uint32_t i = 0; i < constant_count && !reader.error; i++) {
+        module->constants = grow_array(module->constants, &module->constant_capacity, module->constant_count + 1, sizeof(int32_t));
+        module->constants[module->constant_count++] = (int32_t)reader_u32(&reader);
+    }
+
+    uint32_t symbol_count = reader_u32(&reader);
+    for (uint32_t i = 0; i < symbol_count && !reader.error; i++) {
+        module->symbols = grow_array(module->symbols, &module->symbol_capacity, module->symbol_count + 1, sizeof(char*));
+        module->symbols[module->symbol_count++] = reader_string(&reader);
+    }
+
+    uint32_t function_count = reader_u32(&reader);
+    for (uint32_t i = 0; i < function_count && !reader.error; i++) {
+        char* name = reader_string(&reader);
+        CodeObject* code = add_code_object(module, name);
+        free(name);
+        code->arg_count = reader_u16(&reader);
+        code->local_count = reader_u16(&reader);
+        code->local_names = malloc(sizeof(char*) * (code->local_count ? code->local_count : 1));
+        for (uint16_t j = 0; j < code->local_count; j++) code->local_names[j] = reader_string(&reader);
+
+        uint32_t code_size = reader_u32(&reader);
+        if (!reader_need(&reader, code_size)) break;
+        code->code.data = malloc(code_size ? code_size : 1);
+        memcpy(code->code.data, data + reader.pos, code_size);
+        code->code.size = code->code.capacity = code_size;
+        reader.pos += code_size;
+        if (!validate_code_object(module, code)) reader.error = 1;
+    }
+
+    if (reader.error || module->function_count == 0) { // Function 0 is the top-level code
+        free_code_module(module);
+        return NULL;
+    }
+    return module;
+}
+
+int write_code_module(CodeModule* module, const char* filename) {
+    ByteBuffer out = serialize_code_module(module);
+    FILE* file = fopen(filename, "wb");
+    if (!file) {
+        perror("Error opening bytecode file");
+        free(out.data);
+        return 0;
+    }
+    size_t written = fwrite(out.data, 1, out.size, file);
+    fclose(file);
+    free(out.data);
+    return written == out.size;
+}
+
+CodeModule* read_code_module(const char* filename) {
+    FILE* file = fopen(filename, "rb");
+    if (!file) {
+        perror("Error opening bytecode file");
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    uint8_t* data = malloc(size > 0 ? size : 1);
+    size_t read = fread(data, 1, size, file);
+    fclose(file);
+
+    CodeModule* module = read == (size_t)size ? deserialize_code_module(data, read) : NULL;
+    free(data);
+    return module;
+}
+
+int main() {
+    const char* source_code = "function add(a, b) { return a + b; } x = add(3, 4) * 2; print(x);";
+    Lexer* lexer = create_lexer(source_code);
+    Parser* parser = create_parser(lexer);
+
+    ASTNode* root = parse_block(parser);
+    CodeModule* module = compile_module(root);
+    disassemble_module(module, stdout);
+
+    write_code_module(module, "program.unsb");
+    CodeModule* loaded = read_code_module("program.unsb");
+    if (loaded) {
+        printf("Reloaded %zu functions, %zu constants\n", loaded->function_count, loaded->constant_count);
+        free_code_module(loaded);
+    }
+
+    free_code_module(module);
+    return 0;
+}
@@ -0,0 +1,524 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/resource.h>
+
+// A contiguous call stack for the tree-walking interpreter.
+//
+// Each function's locals are resolved once, on its first call, into a
+// FrameLayout: the parameters first, then every name the body assigns.
+// Every identifier and assignment in the body is bound to a (hops, slot)
+// pair. 'hops' is how many lexical parents to walk up from the current
+// frame. A call pushes a frame of exactly local_count slots onto one
+// preallocated region and pops it on return. No RuntimeEnvironment is
+// allocated per call, and nothing leaks.
+//
+// A function defined inside another function gets that function's layout
+// as its lexical parent. When it is called, its parent frame is found by
+// following the caller's static links. A name that resolves to no function
+// scope, or whose parent frame is no longer live, falls back to the global
+// RuntimeEnvironment.
+//
+// Strings and arrays built at an allocation site that escape analysis
+// proved frame-local are allocated in the frame's region rather than on the
+// GC heap, and are freed all at once when the frame is popped.
+//
+// Every call also recurses in C, so push_frame checks how much of the C
+// stack is used as well as the frame count. Deep recursion is reported as
+// a stack overflow instead of crashing. Local slots start out unset, and
+// reading one before it is assigned is an error, as it is for globals.
+#define CALL_STACK_SLOTS (1 << 20)
+#define MAX_CALL_DEPTH (1 << 16)
+#define C_STACK_DEFAULT (8 << 20)      // Assumed when the limit is unknown or unlimited
+#define C_STACK_RESERVE (256 << 10)    // Left free for the C frames between checks
+#define GLOBAL_SCOPE -1
+#define BOXED_UNSET (QNAN | TAG_SPECIAL | 5) // Slot not assigned yet; never leaves a slot
+
+typedef struct FrameLayout {
+    struct FrameLayout* enclosing;  // Lexically enclosing function, NULL at top level
+    char** locals;                  // Parameters first
+    size_t local_count;
+    size_t local_capacity;
+    int resolved;
+} FrameLayout;
+
+typedef struct CallFrame {
+    FrameLayout* layout;
+    struct CallFrame* parent;       // Live frame of the enclosing function, NULL for globals
+    BoxedValue* slots;          // See NaN Boxing.c
+    Object* region;                 // Frame-local heap values, freed by pop_frame
+} CallFrame;
+
+typedef struct {
+    BoxedValue* slots;
+    size_t slot_top;
+    CallFrame* frames;
+    size_t depth;
+    RuntimeEnvironment* globals;
+    char* c_stack_base;             // Address near the bottom of the C stack
+    size_t c_stack_budget;          // Bytes of C stack calls may use
+} CallStack;
+
+// Where an identifier or assignment node reads and writes, keyed by node
+typedef struct {
+    ASTNode* node;
+    int hops;                       // GLOBAL_SCOPE for globals
+    uint32_t slot;
+} NameBinding;
+
+typedef struct {
+    NameBinding* bindings;
+    size_t count;
+    size_t capacity;                // Power of two
+} BindingTable;
+
+FrameLayout* frame_layouts = NULL; // Indexed by Function.index
+size_t layout_capacity = 0;
+BindingTable binding_table = { NULL, 0, 0 };
+CallStack call_stack;
+
+void init_call_stack() {
+    call_stack.slots = malloc(sizeof(BoxedValue) * CALL_STACK_SLOTS);
+    call_stack.frames = malloc(sizeof(CallFrame) * MAX_CALL_DEPTH);
+    if (!call_stack.slots || !call_stack.frames) {
+        fprintf(stderr, "Out of memory allocating the call stack\n");
+        exit(EXIT_FAILURE);
+    }
+    call_stack.slot_top = 0;
+    call_stack.depth = 0;
+    call_stack.globals = create_runtime_environment();
+
+    struct rlimit limit;
+    size_t c_stack = C_STACK_DEFAULT;
+    if (getrlimit(RLIMIT_STACK, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY) c_stack = (size_t)limit.rlim_cur;
+    call_stack.c_stack_base = (char*)__builtin_frame_address(0);
+    call_stack.c_stack_budget = c_stack > 2 * C_STACK_RESERVE ? c_stack - C_STACK_RESERVE : c_stack / 2;
+}
+
+// Bytes of C stack between init_call_stack and the caller
+size_t c_stack_used() {
+    char* here = (char*)__builtin_frame_address(0);
+    return here < call_stack.c_stack_base ? (size_t)(call_stack.c_stack_base - here) : (size_t)(here - call_stack.c_stack_base);
+}
+
+FrameLayout* layout_of(Function* function) {
+    if (function->index >= layout_capacity) {
+        size_t capacity = layout_capacity ? layout_capacity : 64;
+        while (capacity <= function->index) capacity *= 2;
+        frame_layouts = realloc(frame_layouts, sizeof(FrameLayout) * capacity);
+        if (!frame_layouts) {
+            fprintf(stderr, "Out of memory allocating frame layouts\n");
+            exit(EXIT_FAILURE);
+        }
+        memset(frame_layouts + layout_capacity, 0, sizeof(FrameLayout) * (capacity - layout_capacity));
+        layout_capacity = capacity;
+    }
+    return &frame_layouts[function->index];
+}
+
+CallFrame* push_frame(FrameLayout* layout, CallFrame* parent) {
+    if (call_stack.depth >= MAX_CALL_DEPTH || call_stack.slot_top + layout->local_count > CALL_STACK_SLOTS ||
+        c_stack_used() > call_stack.c_stack_budget) {
+        fprintf(stderr, "Stack overflow\n");
+        exit(EXIT_FAILURE);
+    }
+    CallFrame* frame = &call_stack.frames[call_stack.depth++];
+    frame->layout = layout;
+    frame->parent = parent;
+    frame->slots = call_stack.slots + call_stack.slot_top;
+    frame->region = NULL;
+    call_stack.slot_top += layout->local_count;
+    return frame; // Slots are uninitialized; the caller fills them
+}
+
+void clear_slots(BoxedValue* slots, size_t count) {
+    for (size_t i = 0; i < count; i++) slots[i] = BOXED_UNSET;
+}
+
+void pop_frame() {
+    CallFrame* frame = &call_stack.frames[--call_stack.depth];
+    call_stack.slot_top -= frame->layout->local_count;
+    release_region(frame->region);
+}
+
+size_t hash_node_pointer(ASTNode* node, size_t capacity) {
+    return (size_t)(((uintptr_t)node >> 4) * 0x9E3779B97F4A7C15ULL) & (capacity - 1);
+}
+
+void bind_name(ASTNode* node, int hops, uint32_t slot) {
+    if ((binding_table.count + 1) * 2 > binding_table.capacity) {
+        BindingTable grown = { calloc(binding_table.capacity ? binding_table.capacity * 2 : 256, sizeof(NameBinding)), 0, binding_table.capacity ? binding_table.capacity * 2 : 256 };
+        for (size_t i = 0; i < binding_table.capacity; i++) {
+            NameBinding* old = &binding_table.bindings[i];
+            if (!old->node) continue;
+            size_t position = hash_node_pointer(old->node, grown.capacity);
+            while (grown.bindings[position].node) position = (position + 1) & (grown.capacity - 1);
+            grown.bindings[position] = *old;
+            grown.count++;
+        }
+        free(binding_table.bindings);
+        binding_table = grown;
+    }
+
+    size_t position = hash_node_pointer(node, binding_table.capacity);
+    while (binding_table.bindings[position].node && binding_table.bindings[position].node != node) {
+        position = (position + 1) & (binding_table.capacity - 1);
+    }
+    if (!binding_table.bindings[position].node) binding_table.count++;
+    binding_table.bindings[position] = (NameBinding){ node, hops, slot };
+}
+
+NameBinding* find_binding(ASTNode* node) {
+    if (!binding_table.capacity) return NULL;
+    size_t position = hash_node_pointer(node, binding_table.capacity);
+    while (binding_table.bindings[position].node) {
+        if (binding_table.bindings[position].node == node) return &binding_table.bindings[position];
+        position = (position + 1) & (binding_table.capacity - 1);
+    }
+    return NULL;
+}
+
+long layout_slot(FrameLayout* layout, const char* name) {
+    for (size_t i = 0; i < layout->local_count; i++) {
+        if (strcmp(layout->locals[i], name) == 0) return (long)i;
+    }
+    return -1;
+}
+
+void add_local(FrameLayout* layout, char* name) {
+    if (layout_slot(layout, name) >= 0) return;
+    if (layout->local_count == layout->local_capacity) {
+        layout->local_capacity = layout->local_capacity ? layout->local_capacity * 2 : 8;
+        layout->locals = realloc(layout->locals, sizeof(char*) * layout->local_capacity);
+    }
+    layout->locals[layout->local_count++] = name;
+}
+
+int bound_in_enclosing(FrameLayout* layout, const char* name) {
+    for (FrameLayout* scope = layout->enclosing; scope; scope = scope->enclosing) {
+        if (layout_slot(scope, name) >= 0) return 1;
+    }
+    return 0;
+}
+
+// Assigned names are local to the function unless an enclosing function
+// already has them; nested definitions have their own scope
+void collect_locals(FrameLayout* layout, ASTNode* node) {
+    if (!node) return;
+
+    switch (node->type) {
+        case NODE_ASSIGNMENT:
+            if (!bound_in_enclosing(layout, node->assignment.identifier)) {
+                add_local(layout, node->assignment.identifier);
+            }
+            break;
+        case NODE_IF:
+            collect_locals(layout, node->if_node.then_branch);
+            collect_locals(layout, node->if_node.else_branch);
+            break;
+        case NODE_WHILE:
+            collect_locals(layout, node->while_node.body);
+            break;
+        case NODE_BLOCK:
+            for (size_t i = 0; i < node->block.size; i++) {
+                collect_locals(layout, node->block.statements[i]);
+            }
+            break;
+    }
+}
+
+void bind_reference(FrameLayout* layout, ASTNode* node, const char* name) {
+    int hops = 0;
+    for (FrameLayout* scope = layout; scope; scope = scope->enclosing, hops++) {
+        long slot = layout_slot(scope, name);
+        if (slot >= 0) {
+            bind_name(node, hops, (uint32_t)slot);
+            return;
+        }
+    }
+    bind_name(node, GLOBAL_SCOPE, 0);
+}
+
+void bind_references(FrameLayout* layout, ASTNode* node) {
+    if (!node) return;
+
+    switch (node->type) {
+        case NODE_IDENTIFIER:
+            bind_reference(layout, node, node->identifier);
+            break;
+        case NODE_ASSIGNMENT:
+            bind_reference(layout, node, node->assignment.identifier);
+            bind_references(layout, node->assignment.value);
+            break;
+        case NODE_BINARY_EXPR:
+            bind_references(layout, node->binary.left);
+            bind_references(layout, node->binary.right);
+            break;
+        case NODE_IF:
+            bind_references(layout, node->if_node.condition);
+            bind_references(layout, node->if_node.then_branch);
+            bind_references(layout, node->if_node.else_branch);
+            break;
+        case NODE_WHILE:
+            bind_references(layout, node->while_node.condition);
+            bind_references(layout, node->while_node.body);
+            break;
+        case NODE_RETURN:
+            bind_references(layout, node->return_node.value);
+            break;
+        case NODE_BLOCK:
+            for (size_t i = 0; i < node->block.size; i++) {
+                bind_references(layout, node->block.statements[i]);
+            }
+            break;
+        case NODE_FUNCTION_CALL:
+        case NODE_TAIL_CALL:
+        case NODE_NATIVE_CALL:
+            for (size_t i = 0; i < node->function_call.arg_count; i++) {
+                bind_references(layout, node->function_call.arguments[i]);
+            }
+            break;
+    }
+}
+
+void resolve_layout(Function* function) {
+    FrameLayout* layout = layout_of(function);
+    for (size_t i = 0; i < function->arg_count; i++) {
+        add_local(layout, function->arguments[i]);
+    }
+    collect_locals(layout, function->body);
+    bind_references(layout, function->body);
+    layout->resolved = 1;
+}
+
+// Frame a binding refers to, or NULL when it lives in the globals
+CallFrame* binding_frame(CallFrame* frame, NameBinding* binding) {
+    if (!binding || binding->hops == GLOBAL_SCOPE) return NULL;
+    for (int i = 0; i < binding->hops && frame; i++) frame = frame->parent;
+    return frame;
+}
+
+BoxedValue frame_load(CallFrame* frame, ASTNode* node) {
+    NameBinding* binding = frame ? find_binding(node) : NULL;
+    CallFrame* target = binding_frame(frame, binding);
+    if (target) {
+        if (target->slots[binding->slot] == BOXED_UNSET) {
+            fprintf(stderr, "Variable '%s' not found!\n", node->identifier);
+            exit(EXIT_FAILURE);
+        }
+        return target->slots[binding->slot] = force_value(target->slots[binding->slot]);
+    }
+    return force_value(get_boxed_variable(call_stack.globals, node->identifier));
+}
+
+void frame_store(CallFrame* frame, ASTNode* node, BoxedValue value) {
+    NameBinding* binding = frame ? find_binding(node) : NULL;
+    CallFrame* target = binding_frame(frame, binding);
+    if (target) target->slots[binding->slot] = value;
+    else set_boxed_variable(call_stack.globals, node->assignment.identifier, value);
+}
+
+// Static link: the nearest frame of the callee's enclosing function along the caller's lexical chain
+CallFrame* static_parent(CallFrame* caller, FrameLayout* callee) {
+    if (!callee->enclosing) return NULL;
+    for (CallFrame* frame = caller; frame; frame = frame->parent) {
+        if (frame->layout == callee->enclosing) return frame;
+    }
+    return NULL;
+}
+
+int site_is_frame_local(ASTNode* site); // See Escape Analysis.c
+
+// Region for the value built at 'site': the frame's when it can't outlive the call
+Object** site_region(CallFrame* frame, ASTNode* site) {
+    return frame && site_is_frame_local(site) ? &frame->region : NULL;
+}
+
+ControlFlow frame_execute(CallFrame* frame, ASTNode* node, BoxedValue* result, ASTNode** tail_call);
+
+BoxedValue frame_call(CallFrame* caller, ASTNode* call);
+
+BoxedValue frame_evaluate(CallFrame* frame, ASTNode* node) {
+    switch (node->type) {
+        case NODE_NUMBER:
+            return box_number_literal(node->number_value);
+        case NODE_STRING:
+            {
+                Object** region = allocation_region;
+                allocation_region = site_region(frame, node);
+                BoxedValue value = box_string(node->string_value, strlen(node->string_value));
+                allocation_region = region;
+                return value;
+            }
+        case NODE_IDENTIFIER:
+            return frame_load(frame, node);
+        case NODE_FUNCTION_CALL:
+        case NODE_TAIL_CALL:
+            return frame_call(frame, node);
+        case NODE_NATIVE_CALL:
+            return call_native(frame, node);
+        case NODE_BINARY_EXPR:
+            {
+                BoxedValue left_value = frame_evaluate(frame, node->binary.left);
+                BoxedValue right_value = frame_evaluate(frame, node->binary.right);
+                Object** region = allocation_region;
+                allocation_region = site_region(frame, node);
+                BoxedValue value = boxed_binary(node->binary.op, left_value, right_value);
+                allocation_region = region;
+                return value;
+            }
+    }
+    return BOXED_NIL;
+}
+
+ControlFlow frame_execute(CallFrame* frame, ASTNode* node, BoxedValue* result, ASTNode** tail_call) {
+    if (!node) return FLOW_NORMAL;
+
+    switch (node->type) {
+        case NODE_RETURN:
+            if (frame && node->return_node.value && node->return_node.value->type == NODE_TAIL_CALL) {
+                *tail_call = node->return_node.value;
+                return FLOW_TAIL_CALL;
+            }
+            *result = node->return_node.value ? frame_evaluate(frame, node->return_node.value) : BOXED_NIL;
+            return FLOW_RETURN;
+        case NODE_IF:
+            if (is_truthy_value(frame_evaluate(frame, node->if_node.condition))) {
+                return frame_execute(frame, node->if_node.then_branch, result, tail_call);
+            }
+            return frame_execute(frame, node->if_node.else_branch, result, tail_call);
+        case NODE_WHILE:
+            while (is_truthy_value(frame_evaluate(frame, node->while_node.condition))) {
+                ControlFlow flow = frame_execute(frame, node->while_node.body, result, tail_call);
+                if (flow != FLOW_NORMAL) return flow;
+            }
+            return FLOW_NORMAL;
+        case NODE_BLOCK:
+            for (size_t i = 0; i < node->block.size; i++) {
+                ControlFlow flow = frame_execute(frame, node->block.statements[i], result, tail_call);
+                if (flow != FLOW_NORMAL) return flow;
+            }
+            return FLOW_NORMAL;
+        case NODE_ASSIGNMENT:
+            frame_store(frame, node, frame_evaluate(frame, node->assignment.value));
+            return FLOW_NORMAL;
+        case NODE_FUNCTION_DEF: {
+            // Running the same definition again reuses its Function and layout
+            Function* function = define_function(node); // See Function Registry.c
+            FrameLayout* layout = layout_of(function);
+            layout->enclosing = frame ? frame->layout : NULL;
+            return FLOW_NORMAL;
+        }
+        default:
+            frame_evaluate(frame, node);
+            return FLOW_NORMAL;
+    }
+}
+
+Function* resolve_callee(ASTNode* call) {
+    Function* function = resolve_call_site(call); // See Function Registry.c
+    if (!function) {
+        fprintf(stderr, "Undefined function '%s'\n", call->function_call.function_name);
+        exit(EXIT_FAILURE);
+    }
+    if (function->body && call->function_call.arg_count != function->arg_count) {
+        fprintf(stderr, "Function '%s' expected %zu arguments but got %zu\n", function->name, function->arg_count, call->function_call.arg_count);
+        exit(EXIT_FAILURE);
+    }
+    if (function->body && !layout_of(function)->resolved) resolve_layout(function);
+    return function;
+}
+
+// Push the callee's frame and run it. Tail calls pop the current frame
+// before pushing the next one, so they run in constant stack space.
+BoxedValue frame_call(CallFrame* caller, ASTNode* call) {
+    Function* function = resolve_callee(call);
+    if (!function->body) {
+        // Builtin print
+        for (size_t i = 0; i < call->function_call.arg_count; i++) {
+            print_boxed_value(stdout, frame_evaluate(caller, call->function_call.arguments[i]));
+            printf(" ");
+        }
+        printf("\n");
+        return BOXED_NIL;
+    }
+
+    FrameLayout* layout = layout_of(function);
+    CallFrame* frame = push_frame(layout, static_parent(caller, layout));
+    for (size_t i = 0; i < function->arg_count; i++) {
+        // Arguments may call functions, which push and pop above this frame
+        frame->slots[i] = frame_evaluate(caller, call->function_call.arguments[i]);
+    }
+    clear_slots(frame->slots + function->arg_count, layout->local_count - function->arg_count);
+
+    for (;;) {
+        BoxedValue result = BOXED_NIL;
+        ASTNode* tail_call = NULL;
+        if (frame_execute(frame, function->body, &result, &tail_call) != FLOW_TAIL_CALL) {
+            pop_frame();
+            return result;
+        }
+
+        Function* callee = resolve_callee(tail_call);
+        FrameLayout* callee_layout = callee->body ? layout_of(callee) : NULL;
+        CallFrame* parent = callee_layout ? static_parent(frame, callee_layout) : NULL;
+        // A builtin has no frame, and a function nested in this one needs
+        // this frame as its static parent; neither can take its place
+        if (!callee_layout || parent == frame) {
+            result = frame_call(frame, tail_call);
+            pop_frame();
+            return result;
+        }
+
+        // Stage the arguments just above the old frame, reserved so that
+        // calls made while evaluating them can't overwrite them
+        size_t count = callee->arg_count;
+        if (call_stack.slot_top + count > CALL_STACK_SLOTS) {
+            fprintf(stderr, "Stack overflow\n");
+            exit(EXIT_FAILURE);
+        }
+        BoxedValue* staged = call_stack.slots + call_stack.slot_top;
+        call_stack.slot_top += count;
+        for (size_t i = 0; i < count; i++) {
+            staged[i] = frame_evaluate(frame, tail_call->function_call.arguments[i]);
+        }
+        call_stack.slot_top -= count;
+
+        pop_frame();
+        frame = push_frame(callee_layout, parent);
+        memmove(frame->slots, staged, sizeof(BoxedValue) * count); // The regions may overlap
+        clear_slots(frame->slots + count, callee_layout->local_count - count);
+        function = callee;
+    }
+}
+
+void frame_run_program(ASTNode* root) {
+    init_call_stack();
+    BoxedValue result = BOXED_NIL;
+    ASTNode* tail_call = NULL;
+    frame_execute(NULL, root, &result, &tail_call);
+}
+
+int main() {
+    const char* source_code =
+        "function sum(n, acc) { if (n < 1) { return acc; } return sum(n - 1, acc + n); }"
+        "function fib(n) { if (n < 2) { return n; } return fib(n - 1) + fib(n - 2); }"
+        "function counter(limit) {"
+        "  count = 0;"
+        "  function step(by) { count = count + by; return count; }"
+        "  while (count < limit) { step(3); }"
+        "  return count;"
+        "}"
+        "function tag(n) { text = \"item\" + \"-\"; print(text); return n; }" // Built in tag's region
+        "print(sum(100000, 0), fib(25), counter(10), tag(1));";
+    Lexer* lexer = create_lexer(source_code);
+    Parser* parser = create_parser(lexer);
+
+    initialize_stdlib();
+    ASTNode* root = parse_block(parser);
+    mark_program_tail_calls(root);
+    escape_analysis_program(root);
+    frame_run_program(root);
+    return 0;
+}
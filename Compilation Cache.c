@@ -0,0 +1,515 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <errno.h>
+
+// Compilation cache keyed by serialized ASTs.
+//
+// The key of a subtree is a canonical serialization of it, so two subtrees
+// with the same shape, names and literals share an artifact, whichever
+// script they came from. Artifacts live as files in one directory shared by
+// every process of this user:
+//
+//   v2-<hash>.ubc   bytecode for one node definition, or for a whole program
+//   v2-<hash>.so    native module from the AOT backend
+//
+// The 64-bit hash of the key only names the file. Each artifact ends with
+// its full key (key bytes, u32 length, CACHE_KEY_MAGIC), and a lookup
+// compares that key before anything is deserialized or loaded, so a hash
+// collision is a miss. The loader ignores bytes past an ELF file's sections,
+// so the trailer doesn't disturb dlopen.
+//
+// Native artifacts are loaded and run, so the directory must belong to this
+// user and be closed to everyone else (0700); open_compile_cache refuses it
+// otherwise. An artifact is written to a temporary name and renamed into
+// place, so readers never see partial files. A hit bumps the artifact's
+// mtime. When the directory grows past its budget, the least recently used
+// artifacts are deleted under an flock, so concurrent evictions don't race.
+// A lookup keeps the artifact open, and an entry evicted before it could be
+// loaded is compiled again.
+//
+// Bytecode is cached per node definition. A program whose definitions were
+// seen before only compiles its top-level statements plus whatever changed,
+// and the cached definitions are relinked into the new module's pools.
+#define CACHE_FORMAT_VERSION 2
+#define CACHE_DEFAULT_BUDGET (256ULL * 1024 * 1024)
+#define CACHE_PATH_SIZE 1024
+#define CACHE_KEY_MAGIC "UNSKEY02"
+#define CACHE_KEY_MAGIC_SIZE 8
+#define CACHE_KEY_DEFINITION 'D'
+#define CACHE_KEY_PROGRAM 'P'
+
+typedef struct {
+    char directory[CACHE_PATH_SIZE];
+    uint64_t budget;          // Bytes
+    size_t hits;
+    size_t misses;
+} CompileCache;
+
+typedef struct {
+    char name[256];
+    off_t size;
+    time_t last_used;
+} CacheEntry;
+
+uint64_t hash_mix(uint64_t hash, uint64_t value) {
+    hash ^= value + 0x9E3779B97F4A7C15ULL + (hash << 6) + (hash >> 2);
+    return hash * 0xFF51AFD7ED558CCDULL;
+}
+
+void append_key_string(ByteBuffer* key, const char* text) {
+    if (!text) {
+        emit_u32(key, UINT32_MAX);
+        return;
+    }
+    size_t length = strlen(text);
+    emit_u32(key, (uint32_t)length);
+    for (size_t i = 0; i < length; i++) emit_u8(key, (uint8_t)text[i]);
+}
+
+// Append the canonical form of a subtree to key. Returns 0 on node types it
+// doesn't know, since their contents can't be keyed faithfully.
+int append_ast_key(ByteBuffer* key, ASTNode* node) {
+    if (!node) {
+        emit_u16(key, 0xFFFF);
+        return 1;
+    }
+
+    int cacheable = 1;
+    emit_u16(key, (uint16_t)node->type);
+    switch (node->type) {
+        case NODE_NUMBER:
+            append_key_string(key, node->number_value);
+            break;
+        case NODE_IDENTIFIER:
+            append_key_string(key, node->identifier);
+            break;
+        case NODE_STRING:
+            append_key_string(key, node->string_value);
+            break;
+        case NODE_BINARY_EXPR:
+            emit_u8(key, (uint8_t)node->binary.op);
+            cacheable &= append_ast_key(key, node->binary.left);
+            cacheable &= append_ast_key(key, node->binary.right);
+            break;
+        case NODE_ASSIGNMENT:
+            append_key_string(key, node->assignment.identifier);
+            cacheable &= append_ast_key(key, node->assignment.value);
+            break;
+        case NODE_IF:
+            cacheable &= append_ast_key(key, node->if_node.condition);
+            cacheable &= append_ast_key(key, node->if_node.then_branch);
+            cacheable &= append_ast_key(key, node->if_node.else_branch);
+            break;
+        case NODE_WHILE:
+            cacheable &= append_ast_key(key, node->while_node.condition);
+            cacheable &= append_ast_key(key, node->while_node.body);
+            break;
+        case NODE_RETURN:
+            cacheable &= append_ast_key(key, node->return_node.value);
+            break;
+        case NODE_BLOCK:
+            emit_u32(key, (uint32_t)node->block.size);
+            for (size_t i = 0; i < node->block.size; i++) {
+                cacheable &= append_ast_key(key, node->block.statements[i]);
+            }
+            break;
+        case NODE_FUNCTION_CALL:
+        case NODE_TAIL_CALL:
+            append_key_string(key, node->function_call.function_name);
+            emit_u32(key, (uint32_t)node->function_call.arg_count);
+            for (size_t i = 0; i < node->function_call.arg_count; i++) {
+                cacheable &= append_ast_key(key, node->function_call.arguments[i]);
+            }
+            break;
+        case NODE_FUNCTION_DEF:
+            append_key_string(key, node->function_def.function_name);
+            emit_u32(key, (uint32_t)node->function_def.arg_count);
+            for (size_t i = 0; i < node->function_def.arg_count; i++) {
+                append_key_string(key, node->function_def.parameters[i]);
+            }
+            cacheable &= append_ast_key(key, node->function_def.body);
+            break;
+        default:
+            cacheable = 0;
+            break;
+    }
+    return cacheable;
+}
+
+// The key of a definition or a whole program; the kind byte keeps a
+// program from sharing an entry with its lone definition
+int build_cache_key(ByteBuffer* key, char kind, ASTNode* node) {
+    key->size = 0;
+    emit_u8(key, (uint8_t)kind);
+    return append_ast_key(key, node);
+}
+
+uint64_t hash_cache_key(const ByteBuffer* key) {
+    uint64_t hash = 0xCBF29CE484222325ULL; // FNV-1a offset basis
+    for (size_t i = 0; i < key->size; i++) {
+        hash ^= key->data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash_mix(hash, key->size);
+}
+
+// Artifacts are executed, so refuse a directory anyone else could write to.
+// One we own is tightened to 0700; a symlink or someone else's is rejected.
+int secure_cache_directory(const char* path) {
+    if (mkdir(path, 0700) != 0 && errno != EEXIST) {
+        perror("Error creating cache directory");
+        return 0;
+    }
+    int fd = open(path, O_RDONLY | O_DIRECTORY | O_NOFOLLOW);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0 || info.st_uid != geteuid() ||
+        ((info.st_mode & 077) != 0 && fchmod(fd, 0700) != 0)) {
+        fprintf(stderr, "Refusing cache directory %s: it must be a directory owned by this user with mode 0700\n", path);
+        if (fd >= 0) close(fd);
+        return 0;
+    }
+    close(fd);
+    return 1;
+}
+
+CompileCache* open_compile_cache(const char* directory, uint64_t budget) {
+    CompileCache* cache = (CompileCache*)calloc(1, sizeof(CompileCache));
+    cache->budget = budget ? budget : CACHE_DEFAULT_BUDGET;
+
+    if (!directory) directory = getenv("UNS_CACHE_DIR");
+    if (directory) {
+        snprintf(cache->directory, sizeof(cache->directory), "%s", directory);
+    } else if (getenv("HOME")) {
+        char parent[CACHE_PATH_SIZE];
+        snprintf(parent, sizeof(parent), "%s/.cache", getenv("HOME"));
+        mkdir(parent, 0700);
+        snprintf(cache->directory, sizeof(cache->directory), "%s/uns", parent);
+    } else {
+        snprintf(cache->directory, sizeof(cache->directory), "/tmp/uns-cache-%ld", (long)geteuid());
+    }
+
+    if (!secure_cache_directory(cache->directory)) {
+        free(cache);
+        return NULL;
+    }
+    return cache;
+}
+
+void cache_entry_path(CompileCache* cache, uint64_t hash, const char* kind, char* path, size_t size) {
+    snprintf(path, size, "%s/v%d-%016llx.%s", cache->directory, CACHE_FORMAT_VERSION, (unsigned long long)hash, kind);
+}
+
+// Unique scratch path inside the cache directory, so the final rename stays on one filesystem
+void cache_temp_path(CompileCache* cache, uint64_t hash, char* path, size_t size) {
+    static unsigned counter = 0;
+    snprintf(path, size, "%s/.tmp-%016llx-%ld-%u", cache->directory, (unsigned long long)hash, (long)getpid(), counter++);
+}
+
+// Finish an artifact by appending its key trailer
+int cache_append_key(const char* path, const ByteBuffer* key) {
+    FILE* file = fopen(path, "ab");
+    if (!file) return 0;
+    uint8_t length[4] = { key->size & 0xFF, (key->size >> 8) & 0xFF, (key->size >> 16) & 0xFF, (key->size >> 24) & 0xFF };
+    int written = fwrite(key->data, 1, key->size, file) == key->size &&
+                  fwrite(length, 1, sizeof(length), file) == sizeof(length) &&
+                  fwrite(CACHE_KEY_MAGIC, 1, CACHE_KEY_MAGIC_SIZE, file) == CACHE_KEY_MAGIC_SIZE;
+    return fclose(file) == 0 && written;
+}
+
+// Bytes before the key trailer, or -1 unless the file ends with exactly this key
+off_t cache_check_key(int fd, const ByteBuffer* key) {
+    struct stat info;
+    uint8_t trailer[4 + CACHE_KEY_MAGIC_SIZE];
+    off_t payload = 0;
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) return -1;
+    payload = info.st_size - (off_t)(key->size + sizeof(trailer));
+    if (payload <= 0 || pread(fd, trailer, sizeof(trailer), payload + (off_t)key->size) != (ssize_t)sizeof(trailer)) return -1;
+    uint32_t length = trailer[0] | (trailer[1] << 8) | (trailer[2] << 16) | ((uint32_t)trailer[3] << 24);
+    if (length != key->size || memcmp(trailer + 4, CACHE_KEY_MAGIC, CACHE_KEY_MAGIC_SIZE) != 0) return -1;
+
+    uint8_t* stored = malloc(key->size ? key->size : 1);
+    int matches = stored && pread(fd, stored, key->size, payload) == (ssize_t)key->size && memcmp(stored, key->data, key->size) == 0;
+    free(stored);
+    return matches ? payload : -1;
+}
+
+// On a hit, fills path and *payload_size, marks the artifact as recently
+// used and returns it open, so a concurrent eviction can't pull it away
+// from a reader. Returns -1 on a miss.
+int cache_lookup(CompileCache* cache, const ByteBuffer* key, const char* kind, char* path, size_t size, off_t* payload_size) {
+    cache_entry_path(cache, hash_cache_key(key), kind, path, size);
+    int fd = open(path, O_RDONLY | O_NOFOLLOW);
+    *payload_size = fd >= 0 ? cache_check_key(fd, key) : -1;
+    if (*payload_size < 0) {
+        if (fd >= 0) close(fd); // Another key with the same hash; ours replaces it
+        cache->misses++;
+        return -1;
+    }
+    futimens(fd, NULL);
+    cache->hits++;
+    return fd;
+}
+
+// Read a bytecode artifact from a cache_lookup hit; NULL if it is corrupt
+CodeModule* cache_read_code_module(int fd, off_t payload_size) {
+    uint8_t* data = malloc((size_t)payload_size);
+    CodeModule* module = NULL;
+    if (data && pread(fd, data, (size_t)payload_size, 0) == (ssize_t)payload_size) {
+        module = deserialize_code_module(data, (size_t)payload_size);
+    }
+    free(data);
+    close(fd);
+    return module;
+}
+
+int compare_cache_entries(const void* a, const void* b) {
+    time_t left = ((const CacheEntry*)a)->last_used;
+    time_t right = ((const CacheEntry*)b)->last_used;
+    return (left > right) - (left < right);
+}
+
+// Drop least recently used artifacts until the directory fits its budget
+void cache_evict(CompileCache* cache) {
+    char path[CACHE_PATH_SIZE];
+    snprintf(path, sizeof(path), "%s/.lock", cache->directory);
+    int lock = open(path, O_CREAT | O_RDWR | O_NOFOLLOW, 0600);
+    if (lock < 0) return;
+    if (flock(lock, LOCK_EX | LOCK_NB) != 0) {
+        close(lock); // Another process is already evicting
+        return;
+    }
+
+    DIR* directory = opendir(cache->directory);
+    CacheEntry* entries = NULL;
+    size_t count = 0, capacity = 0;
+    uint64_t total = 0;
+    struct dirent* dirent;
+    while (directory && (dirent = readdir(directory))) {
+        struct stat info;
+        if (dirent->d_name[0] != 'v' || strlen(dirent->d_name) >= sizeof(entries->name)) continue;
+        snprintf(path, sizeof(path), "%s/%s", cache->directory, dirent->d_name);
+        if (stat(path, &info) != 0 || !S_ISREG(info.st_mode)) continue;
+
+        entries = grow_array(entries, &capacity, count + 1, sizeof(CacheEntry));
+        strcpy(entries[count].name, dirent->d_name);
+        entries[count].size = info.st_size;
+        entries[count].last_used = info.st_mtime;
+        total += (uint64_t)info.st_size;
+        count++;
+    }
+    if (directory) closedir(directory);
+
+    if (total > cache->budget) {
+        qsort(entries, count, sizeof(CacheEntry), compare_cache_entries);
+        for (size_t i = 0; i < count && total > cache->budget; i++) {
+            snprintf(path, sizeof(path), "%s/%s", cache->directory, entries[i].name);
+            if (unlink(path) == 0) total -= (uint64_t)entries[i].size;
+        }
+    }
+
+    free(entries);
+    flock(lock, LOCK_UN);
+    close(lock);
+}
+
+// Append the key to a finished artifact and move it into place under the key's hash
+int cache_publish(CompileCache* cache, const char* temp_path, const ByteBuffer* key, const char* kind) {
+    char path[CACHE_PATH_SIZE];
+    cache_entry_path(cache, hash_cache_key(key), kind, path, sizeof(path));
+    if (!cache_append_key(temp_path, key) || rename(temp_path, path) != 0) {
+        unlink(temp_path);
+        return 0;
+    }
+    cache_evict(cache);
+    return 1;
+}
+
+void patch_u16(ByteBuffer* buffer, size_t offset, uint16_t value) {
+    buffer->data[offset] = value & 0xFF;
+    buffer->data[offset + 1] = value >> 8;
+}
+
+// Copy functions 1.. of a fragment module into module, remapping constant
+// and symbol operands into the module's pools. The fragment's pools are
+// replayed in their own order, which is the order compile_module would
+// have added those entries while emitting the definition, nested ones
+// included, so the linked module has the same bytes as a serial compile.
+void link_fragment(CodeModule* module, CodeModule* fragment) {
+    uint16_t* constant_map = malloc(sizeof(uint16_t) * (fragment->constant_count ? fragment->constant_count : 1));
+    uint16_t* symbol_map = malloc(sizeof(uint16_t) * (fragment->symbol_count ? fragment->symbol_count : 1));
+    if (!constant_map || !symbol_map) {
+        fprintf(stderr, "Out of memory linking a fragment\n");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t f = 1; f < fragment->function_count; f++) {
+        if (find_code_object(module, fragment->functions[f].name) >= 0) {
+            fprintf(stderr, "Function '%s' defined twice in one module!\n", fragment->functions[f].name);
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (size_t k = 0; k < fragment->constant_count; k++) constant_map[k] = add_constant(module, fragment->constants[k]);
+    for (size_t s = 0; s < fragment->symbol_count; s++) symbol_map[s] = intern_symbol(module, fragment->symbols[s]);
+
+    for (size_t f = 1; f < fragment->function_count; f++) {
+        CodeObject* source = &fragment->functions[f];
+        CodeObject* code = add_code_object(module, source->name);
+        code->arg_count = source->arg_count;
+        code->local_count = source->local_count;
+        code->local_names = malloc(sizeof(char*) * (source->local_count ? source->local_count : 1));
+        for (uint16_t i = 0; i < source->local_count; i++) code->local_names[i] = strdup(source->local_names[i]);
+        code->code.data = malloc(source->code.size ? source->code.size : 1);
+        code->code.size = code->code.capacity = source->code.size;
+        memcpy(code->code.data, source->code.data, source->code.size);
+
+        for (size_t pc = 0; pc < code->code.size; pc += opcode_sizes[code->code.data[pc]]) {
+            uint8_t op = code->code.data[pc];
+            if (op == OP_PUSH_CONST) {
+                patch_u16(&code->code, pc + 1, constant_map[read_u16(code->code.data + pc + 1)]);
+            } else if (op == OP_CALL || op == OP_TAIL_CALL) {
+                patch_u16(&code->code, pc + 1, symbol_map[read_u16(code->code.data + pc + 1)]);
+            }
+        }
+    }
+    free(constant_map);
+    free(symbol_map);
+}
+
+// Bytecode for one definition: "<main>" plus the function and anything nested in it
+CodeModule* cached_definition_fragment(CompileCache* cache, ASTNode* def) {
+    char path[CACHE_PATH_SIZE];
+    ByteBuffer key = { NULL, 0, 0 };
+    off_t payload_size;
+    int cacheable = build_cache_key(&key, CACHE_KEY_DEFINITION, def);
+
+    int fd = cacheable ? cache_lookup(cache, &key, "ubc", path, sizeof(path), &payload_size) : -1;
+    CodeModule* fragment = fd >= 0 ? cache_read_code_module(fd, payload_size) : NULL;
+    if (!fragment) { // A corrupt entry falls through and is overwritten
+        fragment = compile_module(def);
+        if (cacheable) {
+            char temp[CACHE_PATH_SIZE];
+            cache_temp_path(cache, hash_cache_key(&key), temp, sizeof(temp));
+            if (write_code_module(fragment, temp)) cache_publish(cache, temp, &key, "ubc");
+            else unlink(temp);
+        }
+    }
+    free(key.data);
+    return fragment;
+}
+
+// Like compile_module, but top-level definitions come from the cache
+CodeModule* cached_compile_module(CompileCache* cache, ASTNode* root) {
+    char path[CACHE_PATH_SIZE];
+    ByteBuffer key = { NULL, 0, 0 };
+    off_t payload_size;
+    int cacheable = build_cache_key(&key, CACHE_KEY_PROGRAM, root);
+    int fd = cacheable ? cache_lookup(cache, &key, "ubc", path, sizeof(path), &payload_size) : -1;
+    if (fd >= 0) {
+        CodeModule* module = cache_read_code_module(fd, payload_size);
+        if (module) {
+            free(key.data);
+            return module;
+        }
+    }
+
+    CodeModule* module = create_code_module();
+    add_code_object(module, "<main>");
+    Emitter emitter = { module, &module->functions[0], 0, root };
+
+    size_t count = root && root->type == NODE_BLOCK ? root->block.size : 1;
+    for (size_t i = 0; i < count; i++) {
+        ASTNode* statement = root && root->type == NODE_BLOCK ? root->block.statements[i] : root;
+        if (statement && statement->type == NODE_FUNCTION_DEF) {
+            CodeModule* fragment = cached_definition_fragment(cache, statement);
+            link_fragment(module, fragment);
+            free_code_module(fragment);
+            emitter.code = &module->functions[0]; // 'functions' may have moved
+        } else {
+            emit_statement(&emitter, statement);
+        }
+    }
+    emit_op(&emitter, OP_HALT);
+
+    if (cacheable) {
+        char temp[CACHE_PATH_SIZE];
+        cache_temp_path(cache, hash_cache_key(&key), temp, sizeof(temp));
+        if (write_code_module(module, temp)) cache_publish(cache, temp, &key, "ubc");
+        else unlink(temp);
+    }
+    free(key.data);
+    return module;
+}
+
+// Load a native artifact from a cache_lookup hit. NULL if it was evicted
+// or replaced after its key was checked, so the caller compiles it again.
+AotModule* cache_load_native_module(int fd, const char* path) {
+    struct stat checked, loaded;
+    AotModule* module = aot_try_load_module(path);
+    if (module && (fstat(fd, &checked) != 0 || stat(path, &loaded) != 0 ||
+                   checked.st_dev != loaded.st_dev || checked.st_ino != loaded.st_ino)) {
+        aot_unload_module(module);
+        module = NULL;
+    }
+    close(fd);
+    return module;
+}
+
+// Native modules are whole-program, so they are keyed by the whole root
+AotModule* cached_aot_compile_module(CompileCache* cache, ASTNode* root) {
+    char path[CACHE_PATH_SIZE];
+    ByteBuffer key = { NULL, 0, 0 };
+    off_t payload_size;
+    int cacheable = build_cache_key(&key, CACHE_KEY_PROGRAM, root);
+    int fd = cacheable ? cache_lookup(cache, &key, "so", path, sizeof(path), &payload_size) : -1;
+    AotModule* module = fd >= 0 ? cache_load_native_module(fd, path) : NULL;
+    if (module) {
+        free(key.data);
+        return module;
+    }
+    if (fd >= 0) { // Evicted or unloadable after all
+        cache->hits--;
+        cache->misses++;
+    }
+
+    char temp[CACHE_PATH_SIZE];
+    cache_temp_path(cache, hash_cache_key(&key), temp, sizeof(temp));
+    module = aot_compile_module(root, temp);   // Leaves temp.so
+
+    char artifact[CACHE_PATH_SIZE];
+    snprintf(artifact, sizeof(artifact), "%s.so", temp);
+    if (cacheable) {
+        cache_publish(cache, artifact, &key, "so");    // The loaded mapping survives the append and rename
+    } else {
+        unlink(artifact);
+    }
+    free(key.data);
+    return module;
+}
+
+int main() {
+    const char* source_code =
+        "function square(x) { return x * x; }"
+        "function cube(x) { return x * square(x); }"
+        "print(square(7), cube(3));";
+    Lexer* lexer = create_lexer(source_code);
+    Parser* parser = create_parser(lexer);
+
+    ASTNode* root = parse_block(parser);
+    CompileCache* cache = open_compile_cache(NULL, 0);
+    if (!cache) return 1;
+
+    // A second run of this program, or any program sharing square or cube, hits the cache
+    CodeModule* module = cached_compile_module(cache, root);
+    disassemble_module(module, stdout);
+    printf("cache: %zu hits, %zu misses\n", cache->hits, cache->misses);
+
+    free_code_module(module);
+    free(cache);
+    return 0;
+}
@@ -0,0 +1,416 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+// Escape analysis for node and function bodies.
+//
+// Finds the allocation sites inside a body (string literals, '+' and calls
+// to allocating builtins) whose value provably dies when the call returns,
+// and records them in the frame_local_sites set. The tree itself is not
+// changed, so every interpreter and emitter keeps working on it. The frame
+// interpreter (Call Stack.c) asks site_is_frame_local and allocates those
+// values in the frame's region, which pop_frame frees.
+//
+// A concatenation may keep references to its operands, so they escape
+// with the result. Names a nested function reads or writes live on in its
+// closure and escape as well.
+#define MAX_ESCAPE_VARIABLES 256
+#define MAX_ESCAPE_SITES 256
+#define MAX_ESCAPE_FUNCTIONS 256
+
+// Builtins that return a freshly allocated object
+const char* allocating_builtins[] = { "link", "packetize", "checkpoint", "array", NULL };
+
+// Per-function summary used at call sites: does argument i escape the callee?
+typedef struct {
+    char* name;
+    size_t arg_count;
+    int* param_escapes;
+} EscapeSummary;
+
+typedef struct {
+    EscapeSummary summaries[MAX_ESCAPE_FUNCTIONS];
+    size_t count;
+} EscapeSummaryTable;
+
+EscapeSummaryTable escape_summaries = { .count = 0 };
+
+// Open-addressed set of the allocation sites that never escape their call
+typedef struct {
+    ASTNode** sites;
+    size_t count;
+    size_t capacity;            // Power of two
+} SiteSet;
+
+SiteSet frame_local_sites = { NULL, 0, 0 };
+
+size_t site_slot(ASTNode** sites, size_t capacity, ASTNode* site) {
+    size_t slot = ((uintptr_t)site >> 4) * 0x9E3779B97F4A7C15ULL & (capacity - 1);
+    while (sites[slot] && sites[slot] != site) slot = (slot + 1) & (capacity - 1);
+    return slot;
+}
+
+void add_frame_local_site(ASTNode* site) {
+    SiteSet* set = &frame_local_sites;
+    if ((set->count + 1) * 2 > set->capacity) {
+        size_t capacity = set->capacity ? set->capacity * 2 : 64;
+        ASTNode** sites = calloc(capacity, sizeof(ASTNode*));
+        if (!sites) {
+            fprintf(stderr, "Out of memory recording escape results!\n");
+            exit(EXIT_FAILURE);
+        }
+        for (size_t i = 0; i < set->capacity; i++) {
+            if (set->sites[i]) sites[site_slot(sites, capacity, set->sites[i])] = set->sites[i];
+        }
+        free(set->sites);
+        set->sites = sites;
+        set->capacity = capacity;
+    }
+    size_t slot = site_slot(set->sites, set->capacity, site);
+    if (!set->sites[slot]) {
+        set->sites[slot] = site;
+        set->count++;
+    }
+}
+
+// Whether the value built at 'site' dies when its call returns
+int site_is_frame_local(ASTNode* site) {
+    SiteSet* set = &frame_local_sites;
+    return set->capacity && set->sites[site_slot(set->sites, set->capacity, site)] == site;
+}
+
+// Locals of the body being analysed. Variables that may hold the same object
+// share a class (union-find), and escaping is tracked per class.
+typedef struct {
+    char* names[MAX_ESCAPE_VARIABLES];
+    int parent[MAX_ESCAPE_VARIABLES];
+    int escapes[MAX_ESCAPE_VARIABLES];
+    size_t count;
+
+    ASTNode* sites[MAX_ESCAPE_SITES];   // Allocation sites seen in the body
+    int site_owner[MAX_ESCAPE_SITES];   // Variable the site was stored into, -1 if none
+    int site_escapes[MAX_ESCAPE_SITES]; // Escapes directly (returned, passed on)
+    size_t site_count;
+} EscapeState;
+
+int is_allocating_builtin(const char* name) {
+    for (size_t i = 0; allocating_builtins[i]; i++) {
+        if (strcmp(allocating_builtins[i], name) == 0) return 1;
+    }
+    return 0;
+}
+
+int is_allocation_site(ASTNode* node) {
+    if (!node) return 0;
+    if (node->type == NODE_STRING) return 1;
+    if (node->type == NODE_BINARY_EXPR) return node->binary.op == '+';
+    return (node->type == NODE_FUNCTION_CALL || node->type == NODE_NATIVE_CALL) &&
+           is_allocating_builtin(node->function_call.function_name);
+}
+
+EscapeSummary* find_escape_summary(const char* name) {
+    for (size_t i = 0; i < escape_summaries.count; i++) {
+        if (strcmp(escape_summaries.summaries[i].name, name) == 0) {
+            return &escape_summaries.summaries[i];
+        }
+    }
+    return NULL;
+}
+
+int escape_variable(EscapeState* state, const char* name) {
+    for (size_t i = 0; i < state->count; i++) {
+        if (strcmp(state->names[i], name) == 0) return (int)i;
+    }
+    if (state->count >= MAX_ESCAPE_VARIABLES) return -1;
+    state->names[state->count] = (char*)name;
+    state->parent[state->count] = (int)state->count;
+    state->escapes[state->count] = 0;
+    return (int)state->count++;
+}
+
+int escape_class(EscapeState* state, int variable) {
+    while (state->parent[variable] != variable) {
+        state->parent[variable] = state->parent[state->parent[variable]];
+        variable = state->parent[variable];
+    }
+    return variable;
+}
+
+void merge_escape_classes(EscapeState* state, int a, int b) {
+    a = escape_class(state, a);
+    b = escape_class(state, b);
+    if (a == b) return;
+    state->parent[b] = a;
+    state->escapes[a] |= state->escapes[b];
+}
+
+int record_allocation_site(EscapeState* state, ASTNode* node) {
+    for (size_t i = 0; i < state->site_count; i++) {
+        if (state->sites[i] == node) return (int)i;
+    }
+    if (state->site_count >= MAX_ESCAPE_SITES) return -1;
+    state->sites[state->site_count] = node;
+    state->site_owner[state->site_count] = -1;
+    state->site_escapes[state->site_count] = 0;
+    return (int)state->site_count++;
+}
+
+// 'value' flows somewhere we can't follow (return, unknown callee, output)
+void mark_value_escapes(EscapeState* state, ASTNode* value) {
+    if (!value) return;
+
+    if (value->type == NODE_IDENTIFIER) {
+        int variable = escape_variable(state, value->identifier);
+        if (variable >= 0) state->escapes[escape_class(state, variable)] = 1;
+    } else if (is_allocation_site(value)) {
+        int site = record_allocation_site(state, value);
+        if (site >= 0) state->site_escapes[site] = 1;
+    }
+}
+
+void analyse_escapes(EscapeState* state, ASTNode* node);
+
+// Every name a nested function reads or assigns outlives this call
+void mark_captured_names(EscapeState* state, ASTNode* node) {
+    if (!node) return;
+
+    switch (node->type) {
+        case NODE_IDENTIFIER:
+            mark_value_escapes(state, node);
+            break;
+        case NODE_ASSIGNMENT: {
+            int variable = escape_variable(state, node->assignment.identifier);
+            if (variable >= 0) state->escapes[escape_class(state, variable)] = 1;
+            mark_captured_names(state, node->assignment.value);
+            break;
+        }
+        case NODE_BINARY_EXPR:
+            mark_captured_names(state, node->binary.left);
+            mark_captured_names(state, node->binary.right);
+            break;
+        case NODE_FUNCTION_CALL:
+        case NODE_TAIL_CALL:
+        case NODE_NATIVE_CALL:
+            for (size_t i = 0; i < node->function_call.arg_count; i++) {
+                mark_captured_names(state, node->function_call.arguments[i]);
+            }
+            break;
+        case NODE_FUNCTION_DEF:
+            mark_captured_names(state, node->function_def.body);
+            break;
+        case NODE_RETURN:
+            mark_captured_names(state, node->return_node.value);
+            break;
+        case NODE_IF:
+            mark_captured_names(state, node->if_node.condition);
+            mark_captured_names(state, node->if_node.then_branch);
+            mark_captured_names(state, node->if_node.else_branch);
+            break;
+        case NODE_WHILE:
+            mark_captured_names(state, node->while_node.condition);
+            mark_captured_names(state, node->while_node.body);
+            break;
+        case NODE_BLOCK:
+            for (size_t i = 0; i < node->block.size; i++) {
+                mark_captured_names(state, node->block.statements[i]);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+// Arguments escape unless the callee's summary proves otherwise
+void analyse_call_arguments(EscapeState* state, ASTNode* call) {
+    EscapeSummary* summary = find_escape_summary(call->function_call.function_name);
+    int reads_only = strcmp(call->function_call.function_name, "print") == 0;
+
+    for (size_t i = 0; i < call->function_call.arg_count; i++) {
+        ASTNode* arg = call->function_call.arguments[i];
+        analyse_escapes(state, arg);
+        if (reads_only) continue;
+        if (summary && i < summary->arg_count && !summary->param_escapes[i]) continue;
+        // Allocating builtins may keep references to their inputs in the result
+        mark_value_escapes(state, arg);
+    }
+}
+
+void analyse_escapes(EscapeState* state, ASTNode* node) {
+    if (!node) return;
+
+    switch (node->type) {
+        case NODE_STRING:
+            record_allocation_site(state, node);
+            break;
+        case NODE_FUNCTION_CALL:
+        case NODE_TAIL_CALL:
+        case NODE_NATIVE_CALL:
+            analyse_call_arguments(state, node);
+            if (node->type == NODE_TAIL_CALL) {
+                // The frame is reused by the callee, so arguments outlive this call
+                for (size_t i = 0; i < node->function_call.arg_count; i++) {
+                    mark_value_escapes(state, node->function_call.arguments[i]);
+                }
+            }
+            if (is_allocating_builtin(node->function_call.function_name)) {
+                record_allocation_site(state, node);
+            }
+            break;
+        case NODE_BINARY_EXPR:
+            analyse_escapes(state, node->binary.left);
+            analyse_escapes(state, node->binary.right);
+            if (node->binary.op == '+') {
+                // The result may share its operands; other operators only read them
+                record_allocation_site(state, node);
+                mark_value_escapes(state, node->binary.left);
+                mark_value_escapes(state, node->binary.right);
+            }
+            break;
+        case NODE_FUNCTION_DEF:
+            mark_captured_names(state, node->function_def.body);
+            break;
+        case NODE_ASSIGNMENT: {
+            ASTNode* value = node->assignment.value;
+            analyse_escapes(state, value);
+            int target = escape_variable(state, node->assignment.identifier);
+            if (target < 0) {
+                mark_value_escapes(state, value);
+            } else if (value->type == NODE_IDENTIFIER) {
+                int source = escape_variable(state, value->identifier);
+                if (source < 0) {
+                    state->escapes[escape_class(state, target)] = 1;
+                } else {
+                    merge_escape_classes(state, target, source);
+                }
+            } else if (is_allocation_site(value)) {
+                int site = record_allocation_site(state, value);
+                if (site >= 0) {
+                    if (state->site_owner[site] >= 0) {
+                        merge_escape_classes(state, target, state->site_owner[site]);
+                    }
+                    state->site_owner[site] = target;
+                }
+            }
+            break;
+        }
+        case NODE_RETURN:
+            analyse_escapes(state, node->return_node.value);
+            mark_value_escapes(state, node->return_node.value);
+            break;
+        case NODE_IF:
+            analyse_escapes(state, node->if_node.condition);
+            analyse_escapes(state, node->if_node.then_branch);
+            analyse_escapes(state, node->if_node.else_branch);
+            break;
+        case NODE_WHILE:
+            analyse_escapes(state, node->while_node.condition);
+            analyse_escapes(state, node->while_node.body);
+            break;
+        case NODE_BLOCK:
+            for (size_t i = 0; i < node->block.size; i++) {
+                analyse_escapes(state, node->block.statements[i]);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+int allocation_site_escapes(EscapeState* state, int site) {
+    if (state->site_escapes[site]) return 1;
+    int owner = state->site_owner[site];
+    return owner >= 0 && state->escapes[escape_class(state, owner)];
+}
+
+// Analyse one function body. Loops: values stored in variables that survive
+// the loop are still frame-local, so no special casing is needed. Returns 1 if
+// the function's summary changed.
+int analyse_function_escapes(ASTNode* def, int record) {
+    EscapeState* state = (EscapeState*)calloc(1, sizeof(EscapeState));
+    for (size_t i = 0; i < def->function_def.arg_count; i++) {
+        escape_variable(state, def->function_def.parameters[i]);
+    }
+    analyse_escapes(state, def->function_def.body);
+
+    EscapeSummary* summary = find_escape_summary(def->function_def.function_name);
+    if (!summary && escape_summaries.count < MAX_ESCAPE_FUNCTIONS) {
+        summary = &escape_summaries.summaries[escape_summaries.count++];
+        summary->name = def->function_def.function_name;
+        summary->arg_count = def->function_def.arg_count;
+        summary->param_escapes = calloc(summary->arg_count ? summary->arg_count : 1, sizeof(int));
+        // Start optimistic; the fixpoint only ever adds escapes
+    }
+
+    int changed = 0;
+    if (summary) {
+        for (size_t i = 0; i < summary->arg_count; i++) {
+            int escapes = state->escapes[escape_class(state, (int)i)];
+            if (escapes && !summary->param_escapes[i]) {
+                summary->param_escapes[i] = 1;
+                changed = 1;
+            }
+        }
+    }
+
+    if (record) {
+        for (size_t i = 0; i < state->site_count; i++) {
+            if (!allocation_site_escapes(state, (int)i)) add_frame_local_site(state->sites[i]);
+        }
+    }
+
+    free(state);
+    return changed;
+}
+
+void collect_function_definitions(ASTNode* node, ASTNode** defs, size_t* count) {
+    if (!node) return;
+    if (node->type == NODE_FUNCTION_DEF && *count < MAX_ESCAPE_FUNCTIONS) {
+        defs[(*count)++] = node;
+    } else if (node->type == NODE_BLOCK) {
+        for (size_t i = 0; i < node->block.size; i++) {
+            collect_function_definitions(node->block.statements[i], defs, count);
+        }
+    }
+}
+
+// Entry point: iterate summaries to a fixpoint (recursion makes them
+// mutually dependent), then record the non-escaping allocation sites.
+void escape_analysis_program(ASTNode* root) {
+    ASTNode* defs[MAX_ESCAPE_FUNCTIONS];
+    size_t count = 0;
+    collect_function_definitions(root, defs, &count);
+
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        for (size_t i = 0; i < count; i++) {
+            changed |= analyse_function_escapes(defs[i], 0);
+        }
+    }
+    for (size_t i = 0; i < count; i++) {
+        analyse_function_escapes(defs[i], 1);
+    }
+}
+
+int main() {
+    const char* source_code =
+        "function greet(n) { label = \"temporary\"; copy = label; print(n); return n; }"
+        "function keep(n) { name = \"kept\"; return name; }"
+        "{ greet(1); keep(2); }";
+    Lexer* lexer = create_lexer(source_code);
+    Parser* parser = create_parser(lexer);
+
+    ASTNode* root = parse_block(parser);
+    escape_analysis_program(root);
+
+    // "temporary" dies with greet's frame; "kept" is returned and must live on the GC heap
+    for (size_t i = 0; i < root->block.size; i++) {
+        ASTNode* def = root->block.statements[i];
+        if (def->type != NODE_FUNCTION_DEF) continue;
+        ASTNode* first = def->function_def.body->block.statements[0];
+        printf("%s: \"%s\" is %s\n", def->function_def.function_name, first->assignment.value->string_value,
+               site_is_frame_local(first->assignment.value) ? "frame-local" : "escaping");
+    }
+    return 0;
+}
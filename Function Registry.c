@@ -0,0 +1,216 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+// A growable, hash-indexed function table plus a monomorphic inline cache
+// at every call site.
+//
+// Functions are allocated one at a time, so a Function* stays valid as the
+// table grows. A SwissIndex on the name hash replaces the linear
+// find_function scan (see Runtime Environment.c for the index). A call
+// site's name never changes, so its cache can only go stale when that name
+// is redefined. A definition node gets its Function the first time it runs
+// and keeps it on the node; running it again (a nested definition on every
+// call of its parent) only points the name back at that Function. The
+// table's epoch moves only when a name really changes meaning: a new
+// definition of an existing name, or a name switching between two
+// definitions. A cache is valid only while its epoch matches, so such a
+// change invalidates every call site at once. Replaced Functions are kept,
+// because frames may still be running them. Redefinitions are rare, so
+// flushing everything is cheaper than keeping per-name versions.
+
+// Modify the function structure: each registration gets its own index
+typedef struct Function {
+    char* name;
+    char** arguments;
+    size_t arg_count;
+    ASTNode* body;
+    uint32_t index;             // Registration order, for per-function side tables
+} Function;
+
+typedef struct {
+    Function* target;
+    uint32_t epoch;             // FunctionTable epoch the entry was filled in
+} InlineCache;
+
+// Modify the ASTNode structure so call sites carry an inline cache and
+// definitions the Function they registered
+typedef struct ASTNode {
+    ASTNodeType type;
+    union {
+        // Other node types...
+        struct {
+            char* function_name;
+            ASTNode** arguments;
+            size_t arg_count;
+            InlineCache cache;
+        } function_call;
+        struct {
+            char* function_name;
+            char** parameters;
+            size_t arg_count;
+            ASTNode* body;
+            Function* function;     // NULL until the definition first runs
+        } function_def;
+    };
+} ASTNode;
+
+// Modify the function table: growable and hash-indexed
+typedef struct {
+    Function** functions;       // Registration order, including replaced definitions
+    size_t func_count;
+    size_t capacity;
+    SwissIndex index;           // Name hash -> current definition
+    uint32_t epoch;             // Bumped on every redefinition
+} FunctionTable;
+
+FunctionTable function_table = { NULL, 0, 0, { NULL, NULL, 0 }, 1 };
+
+// Position in the index of the current definition of 'name', or -1
+long find_function_slot(const char* name, uint64_t hash) {
+    SwissIndex* index = &function_table.index;
+    if (!index->capacity) return -1;
+    int8_t tag = hash_tag(hash);
+    size_t mask = index->capacity - 1;
+    size_t position = (size_t)hash & mask;
+    for (size_t stride = GROUP_WIDTH;; stride += GROUP_WIDTH) {
+        const int8_t* group = index->control + position;
+        for (uint32_t match = group_match(group, tag); match; match &= match - 1) {
+            size_t slot = (position + __builtin_ctz(match)) & mask;
+            if (strcmp(function_table.functions[index->slots[slot]]->name, name) == 0) return (long)slot;
+        }
+        if (group_match(group, CONTROL_EMPTY)) return -1;
+        position = (position + stride) & mask;
+    }
+}
+
+Function* find_function(const char* name) {
+    long slot = find_function_slot(name, hash_name(name));
+    return slot < 0 ? NULL : function_table.functions[function_table.index.slots[slot]];
+}
+
+Function* create_function(const char* name, char** arguments, size_t arg_count, ASTNode* body) {
+    if (function_table.func_count == UINT32_MAX) {
+        fprintf(stderr, "Maximum number of functions reached!\n");
+        exit(EXIT_FAILURE);
+    }
+    if (function_table.func_count == function_table.capacity) {
+        function_table.capacity = function_table.capacity ? function_table.capacity * 2 : 64;
+        function_table.functions = realloc(function_table.functions, sizeof(Function*) * function_table.capacity);
+    }
+    Function* func = malloc(sizeof(Function));
+    if (!func || !function_table.functions) {
+        fprintf(stderr, "Out of memory registering function '%s'\n", name);
+        exit(EXIT_FAILURE);
+    }
+    func->name = strdup(name);
+    func->arguments = arguments;
+    func->arg_count = arg_count;
+    func->body = body;
+    func->index = (uint32_t)function_table.func_count;
+    function_table.functions[function_table.func_count++] = func;
+
+    uint64_t hash = hash_name(name);
+    long slot = find_function_slot(name, hash);
+    if (slot >= 0) {
+        // Redefinition: point the name at the new body and drop every cached target
+        function_table.index.slots[slot] = func->index;
+        function_table.epoch++;
+        return func;
+    }
+
+    size_t live = function_table.func_count; // Upper bound on indexed names
+    if (live * 8 > function_table.index.capacity * 7) {
+        SwissIndex old = function_table.index;
+        init_swiss_index(&function_table.index, old.capacity ? old.capacity * 2 : MIN_INDEX_CAPACITY * 4);
+        for (size_t i = 0; i < old.capacity; i++) {
+            if (old.control[i] == CONTROL_EMPTY) continue;
+            Function* existing = function_table.functions[old.slots[i]];
+            insert_index(&function_table.index, hash_name(existing->name), existing->index);
+        }
+        free(old.control);
+        free(old.slots);
+    }
+    insert_index(&function_table.index, hash, func->index);
+    return func;
+}
+
+// Run a definition: register it the first time, afterwards just make its
+// name refer to it again. No allocation, and no epoch bump unless the name
+// was bound to another definition in between.
+Function* define_function(ASTNode* def) {
+    Function* function = def->function_def.function;
+    if (!function) {
+        function = create_function(def->function_def.function_name, def->function_def.parameters, def->function_def.arg_count, def->function_def.body);
+        def->function_def.function = function;
+        return function;
+    }
+
+    long slot = find_function_slot(function->name, hash_name(function->name));
+    if (function_table.index.slots[slot] != function->index) {
+        function_table.index.slots[slot] = function->index;
+        function_table.epoch++;
+    }
+    return function;
+}
+
+// The callee of a call site: the cached target while no function has been
+// redefined since the cache was filled, otherwise one index probe. NULL
+// when the name is undefined; undefined names aren't cached.
+Function* resolve_call_site(ASTNode* call) {
+    InlineCache* cache = &call->function_call.cache;
+    if (cache->epoch == function_table.epoch) return cache->target;
+
+    Function* function = find_function(call->function_call.function_name);
+    if (function) {
+        cache->target = function;
+        cache->epoch = function_table.epoch;
+    }
+    return function;
+}
+
+// Modify call node creation so the cache starts out empty
+ASTNode* create_function_call_node(const char* name, ASTNode** arguments, size_t arg_count) {
+    ASTNode* node = (ASTNode*)calloc(1, sizeof(ASTNode));
+    node->type = NODE_FUNCTION_CALL;
+    node->function_call.function_name = strdup(name);
+    node->function_call.arguments = arguments;
+    node->function_call.arg_count = arg_count;
+    return node;
+}
+
+// Modify definition node creation so no Function is registered yet
+ASTNode* create_function_def_node(const char* name, char** params, size_t param_count, ASTNode* body) {
+    ASTNode* node = (ASTNode*)calloc(1, sizeof(ASTNode));
+    node->type = NODE_FUNCTION_DEF;
+    node->function_def.function_name = strdup(name);
+    node->function_def.parameters = params;
+    node->function_def.arg_count = param_count;
+    node->function_def.body = body;
+    return node;
+}
+
+// Modify stdlib setup: create_function already registers the builtin
+void initialize_stdlib() {
+    static char* print_arguments[] = { "value" };
+    create_function("print", print_arguments, 1, NULL);
+}
+
+int main() {
+    const char* source_code =
+        "function f(x) { return x + 1; }"
+        "i = 0; total = 0;"
+        "while (i < 1000) { total = total + f(i); i = i + 1; }"
+        "function f(x) { return x * 2; }"
+        "print(total, f(21));";
+    Lexer* lexer = create_lexer(source_code);
+    Parser* parser = create_parser(lexer);
+
+    initialize_stdlib();
+    ASTNode* root = parse_block(parser);
+    mark_program_tail_calls(root);
+    frame_run_program(root); // Call sites cache 'f' until it is redefined
+    printf("%zu definitions, epoch %u\n", function_table.func_count, function_table.epoch);
+    return 0;
+}
@@ -0,0 +1,519 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+// Cost model for inlining small node and function bodies at their call sites.
+// Every call otherwise pays for find_function, a fresh RuntimeEnvironment and
+// one set_variable per argument, which dominates graphs made of tiny nodes.
+#define INLINE_COST_THRESHOLD 24   // Largest body (weighted AST size) considered "small"
+#define INLINE_CALL_OVERHEAD 8     // Cost credited for the call we remove
+#define INLINE_GROWTH_BUDGET 4096  // Total AST growth allowed per program
+#define INLINE_MAX_DEPTH 4         // Nested inlining limit (inlined bodies are re-scanned)
+#define MAX_INLINE_CANDIDATES 256
+
+// A node/function definition seen before execution. Definitions are collected
+// from the tree itself so inlining does not depend on function_table state.
+typedef struct {
+    char* name;
+    char** parameters;
+    size_t arg_count;
+    ASTNode* body;
+    int cost;
+    int recursive;
+    int redefined;    // Defined more than once, so the call target is ambiguous
+    int call_sites;
+} InlineCandidate;
+
+typedef struct {
+    InlineCandidate candidates[MAX_INLINE_CANDIDATES];
+    size_t count;
+    int growth;       // AST nodes added so far
+    int next_id;      // Used to give each inlined body unique local names
+} Inliner;
+
+// Identifier substitution used while cloning a body into a call site.
+// In expression mode parameters map to argument expressions; in statement mode
+// every identifier is renamed with a prefix so callee locals stay private.
+typedef struct {
+    char** names;
+    ASTNode** replacements;
+    size_t count;
+    const char* prefix;
+} Substitution;
+
+ASTNode* inline_calls(Inliner* inliner, ASTNode* node, int depth);
+
+// Weighted AST size; calls are expensive because they are never free at runtime
+int ast_cost(ASTNode* node) {
+    if (!node) return 0;
+
+    switch (node->type) {
+        case NODE_NUMBER:
+        case NODE_IDENTIFIER:
+        case NODE_STRING:
+            return 1;
+        case NODE_BINARY_EXPR:
+            return 1 + ast_cost(node->binary.left) + ast_cost(node->binary.right);
+        case NODE_ASSIGNMENT:
+            return 1 + ast_cost(node->assignment.value);
+        case NODE_IF:
+            return 2 + ast_cost(node->if_node.condition) + ast_cost(node->if_node.then_branch) + ast_cost(node->if_node.else_branch);
+        case NODE_WHILE:
+            // Loops multiply their body cost; never worth duplicating
+            return INLINE_COST_THRESHOLD + 1;
+        case NODE_RETURN:
+            return 1 + ast_cost(node->return_node.value);
+        case NODE_BLOCK: {
+            int cost = 0;
+            for (size_t i = 0; i < node->block.size; i++) {
+                cost += ast_cost(node->block.statements[i]);
+            }
+            return cost;
+        }
+        case NODE_FUNCTION_CALL: {
+            int cost = INLINE_CALL_OVERHEAD;
+            for (size_t i = 0; i < node->function_call.arg_count; i++) {
+                cost += ast_cost(node->function_call.arguments[i]);
+            }
+            return cost;
+        }
+        default:
+            // Unknown constructs are never inlined
+            return INLINE_COST_THRESHOLD + 1;
+    }
+}
+
+InlineCandidate* find_inline_candidate(Inliner* inliner, const char* name) {
+    for (size_t i = 0; i < inliner->count; i++) {
+        if (strcmp(inliner->candidates[i].name, name) == 0) {
+            return &inliner->candidates[i];
+        }
+    }
+    return NULL;
+}
+
+// Collect every function definition and count its call sites
+void collect_inline_candidates(Inliner* inliner, ASTNode* node) {
+    if (!node) return;
+
+    switch (node->type) {
+        case NODE_FUNCTION_DEF: {
+            InlineCandidate* existing = find_inline_candidate(inliner, node->function_def.function_name);
+            if (existing) {
+                existing->redefined = 1;
+            } else if (inliner->count < MAX_INLINE_CANDIDATES) {
+                InlineCandidate* candidate = &inliner->candidates[inliner->count++];
+                candidate->name = node->function_def.function_name;
+                candidate->parameters = node->function_def.parameters;
+                candidate->arg_count = node->function_def.arg_count;
+                candidate->body = node->function_def.body;
+                candidate->cost = ast_cost(node->function_def.body);
+                candidate->recursive = 0;
+                candidate->redefined = 0;
+                candidate->call_sites = 0;
+            }
+            collect_inline_candidates(inliner, node->function_def.body);
+            break;
+        }
+        case NODE_FUNCTION_CALL: {
+            InlineCandidate* candidate = find_inline_candidate(inliner, node->function_call.function_name);
+            if (candidate) candidate->call_sites++;
+            for (size_t i = 0; i < node->function_call.arg_count; i++) {
+                collect_inline_candidates(inliner, node->function_call.arguments[i]);
+            }
+            break;
+        }
+        case NODE_BINARY_EXPR:
+            collect_inline_candidates(inliner, node->binary.left);
+            collect_inline_candidates(inliner, node->binary.right);
+            break;
+        case NODE_ASSIGNMENT:
+            collect_inline_candidates(inliner, node->assignment.value);
+            break;
+        case NODE_IF:
+            collect_inline_candidates(inliner, node->if_node.condition);
+            collect_inline_candidates(inliner, node->if_node.then_branch);
+            collect_inline_candidates(inliner, node->if_node.else_branch);
+            break;
+        case NODE_WHILE:
+            collect_inline_candidates(inliner, node->while_node.condition);
+            collect_inline_candidates(inliner, node->while_node.body);
+            break;
+        case NODE_RETURN:
+            collect_inline_candidates(inliner, node->return_node.value);
+            break;
+        case NODE_BLOCK:
+            for (size_t i = 0; i < node->block.size; i++) {
+                collect_inline_candidates(inliner, node->block.statements[i]);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+// Does 'node' (transitively, through other candidates) call 'target'?
+int reaches_function(Inliner* inliner, ASTNode* node, const char* target, int* visited) {
+    if (!node) return 0;
+
+    switch (node->type) {
+        case NODE_FUNCTION_CALL: {
+            if (strcmp(node->function_call.function_name, target) == 0) return 1;
+            for (size_t i = 0; i < node->function_call.arg_count; i++) {
+                if (reaches_function(inliner, node->function_call.arguments[i], target, visited)) return 1;
+            }
+            InlineCandidate* callee = find_inline_candidate(inliner, node->function_call.function_name);
+            if (callee) {
+                size_t index = callee - inliner->candidates;
+                if (!visited[index]) {
+                    visited[index] = 1;
+                    if (reaches_function(inliner, callee->body, target, visited)) return 1;
+                }
+            }
+            return 0;
+        }
+        case NODE_BINARY_EXPR:
+            return reaches_function(inliner, node->binary.left, target, visited) ||
+                   reaches_function(inliner, node->binary.right, target, visited);
+        case NODE_ASSIGNMENT:
+            return reaches_function(inliner, node->assignment.value, target, visited);
+        case NODE_IF:
+            return reaches_function(inliner, node->if_node.condition, target, visited) ||
+                   reaches_function(inliner, node->if_node.then_branch, target, visited) ||
+                   reaches_function(inliner, node->if_node.else_branch, target, visited);
+        case NODE_WHILE:
+            return reaches_function(inliner, node->while_node.condition, target, visited) ||
+                   reaches_function(inliner, node->while_node.body, target, visited);
+        case NODE_RETURN:
+            return reaches_function(inliner, node->return_node.value, target, visited);
+        case NODE_BLOCK:
+            for (size_t i = 0; i < node->block.size; i++) {
+                if (reaches_function(inliner, node->block.statements[i], target, visited)) return 1;
+            }
+            return 0;
+        default:
+            return 0;
+    }
+}
+
+void mark_recursive_candidates(Inliner* inliner) {
+    int visited[MAX_INLINE_CANDIDATES];
+    for (size_t i = 0; i < inliner->count; i++) {
+        memset(visited, 0, sizeof(visited));
+        InlineCandidate* candidate = &inliner->candidates[i];
+        candidate->recursive = reaches_function(inliner, candidate->body, candidate->name, visited);
+    }
+}
+
+int contains_call(ASTNode* node) {
+    if (!node) return 0;
+
+    switch (node->type) {
+        case NODE_FUNCTION_CALL:
+            return 1;
+        case NODE_BINARY_EXPR:
+            return contains_call(node->binary.left) || contains_call(node->binary.right);
+        default:
+            return 0;
+    }
+}
+
+int count_uses(ASTNode* node, const char* name) {
+    if (!node) return 0;
+
+    switch (node->type) {
+        case NODE_IDENTIFIER:
+            return strcmp(node->identifier, name) == 0;
+        case NODE_BINARY_EXPR:
+            return count_uses(node->binary.left, name) + count_uses(node->binary.right, name);
+        case NODE_FUNCTION_CALL: {
+            int uses = 0;
+            for (size_t i = 0; i < node->function_call.arg_count; i++) {
+                uses += count_uses(node->function_call.arguments[i], name);
+            }
+            return uses;
+        }
+        default:
+            return 0;
+    }
+}
+
+// Returns the returned expression when the body is exactly `{ return expr; }`
+ASTNode* single_return_expression(ASTNode* body) {
+    if (!body) return NULL;
+    if (body->type == NODE_RETURN) return body->return_node.value;
+    if (body->type == NODE_BLOCK && body->block.size == 1 && body->block.statements[0]->type == NODE_RETURN) {
+        return body->block.statements[0]->return_node.value;
+    }
+    return NULL;
+}
+
+// A return is only allowed as the final top-level statement of a spliced body
+int has_nested_return(ASTNode* node) {
+    if (!node) return 0;
+
+    switch (node->type) {
+        case NODE_RETURN:
+            return 1;
+        case NODE_IF:
+            return has_nested_return(node->if_node.then_branch) || has_nested_return(node->if_node.else_branch);
+        case NODE_WHILE:
+            return has_nested_return(node->while_node.body);
+        case NODE_BLOCK:
+            for (size_t i = 0; i < node->block.size; i++) {
+                if (has_nested_return(node->block.statements[i])) return 1;
+            }
+            return 0;
+        default:
+            return 0;
+    }
+}
+
+char* substitute_name(Substitution* subst, const char* name) {
+    char* renamed = malloc(strlen(subst->prefix) + strlen(name) + 1);
+    strcpy(renamed, subst->prefix);
+    strcat(renamed, name);
+    return renamed;
+}
+
+// Deep copy of an AST subtree, applying the substitution to identifiers
+ASTNode* clone_ast(ASTNode* node, Substitution* subst) {
+    if (!node) return NULL;
+
+    ASTNode* copy = (ASTNode*)malloc(sizeof(ASTNode));
+    *copy = *node;
+
+    switch (node->type) {
+        case NODE_NUMBER:
+            copy->number_value = strdup(node->number_value);
+            break;
+        case NODE_STRING:
+            copy->string_value = strdup(node->string_value);
+            break;
+        case NODE_IDENTIFIER:
+            if (subst && subst->replacements) {
+                for (size_t i = 0; i < subst->count; i++) {
+                    if (strcmp(subst->names[i], node->identifier) == 0) {
+                        free(copy);
+                        return clone_ast(subst->replacements[i], NULL);
+                    }
+                }
+            }
+            copy->identifier = (subst && subst->prefix) ? substitute_name(subst, node->identifier) : strdup(node->identifier);
+            break;
+        case NODE_BINARY_EXPR:
+            copy->binary.left = clone_ast(node->binary.left, subst);
+            copy->binary.right = clone_ast(node->binary.right, subst);
+            break;
+        case NODE_ASSIGNMENT:
+            copy->assignment.identifier = (subst && subst->prefix) ? substitute_name(subst, node->assignment.identifier) : strdup(node->assignment.identifier);
+            copy->assignment.value = clone_ast(node->assignment.value, subst);
+            break;
+        case NODE_IF:
+            copy->if_node.condition = clone_ast(node->if_node.condition, subst);
+            copy->if_node.then_branch = clone_ast(node->if_node.then_branch, subst);
+            copy->if_node.else_branch = clone_ast(node->if_node.else_branch, subst);
+            break;
+        case NODE_WHILE:
+            copy->while_node.condition = clone_ast(node->while_node.condition, subst);
+            copy->while_node.body = clone_ast(node->while_node.body, subst);
+            break;
+        case NODE_RETURN:
+            copy->return_node.value = clone_ast(node->return_node.value, subst);
+            break;
+        case NODE_BLOCK:
+            copy->block.statements = malloc(sizeof(ASTNode*) * (node->block.size ? node->block.size : 1));
+            for (size_t i = 0; i < node->block.size; i++) {
+                copy->block.statements[i] = clone_ast(node->block.statements[i], subst);
+            }
+            break;
+        case NODE_FUNCTION_CALL:
+            // Function names are global and never renamed
+            copy->function_call.function_name = strdup(node->function_call.function_name);
+            copy->function_call.arguments = malloc(sizeof(ASTNode*) * (node->function_call.arg_count ? node->function_call.arg_count : 1));
+            for (size_t i = 0; i < node->function_call.arg_count; i++) {
+                copy->function_call.arguments[i] = clone_ast(node->function_call.arguments[i], subst);
+            }
+            break;
+        default:
+            break;
+    }
+    return copy;
+}
+
+// Decide whether a call to 'candidate' is worth inlining at this site
+int should_inline(Inliner* inliner, InlineCandidate* candidate, ASTNode* call, int depth) {
+    if (!candidate || !candidate->body) return 0;  // Builtins such as print have no body
+    if (candidate->recursive || candidate->redefined) return 0;
+    if (depth >= INLINE_MAX_DEPTH) return 0;
+    if (call->function_call.arg_count != candidate->arg_count) return 0;  // Let execute_function report it
+    if (candidate->cost > INLINE_COST_THRESHOLD) return 0;
+
+    // Single-use bodies always shrink the program; otherwise charge the growth budget
+    int growth = candidate->call_sites > 1 ? candidate->cost - INLINE_CALL_OVERHEAD : 0;
+    if (growth > 0 && inliner->growth + growth > INLINE_GROWTH_BUDGET) return 0;
+    inliner->growth += growth > 0 ? growth : 0;
+    return 1;
+}
+
+// Replace `f(args)` in expression position with the callee's return expression.
+// Arguments are substituted directly, so they must be safe to duplicate or drop.
+// An argument that makes calls ran before the whole body; substituted, it runs
+// where the parameter is used, so that's only allowed when the body makes no
+// calls of its own that could now run first.
+ASTNode* inline_expression_call(Inliner* inliner, InlineCandidate* candidate, ASTNode* call, int depth) {
+    ASTNode* expr = single_return_expression(candidate->body);
+    if (!expr) return call;
+
+    int effectful_args = 0;
+    for (size_t i = 0; i < candidate->arg_count; i++) {
+        ASTNode* arg = call->function_call.arguments[i];
+        if (contains_call(arg)) {
+            // Must be evaluated exactly once, and no reordering against another call
+            if (count_uses(expr, candidate->parameters[i]) != 1 || ++effectful_args > 1) return call;
+        }
+    }
+    if (effectful_args > 0 && contains_call(expr)) return call;
+    if (!should_inline(inliner, candidate, call, depth)) return call;
+
+    Substitution subst = { candidate->parameters, call->function_call.arguments, candidate->arg_count, NULL };
+    ASTNode* inlined = clone_ast(expr, &subst);
+    return inline_calls(inliner, inlined, depth + 1);
+}
+
+// Replace a call statement with the callee body. Parameters become assignments
+// to renamed locals so each argument is still evaluated once, in order.
+ASTNode* inline_statement_call(Inliner* inliner, InlineCandidate* candidate, ASTNode* call, int depth) {
+    ASTNode* body = candidate->body;
+    size_t statement_count = body->type == NODE_BLOCK ? body->block.size : 1;
+    ASTNode** statements = body->type == NODE_BLOCK ? body->block.statements : &body;
+
+    for (size_t i = 0; i < statement_count; i++) {
+        int is_last = i + 1 == statement_count;
+        if (is_last && statements[i]->type == NODE_RETURN) continue;
+        if (has_nested_return(statements[i])) return call;
+    }
+    if (!should_inline(inliner, candidate, call, depth)) return call;
+
+    char prefix[64];
+    snprintf(prefix, sizeof(prefix), "__inl%d_", inliner->next_id++);
+    Substitution subst = { NULL, NULL, 0, prefix };
+
+    ASTNode* block = (ASTNode*)malloc(sizeof(ASTNode));
+    block->type = NODE_BLOCK;
+    block->block.statements = malloc(sizeof(ASTNode*) * (candidate->arg_count + statement_count));
+    block->block.size = 0;
+
+    for (size_t i = 0; i < candidate->arg_count; i++) {
+        ASTNode* bind = (ASTNode*)malloc(sizeof(ASTNode));
+        bind->type = NODE_ASSIGNMENT;
+        bind->assignment.identifier = substitute_name(&subst, candidate->parameters[i]);
+        bind->assignment.value = call->function_call.arguments[i];  // Evaluated in the caller's scope
+        block->block.statements[block->block.size++] = bind;
+    }
+
+    for (size_t i = 0; i < statement_count; i++) {
+        ASTNode* statement = statements[i];
+        if (statement->type == NODE_RETURN) {
+            // Trailing return value is discarded at statement call sites
+            if (!contains_call(statement->return_node.value)) continue;
+            statement = statement->return_node.value;
+        }
+        block->block.statements[block->block.size++] = inline_calls(inliner, clone_ast(statement, &subst), depth + 1);
+    }
+    return block;
+}
+
+// Rewrite 'node' in place, returning the (possibly replaced) subtree
+ASTNode* inline_calls(Inliner* inliner, ASTNode* node, int depth) {
+    if (!node) return NULL;
+
+    switch (node->type) {
+        case NODE_FUNCTION_CALL: {
+            for (size_t i = 0; i < node->function_call.arg_count; i++) {
+                node->function_call.arguments[i] = inline_calls(inliner, node->function_call.arguments[i], depth);
+            }
+            InlineCandidate* candidate = find_inline_candidate(inliner, node->function_call.function_name);
+            return candidate ? inline_expression_call(inliner, candidate, node, depth) : node;
+        }
+        case NODE_BINARY_EXPR:
+            node->binary.left = inline_calls(inliner, node->binary.left, depth);
+            node->binary.right = inline_calls(inliner, node->binary.right, depth);
+            break;
+        case NODE_ASSIGNMENT:
+            node->assignment.value = inline_calls(inliner, node->assignment.value, depth);
+            break;
+        case NODE_IF:
+            node->if_node.condition = inline_calls(inliner, node->if_node.condition, depth);
+            node->if_node.then_branch = inline_calls(inliner, node->if_node.then_branch, depth);
+            node->if_node.else_branch = inline_calls(inliner, node->if_node.else_branch, depth);
+            break;
+        case NODE_WHILE:
+            node->while_node.condition = inline_calls(inliner, node->while_node.condition, depth);
+            node->while_node.body = inline_calls(inliner, node->while_node.body, depth);
+            break;
+        case NODE_RETURN:
+            node->return_node.value = inline_calls(inliner, node->return_node.value, depth);
+            break;
+        case NODE_FUNCTION_DEF:
+            node->function_def.body = inline_calls(inliner, node->function_def.body, depth);
+            break;
+        case NODE_BLOCK:
+            for (size_t i = 0; i < node->block.size; i++) {
+                ASTNode* statement = node->block.statements[i];
+                if (statement && statement->type == NODE_FUNCTION_CALL) {
+                    for (size_t j = 0; j < statement->function_call.arg_count; j++) {
+                        statement->function_call.arguments[j] = inline_calls(inliner, statement->function_call.arguments[j], depth);
+                    }
+                    InlineCandidate* candidate = find_inline_candidate(inliner, statement->function_call.function_name);
+                    if (candidate && single_return_expression(candidate->body)) {
+                        ASTNode* inlined = inline_expression_call(inliner, candidate, statement, depth);
+                        if (inlined != statement && !contains_call(inlined)) {
+                            // Value is discarded and evaluating it has no effects
+                            inlined = create_block_node(NULL, 0);
+                        }
+                        node->block.statements[i] = inlined;
+                    } else if (candidate) {
+                        node->block.statements[i] = inline_statement_call(inliner, candidate, statement, depth);
+                    }
+                } else {
+                    node->block.statements[i] = inline_calls(inliner, statement, depth);
+                }
+            }
+            break;
+        default:
+            break;
+    }
+    return node;
+}
+
+// Entry point: run before execute_node or generate_code on the program root
+ASTNode* inline_program(ASTNode* root) {
+    Inliner* inliner = (Inliner*)calloc(1, sizeof(Inliner));
+    collect_inline_candidates(inliner, root);
+    mark_recursive_candidates(inliner);
+    root = inline_calls(inliner, root, 0);
+    free(inliner);
+    return root;
+}
+
+int main() {
+    // Equivalent of $CalculateAverage* called from a process body
+    const char* source_code =
+        "function average(a, b, c) { return (a + b + c) / 3; }"
+        "function report(x) { y = x * 2; print(y); }"
+        "{ avg = average(1, 2, 3); report(avg); }";
+    Lexer* lexer = create_lexer(source_code);
+    Parser* parser = create_parser(lexer);
+
+    initialize_stdlib();
+
+    ASTNode* root = parse_block(parser);
+    root = inline_program(root);
+
+    printf("Inlined Code:\n");
+    generate_code(root);
+
+    execute_node(create_runtime_environment(), root);
+    return 0;
+}
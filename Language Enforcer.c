@@ -1061,6 +1061,7 @@ typedef struct ASTNode {
         struct {
             char* function_name;
             char** parameters;
+            size_t arg_count;
             ASTNode* body;
         } function_def;
     };
@@ -1120,6 +1121,7 @@ ASTNode* create_function_def_node(const char* name, char** params, size_t param_
     node->type = NODE_FUNCTION_DEF;
     node->function_def.function_name = strdup(name);
     node->function_def.parameters = params;
+    node->function_def.arg_count = param_count;
     node->function_def.body = body;
     return node;
 }
@@ -1180,6 +1182,12 @@ typedef struct ASTNode {
 
 #define NODE_RETURN 102 // Add a node type for return statements
 
+// Node types added by later passes. They are numbered only here, so two
+// passes can't claim the same number.
+#define NODE_TAIL_CALL 103      // Tail Call Elimination.c
+#define NODE_GENERIC_DEF 104    // Monomorphization.c
+#define NODE_NATIVE_CALL 105    // Native Builtins.c
+
 // Function for creating return nodes
 ASTNode* create_return_node(ASTNode* value) {
     ASTNode* node = (ASTNode*)malloc(sizeof(ASTNode));
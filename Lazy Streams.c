@@ -0,0 +1,278 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+// Lazy, fused stream pipelines.
+//
+// map() above allocates a full output array for every stage. A Stream is a
+// pull iterator instead: the consumer asks for up to a block of elements,
+// and each stage pulls from its source into the consumer's buffer and
+// transforms the block in place. map rewrites elements, filter compacts
+// them, and take shortens the request. A pipeline therefore runs
+// block-by-block with one buffer at the sink, plus a small private buffer
+// for each zip side. Memory is O(block) no matter how many stages there
+// are or how long the input is.
+//
+// Sources are arrays, integer ranges and generators (a callback that yields
+// one element per call). reduce and stream_to_array consume a stream. A
+// stream owns its sources and frees them with stream_free.
+#define STREAM_BLOCK 256
+
+typedef struct Stream Stream;
+
+// Fill 'out' with up to 'capacity' elements. 0 means the stream has ended.
+typedef size_t (*PullFunction)(Stream* self, int* out, size_t capacity);
+
+// Store the next element in *out and return 1, or return 0 at the end
+typedef int (*GeneratorFunction)(void* state, int* out);
+
+struct Stream {
+    PullFunction pull;
+    Stream* source;
+    Stream* other;                  // zip: the right-hand input
+    int (*func)(int);               // map
+    int (*predicate)(int);          // filter
+    int (*combine)(int, int);       // zip
+    GeneratorFunction generator;
+    void* state;
+    const int* array;
+    int64_t position;               // array index, or next range value
+    int64_t end;                    // array size, or range end
+    size_t remaining;               // take
+    int* buffers;                   // zip: STREAM_BLOCK elements per side
+    size_t available[2];            // zip: buffered elements per side
+    size_t offset[2];               // zip: first unconsumed element per side
+};
+
+Stream* new_stream(PullFunction pull, Stream* source) {
+    Stream* stream = (Stream*)calloc(1, sizeof(Stream));
+    if (!stream) {
+        fprintf(stderr, "Out of memory creating a stream\n");
+        exit(EXIT_FAILURE);
+    }
+    stream->pull = pull;
+    stream->source = source;
+    return stream;
+}
+
+void stream_free(Stream* stream) {
+    if (!stream) return;
+    stream_free(stream->source);
+    stream_free(stream->other);
+    free(stream->buffers);
+    free(stream);
+}
+
+size_t pull_array(Stream* self, int* out, size_t capacity) {
+    size_t count = (size_t)(self->end - self->position);
+    if (count > capacity) count = capacity;
+    memcpy(out, self->array + self->position, sizeof(int) * count);
+    self->position += (int64_t)count;
+    return count;
+}
+
+// Borrows 'array'; it must outlive the stream
+Stream* stream_from_array(const int* array, size_t size) {
+    Stream* stream = new_stream(pull_array, NULL);
+    stream->array = array;
+    stream->end = (int64_t)size;
+    return stream;
+}
+
+size_t pull_range(Stream* self, int* out, size_t capacity) {
+    size_t count = 0;
+    while (count < capacity && self->position < self->end) out[count++] = (int)self->position++;
+    return count;
+}
+
+// The integers start, start + 1, ..., end - 1
+Stream* stream_range(int start, int end) {
+    Stream* stream = new_stream(pull_range, NULL);
+    stream->position = start;
+    stream->end = end;
+    return stream;
+}
+
+size_t pull_generator(Stream* self, int* out, size_t capacity) {
+    size_t count = 0;
+    while (count < capacity && self->generator && self->generator(self->state, &out[count])) count++;
+    if (count < capacity) self->generator = NULL; // Exhausted; don't call it again
+    return count;
+}
+
+Stream* stream_generate(GeneratorFunction generator, void* state) {
+    Stream* stream = new_stream(pull_generator, NULL);
+    stream->generator = generator;
+    stream->state = state;
+    return stream;
+}
+
+size_t pull_map(Stream* self, int* out, size_t capacity) {
+    size_t count = self->source->pull(self->source, out, capacity);
+    for (size_t i = 0; i < count; i++) out[i] = self->func(out[i]);
+    return count;
+}
+
+Stream* stream_map(Stream* source, int (*func)(int)) {
+    Stream* stream = new_stream(pull_map, source);
+    stream->func = func;
+    return stream;
+}
+
+// Keeps pulling until something passes, so 0 still means the end
+size_t pull_filter(Stream* self, int* out, size_t capacity) {
+    for (;;) {
+        size_t count = self->source->pull(self->source, out, capacity);
+        if (count == 0) return 0;
+        size_t kept = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (self->predicate(out[i])) out[kept++] = out[i];
+        }
+        if (kept) return kept;
+    }
+}
+
+Stream* stream_filter(Stream* source, int (*predicate)(int)) {
+    Stream* stream = new_stream(pull_filter, source);
+    stream->predicate = predicate;
+    return stream;
+}
+
+// Never asks its source for more than it still needs, so upstream work stops early
+size_t pull_take(Stream* self, int* out, size_t capacity) {
+    if (self->remaining == 0) return 0;
+    if (capacity > self->remaining) capacity = self->remaining;
+    size_t count = self->source->pull(self->source, out, capacity);
+    self->remaining -= count;
+    return count;
+}
+
+Stream* stream_take(Stream* source, size_t count) {
+    Stream* stream = new_stream(pull_take, source);
+    stream->remaining = count;
+    return stream;
+}
+
+// Make sure side 'which' has buffered elements; returns how many
+size_t zip_fill(Stream* self, int which) {
+    if (self->offset[which] == self->available[which]) {
+        Stream* input = which == 0 ? self->source : self->other;
+        self->available[which] = input->pull(input, self->buffers + which * STREAM_BLOCK, STREAM_BLOCK);
+        self->offset[which] = 0;
+    }
+    return self->available[which] - self->offset[which];
+}
+
+size_t pull_zip(Stream* self, int* out, size_t capacity) {
+    size_t count = 0;
+    while (count < capacity) {
+        size_t left = zip_fill(self, 0);
+        size_t right = zip_fill(self, 1);
+        size_t n = left < right ? left : right;
+        if (n == 0) break; // Either side ended
+        if (n > capacity - count) n = capacity - count;
+
+        const int* a = self->buffers + self->offset[0];
+        const int* b = self->buffers + STREAM_BLOCK + self->offset[1];
+        for (size_t i = 0; i < n; i++) out[count + i] = self->combine(a[i], b[i]);
+        self->offset[0] += n;
+        self->offset[1] += n;
+        count += n;
+    }
+    return count;
+}
+
+// Pairs elements of both streams with 'combine'; ends with the shorter one
+Stream* stream_zip(Stream* left, Stream* right, int (*combine)(int, int)) {
+    Stream* stream = new_stream(pull_zip, left);
+    stream->other = right;
+    stream->combine = combine;
+    stream->buffers = malloc(sizeof(int) * STREAM_BLOCK * 2);
+    if (!stream->buffers) {
+        fprintf(stderr, "Out of memory creating a zip stream\n");
+        exit(EXIT_FAILURE);
+    }
+    return stream;
+}
+
+// Consume and free the stream
+int64_t stream_reduce(Stream* stream, int64_t initial, int64_t (*combine)(int64_t, int)) {
+    int block[STREAM_BLOCK];
+    int64_t accumulator = initial;
+    size_t count;
+    while ((count = stream->pull(stream, block, STREAM_BLOCK)) > 0) {
+        for (size_t i = 0; i < count; i++) accumulator = combine(accumulator, block[i]);
+    }
+    stream_free(stream);
+    return accumulator;
+}
+
+// Consume and free the stream, collecting every element
+int* stream_to_array(Stream* stream, size_t* size) {
+    size_t capacity = STREAM_BLOCK, count = 0, pulled;
+    int* result = malloc(sizeof(int) * capacity);
+    while (result && (pulled = stream->pull(stream, result + count, capacity - count)) > 0) {
+        count += pulled;
+        if (count == capacity) {
+            capacity *= 2;
+            result = realloc(result, sizeof(int) * capacity);
+        }
+    }
+    if (!result) {
+        fprintf(stderr, "Out of memory collecting a stream\n");
+        exit(EXIT_FAILURE);
+    }
+    stream_free(stream);
+    *size = count;
+    return result;
+}
+
+int square(int x) {
+    return x * x;
+}
+
+int is_even(int x) {
+    return x % 2 == 0;
+}
+
+int add(int x, int y) {
+    return x + y;
+}
+
+int64_t sum(int64_t accumulator, int x) {
+    return accumulator + x;
+}
+
+// Generator example: Fibonacci numbers below a limit
+typedef struct {
+    int a;
+    int b;
+    int limit;
+} FibonacciState;
+
+int next_fibonacci(void* state, int* out) {
+    FibonacciState* fib = (FibonacciState*)state;
+    if (fib->a >= fib->limit) return 0;
+    *out = fib->a;
+    int next = fib->a + fib->b;
+    fib->a = fib->b;
+    fib->b = next;
+    return 1;
+}
+
+int main() {
+    // Ten million inputs, but only the first 1000 even squares are ever computed
+    Stream* evens = stream_take(stream_filter(stream_map(stream_range(0, 10000000), square), is_even), 1000);
+    printf("Sum of first 1000 even squares: %lld\n", (long long)stream_reduce(evens, 0, sum));
+
+    int array[] = {1, 2, 3, 4, 5};
+    FibonacciState fib = { 0, 1, 100 };
+    Stream* zipped = stream_zip(stream_from_array(array, 5), stream_generate(next_fibonacci, &fib), add);
+    size_t size;
+    int* values = stream_to_array(zipped, &size);
+    for (size_t i = 0; i < size; i++) printf("%d ", values[i]);
+    printf("\n");
+    free(values);
+    return 0;
+}
@@ -0,0 +1,206 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sched.h>
+
+// Memoizing lazy values.
+//
+// A Lazy is a heap value holding a compute function, an opaque context and
+// the arguments it captured. The first force runs the function, and every
+// later force returns the stored result. Initialization is a lock-free
+// state machine:
+//
+//   LAZY_UNINIT --CAS--> LAZY_RUNNING --store--> LAZY_DONE
+//
+// Exactly one thread wins the CAS and computes. The others spin, then yield,
+// until they observe DONE, and the release store publishes the result to
+// them. A thread that forces a value it is already computing has hit a
+// dependency cycle, which is reported instead of spinning forever. Once a
+// value is done, its captured arguments are released.
+//
+// lazy_then chains values: the new value captures its source, forces it
+// first, and passes the result as argument 0.
+//
+// Lazies are forced where their value is used: by boxed_binary,
+// is_truthy_value, invoke_builtin's argument checks and frame_load. A
+// variable slot holding a lazy is overwritten with its result.
+#define LAZY_INLINE_ARGS 4
+#define LAZY_SPINS_BEFORE_YIELD 128
+
+typedef enum {
+    LAZY_UNINIT,
+    LAZY_RUNNING,
+    LAZY_DONE
+} LazyState;
+
+typedef BoxedValue (*LazyFunction)(void* context, BoxedValue* args, size_t arg_count);
+
+typedef struct Lazy {
+    HeapObject base;
+    int state;                  // LazyState; accessed atomically
+    const void* owner;          // Thread computing it, for cycle detection
+    BoxedValue result;          // Valid once state is LAZY_DONE
+    LazyFunction compute;
+    void* context;
+    struct Lazy* source;        // Forced first by chained values
+    BoxedValue* args;
+    size_t arg_count;
+    BoxedValue inline_args[LAZY_INLINE_ARGS];
+} Lazy;
+
+_Thread_local char lazy_thread_token; // Its address identifies the thread
+
+Lazy* lazy_new(LazyFunction compute, void* context, const BoxedValue* args, size_t arg_count) {
+    Lazy* lazy = (Lazy*)allocate_heap_object(HEAP_LAZY, sizeof(Lazy));
+    lazy->state = LAZY_UNINIT;
+    lazy->compute = compute;
+    lazy->context = context;
+    lazy->arg_count = arg_count;
+    lazy->args = arg_count <= LAZY_INLINE_ARGS ? lazy->inline_args : malloc(sizeof(BoxedValue) * arg_count);
+    if (!lazy->args) {
+        fprintf(stderr, "Out of memory capturing lazy arguments\n");
+        exit(EXIT_FAILURE);
+    }
+    if (arg_count) memcpy(lazy->args, args, sizeof(BoxedValue) * arg_count);
+    return lazy;
+}
+
+BoxedValue box_lazy(Lazy* lazy) {
+    return box_pointer(&lazy->base);
+}
+
+Lazy* as_lazy(BoxedValue value) {
+    return is_heap_kind(value, HEAP_LAZY) ? (Lazy*)unbox_pointer(value) : NULL;
+}
+
+int lazy_is_done(Lazy* lazy) {
+    return __atomic_load_n(&lazy->state, __ATOMIC_ACQUIRE) == LAZY_DONE;
+}
+
+void release_captures(Lazy* lazy) {
+    if (lazy->args != lazy->inline_args) free(lazy->args);
+    lazy->args = NULL;
+    lazy->arg_count = 0;
+    lazy->source = NULL;
+    lazy->context = NULL;
+}
+
+BoxedValue lazy_force(Lazy* lazy) {
+    if (__atomic_load_n(&lazy->state, __ATOMIC_ACQUIRE) == LAZY_DONE) return lazy->result;
+
+    int expected = LAZY_UNINIT;
+    if (__atomic_compare_exchange_n(&lazy->state, &expected, LAZY_RUNNING, 0, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+        __atomic_store_n(&lazy->owner, &lazy_thread_token, __ATOMIC_RELAXED);
+        // The result outlives whatever frame forced it, so it goes on the GC heap
+        Object** region = allocation_region;
+        allocation_region = NULL;
+        BoxedValue result;
+        if (lazy->source) {
+            // Chained: the source's result is argument 0
+            BoxedValue stack_args[LAZY_INLINE_ARGS + 1];
+            size_t count = lazy->arg_count + 1;
+            BoxedValue* args = count <= LAZY_INLINE_ARGS + 1 ? stack_args : malloc(sizeof(BoxedValue) * count);
+            args[0] = lazy_force(lazy->source);
+            if (lazy->arg_count) memcpy(args + 1, lazy->args, sizeof(BoxedValue) * lazy->arg_count);
+            result = lazy->compute(lazy->context, args, count);
+            if (args != stack_args) free(args);
+        } else {
+            result = lazy->compute(lazy->context, lazy->args, lazy->arg_count);
+        }
+        allocation_region = region;
+        lazy->result = result;
+        release_captures(lazy);
+        __atomic_store_n(&lazy->state, LAZY_DONE, __ATOMIC_RELEASE);
+        return result;
+    }
+
+    if (__atomic_load_n(&lazy->owner, __ATOMIC_RELAXED) == &lazy_thread_token) {
+        fprintf(stderr, "Lazy value depends on itself\n");
+        exit(EXIT_FAILURE);
+    }
+    for (unsigned spins = 0; __atomic_load_n(&lazy->state, __ATOMIC_ACQUIRE) != LAZY_DONE; spins++) {
+        if (spins < LAZY_SPINS_BEFORE_YIELD) {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#endif
+        } else {
+            sched_yield();
+        }
+    }
+    return lazy->result;
+}
+
+// Any value, with lazies forced; everything else passes through
+BoxedValue force_value(BoxedValue value) {
+    Lazy* lazy = as_lazy(value);
+    return lazy ? lazy_force(lazy) : value;
+}
+
+// A lazy that applies 'compute' to the forced result of 'source'
+Lazy* lazy_then(Lazy* source, LazyFunction compute, void* context, const BoxedValue* args, size_t arg_count) {
+    Lazy* lazy = lazy_new(compute, context, args, arg_count);
+    lazy->source = source;
+    return lazy;
+}
+
+// Modify LazyInt: now backed by Lazy, so execute_lazy computes once
+typedef struct {
+    Lazy* lazy;
+} LazyInt;
+
+BoxedValue call_int_thunk(void* context, BoxedValue* args, size_t arg_count) {
+    (void)args;
+    (void)arg_count;
+    int (*func)(void) = (int (*)(void))context;
+    return box_int(func());
+}
+
+LazyInt* lazy_create(int (*func)(void)) {
+    LazyInt* lazy_value = (LazyInt*)malloc(sizeof(LazyInt));
+    lazy_value->lazy = lazy_new(call_int_thunk, (void*)func, NULL, 0);
+    return lazy_value;
+}
+
+int execute_lazy(LazyInt* lazy_value) {
+    return as_int(lazy_force(lazy_value->lazy));
+}
+
+// Demo: four threads force one expensive value; it is computed once
+int compute_count = 0;
+
+BoxedValue expensive_sum(void* context, BoxedValue* args, size_t arg_count) {
+    (void)context;
+    (void)arg_count;
+    __atomic_fetch_add(&compute_count, 1, __ATOMIC_RELAXED);
+    int64_t total = 0;
+    for (int32_t i = 0; i < unbox_int(args[0]); i++) total += i;
+    return box_double((double)total);
+}
+
+BoxedValue halve(void* context, BoxedValue* args, size_t arg_count) {
+    (void)context;
+    (void)arg_count;
+    return box_double(as_double(args[0]) / 2);
+}
+
+void* force_worker(void* argument) {
+    return (void*)(uintptr_t)lazy_force((Lazy*)argument);
+}
+
+int main() {
+    BoxedValue limit = box_int(50000000);
+    Lazy* sum = lazy_new(expensive_sum, NULL, &limit, 1);
+    Lazy* half = lazy_then(sum, halve, NULL, NULL, 0);
+
+    pthread_t threads[4];
+    for (int i = 0; i < 4; i++) pthread_create(&threads[i], NULL, force_worker, sum);
+    for (int i = 0; i < 4; i++) pthread_join(threads[i], NULL);
+
+    print_boxed_value(stdout, lazy_force(sum));
+    printf(" ");
+    print_boxed_value(stdout, lazy_force(half));
+    printf("\ncomputed %d time(s)\n", compute_count);
+    return 0;
+}
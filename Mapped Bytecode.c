@@ -0,0 +1,322 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Bytecode file format designed to be mapped rather than decoded.
+//
+//   header           48 bytes, see MappedHeader
+//   function index   16 bytes per function, sorted by name
+//   symbol table     8 bytes per symbol: name, resolved function index or -1
+//   constant pool    int32 per constant
+//   string table     NUL-terminated names
+//   code sections    one per function, 4-byte aligned
+//
+// Every field is naturally aligned and in host order (little-endian on
+// every target we build for), so the runtime reads the mapping in place.
+// Opening a file maps it and checks the header and section bounds, whatever
+// the function count. A function is materialized the first time it's called
+// or looked up: its code is checked once with validate_code_object
+// (operands, jump targets and operand stack depths), its CodeObject points
+// straight at its code section, and only then does the VM thread it. Functions that never run cost nothing but their page-cache
+// footprint.
+#define MAPPED_MAGIC 0x4D534E55   // "UNSM"
+#define MAPPED_VERSION 1
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t function_count;
+    uint32_t main_function;     // Index of "<main>"
+    uint32_t constant_count;
+    uint32_t symbol_count;
+    uint32_t index_offset;
+    uint32_t symbols_offset;
+    uint32_t constants_offset;
+    uint32_t strings_offset;
+    uint32_t strings_size;
+    uint32_t file_size;
+} MappedHeader;
+
+typedef struct {
+    uint32_t name_offset;       // Into the string table
+    uint16_t arg_count;
+    uint16_t local_count;
+    uint32_t code_offset;       // From the start of the file
+    uint32_t code_size;
+} MappedFunctionEntry;
+
+typedef struct {
+    uint32_t name_offset;
+    int32_t function;           // Resolved when the file was written
+} MappedSymbolEntry;
+
+typedef struct {
+    uint8_t* data;
+    size_t size;
+    const MappedHeader* header;
+    const MappedFunctionEntry* index;
+    const MappedSymbolEntry* symbols;
+    const char* strings;
+    CodeObject* objects;        // objects[i].code.data is NULL until materialized
+    size_t materialized;
+    CodeModule shell;           // Constant pool and symbol count, for the VM and validation; nothing else is filled in
+    VMLoader loader;
+} MappedModule;
+
+uint32_t align4(uint32_t offset) {
+    return (offset + 3) & ~3u;
+}
+
+// Sort order for the function index; qsort context is passed through a static
+static CodeModule* sorting_module;
+
+int compare_function_names(const void* a, const void* b) {
+    return strcmp(sorting_module->functions[*(const uint32_t*)a].name, sorting_module->functions[*(const uint32_t*)b].name);
+}
+
+uint32_t add_string(ByteBuffer* strings, const char* text) {
+    uint32_t offset = (uint32_t)strings->size;
+    for (const char* p = text; *p; p++) emit_u8(strings, (uint8_t)*p);
+    emit_u8(strings, 0);
+    return offset;
+}
+
+void pad_to(ByteBuffer* out, uint32_t offset) {
+    while (out->size < offset) emit_u8(out, 0);
+}
+
+int write_mapped_module(CodeModule* module, const char* filename) {
+    uint32_t count = (uint32_t)module->function_count;
+    uint32_t* order = malloc(sizeof(uint32_t) * (count ? count : 1));   // File position -> module index
+    uint32_t* position = malloc(sizeof(uint32_t) * (count ? count : 1)); // Module index -> file position
+    for (uint32_t i = 0; i < count; i++) order[i] = i;
+    sorting_module = module;
+    qsort(order, count, sizeof(uint32_t), compare_function_names);
+    for (uint32_t i = 0; i < count; i++) position[order[i]] = i;
+
+    ByteBuffer strings = { NULL, 0, 0 };
+    uint32_t* function_names = malloc(sizeof(uint32_t) * (count ? count : 1));
+    uint32_t* symbol_names = malloc(sizeof(uint32_t) * (module->symbol_count ? module->symbol_count : 1));
+    for (uint32_t i = 0; i < count; i++) function_names[i] = add_string(&strings, module->functions[order[i]].name);
+    for (size_t s = 0; s < module->symbol_count; s++) symbol_names[s] = add_string(&strings, module->symbols[s]);
+
+    MappedHeader header = { 0 };
+    header.magic = MAPPED_MAGIC;
+    header.version = MAPPED_VERSION;
+    header.function_count = count;
+    header.main_function = count ? position[0] : 0;
+    header.constant_count = (uint32_t)module->constant_count;
+    header.symbol_count = (uint32_t)module->symbol_count;
+    header.index_offset = sizeof(MappedHeader);
+    header.symbols_offset = header.index_offset + count * sizeof(MappedFunctionEntry);
+    header.constants_offset = header.symbols_offset + header.symbol_count * sizeof(MappedSymbolEntry);
+    header.strings_offset = header.constants_offset + header.constant_count * sizeof(int32_t);
+    header.strings_size = (uint32_t)strings.size;
+
+    uint32_t code_offset = align4(header.strings_offset + header.strings_size);
+    MappedFunctionEntry* index = calloc(count ? count : 1, sizeof(MappedFunctionEntry));
+    for (uint32_t i = 0; i < count; i++) {
+        CodeObject* code = &module->functions[order[i]];
+        index[i].name_offset = function_names[i];
+        index[i].arg_count = code->arg_count;
+        index[i].local_count = code->local_count;
+        index[i].code_offset = code_offset;
+        index[i].code_size = (uint32_t)code->code.size;
+        code_offset = align4(code_offset + (uint32_t)code->code.size);
+    }
+    header.file_size = code_offset;
+
+    ByteBuffer out = { NULL, 0, 0 };
+    for (size_t i = 0; i < sizeof(header); i++) emit_u8(&out, ((uint8_t*)&header)[i]);
+    for (size_t i = 0; i < count * sizeof(MappedFunctionEntry); i++) emit_u8(&out, ((uint8_t*)index)[i]);
+    for (size_t s = 0; s < module->symbol_count; s++) {
+        int found = find_code_object(module, module->symbols[s]);
+        emit_u32(&out, symbol_names[s]);
+        emit_u32(&out, (uint32_t)(found < 0 ? -1 : (int32_t)position[found]));
+    }
+    for (size_t k = 0; k < module->constant_count; k++) emit_u32(&out, (uint32_t)module->constants[k]);
+    for (size_t i = 0; i < strings.size; i++) emit_u8(&out, strings.data[i]);
+    for (uint32_t i = 0; i < count; i++) {
+        CodeObject* code = &module->functions[order[i]];
+        pad_to(&out, index[i].code_offset);
+        for (size_t b = 0; b < code->code.size; b++) emit_u8(&out, code->code.data[b]);
+    }
+    pad_to(&out, header.file_size);
+
+    FILE* file = fopen(filename, "wb");
+    int ok = file && fwrite(out.data, 1, out.size, file) == out.size;
+    if (file) fclose(file);
+    if (!file) perror("Error opening bytecode file");
+
+    free(order);
+    free(position);
+    free(function_names);
+    free(symbol_names);
+    free(index);
+    free(strings.data);
+    free(out.data);
+    return ok;
+}
+
+void corrupt_mapped_function(size_t i, const char* problem) {
+    fprintf(stderr, "Corrupt bytecode file: function %zu %s\n", i, problem);
+    exit(EXIT_FAILURE);
+}
+
+// Checks the entry and its code once. Afterwards every opcode, operand and
+// jump target is in range and no path can underflow the operand stack;
+// max_stack bounds how deep it grows, which the VM checks before each call.
+// A file that fails any check is rejected as corrupt.
+CodeObject* materialize_function(MappedModule* mapped, size_t i) {
+    CodeObject* code = &mapped->objects[i];
+    if (code->code.data) return code;
+
+    const MappedFunctionEntry* entry = &mapped->index[i];
+    if (entry->name_offset >= mapped->header->strings_size ||
+        (uint64_t)entry->code_offset + entry->code_size > mapped->size || entry->local_count < entry->arg_count) {
+        corrupt_mapped_function(i, "is out of bounds");
+    }
+    CodeObject loaded = { 0 };
+    loaded.name = (char*)mapped->strings + entry->name_offset;
+    loaded.arg_count = entry->arg_count;
+    loaded.local_count = entry->local_count;
+    loaded.code.data = mapped->data + entry->code_offset;   // Borrowed from the mapping
+    loaded.code.size = entry->code_size;
+    if (!validate_code_object(&mapped->shell, &loaded)) corrupt_mapped_function(i, "has invalid code");
+
+    *code = loaded;
+    mapped->materialized++;
+    return code;
+}
+
+CodeObject* mapped_load_function(void* source, size_t index) {
+    return materialize_function((MappedModule*)source, index);
+}
+
+int32_t mapped_resolve_call(void* source, uint16_t symbol) {
+    MappedModule* mapped = (MappedModule*)source;
+    if (symbol >= mapped->header->symbol_count) return -1;
+    int32_t function = mapped->symbols[symbol].function;
+    return function >= 0 && (uint32_t)function < mapped->header->function_count ? function : -1;
+}
+
+const char* mapped_symbol_name(void* source, uint16_t symbol) {
+    MappedModule* mapped = (MappedModule*)source;
+    if (symbol >= mapped->header->symbol_count || mapped->symbols[symbol].name_offset >= mapped->header->strings_size) return "?";
+    return mapped->strings + mapped->symbols[symbol].name_offset;
+}
+
+// The find_function of mapped modules: binary search on the sorted index,
+// materializing the match. Returns the function's index, or -1.
+int mapped_find_function(MappedModule* mapped, const char* name) {
+    size_t low = 0, high = mapped->header->function_count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (mapped->index[mid].name_offset >= mapped->header->strings_size) corrupt_mapped_function(mid, "has no name");
+        int order = strcmp(mapped->strings + mapped->index[mid].name_offset, name);
+        if (order == 0) {
+            materialize_function(mapped, mid);
+            return (int)mid;
+        }
+        if (order < 0) low = mid + 1;
+        else high = mid;
+    }
+    return -1;
+}
+
+MappedModule* open_mapped_module(const char* filename) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        perror("Error opening bytecode file");
+        return NULL;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(MappedHeader)) {
+        close(fd);
+        fprintf(stderr, "%s is not a mapped bytecode file\n", filename);
+        return NULL;
+    }
+    uint8_t* data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        perror("Error mapping bytecode file");
+        return NULL;
+    }
+
+    const MappedHeader* header = (const MappedHeader*)data;
+    uint64_t index_end = (uint64_t)header->index_offset + (uint64_t)header->function_count * sizeof(MappedFunctionEntry);
+    uint64_t symbols_end = (uint64_t)header->symbols_offset + (uint64_t)header->symbol_count * sizeof(MappedSymbolEntry);
+    uint64_t constants_end = (uint64_t)header->constants_offset + (uint64_t)header->constant_count * sizeof(int32_t);
+    uint64_t strings_end = (uint64_t)header->strings_offset + header->strings_size;
+    if (header->magic != MAPPED_MAGIC || header->version != MAPPED_VERSION || header->file_size != (uint64_t)info.st_size ||
+        index_end > header->file_size || symbols_end > header->file_size || constants_end > header->file_size ||
+        strings_end > header->file_size || (header->constants_offset & 3) || (header->index_offset & 3) ||
+        (header->symbols_offset & 3) || header->main_function >= header->function_count ||
+        header->strings_size == 0 || data[strings_end - 1] != 0) {
+        munmap(data, (size_t)info.st_size);
+        fprintf(stderr, "%s is not a valid mapped bytecode file\n", filename);
+        return NULL;
+    }
+
+    MappedModule* mapped = (MappedModule*)calloc(1, sizeof(MappedModule));
+    mapped->data = data;
+    mapped->size = (size_t)info.st_size;
+    mapped->header = header;
+    mapped->index = (const MappedFunctionEntry*)(data + header->index_offset);
+    mapped->symbols = (const MappedSymbolEntry*)(data + header->symbols_offset);
+    mapped->strings = (const char*)(data + header->strings_offset);
+    mapped->objects = calloc(header->function_count, sizeof(CodeObject)); // Zero pages until touched
+
+    mapped->shell.constants = (int32_t*)(data + header->constants_offset);
+    mapped->shell.constant_count = header->constant_count;
+    mapped->shell.symbol_count = header->symbol_count;
+
+    mapped->loader.source = mapped;
+    mapped->loader.load_function = mapped_load_function;
+    mapped->loader.resolve_call = mapped_resolve_call;
+    mapped->loader.symbol_name = mapped_symbol_name;
+    return mapped;
+}
+
+void close_mapped_module(MappedModule* mapped) {
+    munmap(mapped->data, mapped->size);
+    free(mapped->objects);
+    free(mapped);
+}
+
+int run_mapped_program(const char* filename) {
+    MappedModule* mapped = open_mapped_module(filename);
+    if (!mapped) return EXIT_FAILURE;
+
+    VM* vm = create_lazy_vm(&mapped->shell, mapped->header->function_count, &mapped->loader);
+    int32_t result = vm_execute(vm, mapped->header->main_function, NULL, 0, NULL);
+    printf("materialized %zu of %u functions\n", mapped->materialized, mapped->header->function_count);
+
+    free_vm(vm);
+    close_mapped_module(mapped);
+    return result;
+}
+
+int main() {
+    const char* source_code =
+        "function unused(a) { return a * 1000; }"
+        "function add(a, b) { return a + b; }"
+        "function twice(a) { return add(a, a); }"
+        "print(twice(21));";
+    Lexer* lexer = create_lexer(source_code);
+    Parser* parser = create_parser(lexer);
+
+    ASTNode* root = parse_block(parser);
+    CodeModule* module = compile_module(root);
+    if (!write_mapped_module(module, "program.unsm")) return EXIT_FAILURE;
+    free_code_module(module);
+
+    // Only <main>, twice and add are ever materialized
+    return run_mapped_program("program.unsm");
+}
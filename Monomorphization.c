@@ -0,0 +1,516 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+// Generic node declarations (grammar.ebnf generic_declaration):
+//
+//     node Add<T>* { input: a: T, b: T  process: { return a + b; } }
+//
+// are never executed directly. Each call site is resolved to a concrete type
+// tuple at compile time and rewritten to call an ordinary function definition
+// instantiated for that tuple, e.g. Add__int. Instantiations are cached, so
+// every (node, types) pair is cloned and optimized exactly once, and the result
+// goes through the inliner, tail-call pass and code generator like any other
+// function. Nothing is boxed or dispatched on type at runtime.
+//
+// Types are only needed for the arguments of generic calls. A name whose
+// type can't be inferred (a global read inside a function, say) is simply
+// left untyped, and an untyped argument specializes as int, the runtime's
+// only value type. For the same reason a float instantiation such as
+// Add__float is typed as double only in generated C
+// (generate_instantiation_code); the interpreter still runs it on ints.
+#define MAX_TYPE_PARAMETERS 8
+#define MAX_GENERIC_DEFINITIONS 128
+#define MAX_INSTANTIATIONS 1024
+#define MAX_TYPE_BINDINGS 256
+
+typedef struct {
+    char* name;
+    char** type_parameters;       // T, U, ...
+    size_t type_parameter_count;
+    char** parameters;            // Input names
+    char** parameter_types;       // Declared input types (type parameters or concrete types)
+    size_t arg_count;
+    ASTNode* body;
+} GenericDefinition;
+
+typedef struct {
+    char* key;                    // "Add<int>"
+    char* mangled_name;           // "Add__int"
+    char** parameter_types;       // Concrete input types
+    const char* return_type;
+    ASTNode* function_def;        // Ordinary NODE_FUNCTION_DEF for this instantiation
+} Instantiation;
+
+typedef struct {
+    GenericDefinition definitions[MAX_GENERIC_DEFINITIONS];
+    size_t definition_count;
+    Instantiation instantiations[MAX_INSTANTIATIONS];
+    size_t instantiation_count;
+} GenericTable;
+
+GenericTable generic_table = { .definition_count = 0, .instantiation_count = 0 };
+
+// Static types of names visible while resolving a body
+typedef struct {
+    char* names[MAX_TYPE_BINDINGS];
+    const char* types[MAX_TYPE_BINDINGS];
+    size_t count;
+} TypeScope;
+
+const char* infer_type(ASTNode* node, TypeScope* scope);
+void monomorphize_calls(ASTNode* node, TypeScope* scope);
+
+GenericDefinition* find_generic(const char* name) {
+    for (size_t i = 0; i < generic_table.definition_count; i++) {
+        if (strcmp(generic_table.definitions[i].name, name) == 0) {
+            return &generic_table.definitions[i];
+        }
+    }
+    return NULL;
+}
+
+// Parse: 'node' identifier '<' type_parameter_list '>' '*' '{' input: name: type, ... process: block '}'
+ASTNode* parse_generic_declaration(Parser* parser) {
+    if (generic_table.definition_count >= MAX_GENERIC_DEFINITIONS) {
+        fprintf(stderr, "Maximum number of generic nodes reached!\n");
+        exit(EXIT_FAILURE);
+    }
+    GenericDefinition* generic = &generic_table.definitions[generic_table.definition_count++];
+
+    advance(parser); // consume 'node'
+    generic->name = strdup(parser->current_token->value);
+    advance(parser); // consume identifier
+
+    advance(parser); // consume '<'
+    generic->type_parameters = malloc(sizeof(char*) * MAX_TYPE_PARAMETERS);
+    generic->type_parameter_count = 0;
+    while (strcmp(parser->current_token->value, ">") != 0) {
+        if (generic->type_parameter_count < MAX_TYPE_PARAMETERS) {
+            generic->type_parameters[generic->type_parameter_count++] = strdup(parser->current_token->value);
+        }
+        advance(parser);
+        if (parser->current_token->type == TOKEN_COMMA) {
+            advance(parser); // consume ','
+        }
+    }
+    advance(parser); // consume '>'
+    advance(parser); // consume '*'
+    advance(parser); // consume '{'
+
+    advance(parser); // consume 'input'
+    advance(parser); // consume ':'
+    generic->parameters = malloc(sizeof(char*) * MAX_VARIABLES);
+    generic->parameter_types = malloc(sizeof(char*) * MAX_VARIABLES);
+    generic->arg_count = 0;
+    while (strcmp(parser->current_token->value, "process") != 0) {
+        generic->parameters[generic->arg_count] = strdup(parser->current_token->value);
+        advance(parser); // consume name
+        advance(parser); // consume ':'
+        generic->parameter_types[generic->arg_count++] = strdup(parser->current_token->value);
+        advance(parser); // consume type
+        if (parser->current_token->type == TOKEN_COMMA) {
+            advance(parser); // consume ','
+        }
+    }
+    advance(parser); // consume 'process'
+    advance(parser); // consume ':'
+    generic->body = parse_block(parser);
+    advance(parser); // consume '}'
+
+    ASTNode* node = create_function_def_node(generic->name, generic->parameters, generic->arg_count, generic->body);
+    node->type = NODE_GENERIC_DEF;
+    return node;
+}
+
+const char* lookup_type(TypeScope* scope, const char* name) {
+    for (size_t i = scope->count; i > 0; i--) {
+        if (strcmp(scope->names[i - 1], name) == 0) {
+            return scope->types[i - 1];
+        }
+    }
+    return NULL;
+}
+
+void bind_type(TypeScope* scope, char* name, const char* type) {
+    if (scope->count >= MAX_TYPE_BINDINGS) {
+        fprintf(stderr, "Too many typed names in one scope!\n");
+        exit(EXIT_FAILURE);
+    }
+    scope->names[scope->count] = name;
+    scope->types[scope->count] = type;
+    scope->count++;
+}
+
+// Type of an arithmetic result, or NULL when an operand's type is unknown
+// or the operands don't combine; either way the value isn't specializable
+const char* arithmetic_type(const char* left, const char* right) {
+    if (!left || !right) return NULL;
+    if (strcmp(left, right) == 0) return left;
+    if ((strcmp(left, "float") == 0 && strcmp(right, "int") == 0) ||
+        (strcmp(left, "int") == 0 && strcmp(right, "float") == 0)) {
+        return "float";
+    }
+    return NULL;
+}
+
+// First assignment types a name; names of unknown type stay unbound
+void bind_assignment_type(ASTNode* node, TypeScope* scope) {
+    if (lookup_type(scope, node->assignment.identifier)) return;
+    const char* type = infer_type(node->assignment.value, scope);
+    if (type) bind_type(scope, node->assignment.identifier, type);
+}
+
+// Numeric promotion used for return types: float wins over int
+const char* join_types(const char* left, const char* right) {
+    if (!left) return right;
+    if (!right) return left;
+    if (strcmp(left, right) == 0) return left;
+    if ((strcmp(left, "float") == 0 && strcmp(right, "int") == 0) ||
+        (strcmp(left, "int") == 0 && strcmp(right, "float") == 0)) {
+        return "float";
+    }
+    fprintf(stderr, "Type mismatch: '%s' and '%s'\n", left, right);
+    exit(EXIT_FAILURE);
+}
+
+// Return type of a body: the join of every returned expression
+const char* infer_return_type(ASTNode* node, TypeScope* scope) {
+    if (!node) return NULL;
+
+    switch (node->type) {
+        case NODE_RETURN:
+            return infer_type(node->return_node.value, scope);
+        case NODE_ASSIGNMENT:
+            bind_assignment_type(node, scope);
+            return NULL;
+        case NODE_IF:
+            return join_types(infer_return_type(node->if_node.then_branch, scope),
+                              infer_return_type(node->if_node.else_branch, scope));
+        case NODE_WHILE:
+            return infer_return_type(node->while_node.body, scope);
+        case NODE_BLOCK: {
+            const char* type = NULL;
+            for (size_t i = 0; i < node->block.size; i++) {
+                type = join_types(type, infer_return_type(node->block.statements[i], scope));
+            }
+            return type;
+        }
+        default:
+            return NULL;
+    }
+}
+
+char* mangle_instantiation(const char* name, const char** types, size_t count, int as_key) {
+    size_t length = strlen(name) + 3;
+    for (size_t i = 0; i < count; i++) length += strlen(types[i]) + 2;
+
+    char* result = malloc(length);
+    strcpy(result, name);
+    strcat(result, as_key ? "<" : "__");
+    for (size_t i = 0; i < count; i++) {
+        if (i > 0) strcat(result, as_key ? "," : "_");
+        strcat(result, types[i]);
+    }
+    if (as_key) strcat(result, ">");
+    return result;
+}
+
+// Resolve the type arguments for a call from the static types of its arguments
+void bind_type_arguments(GenericDefinition* generic, const char** arg_types, const char** type_arguments) {
+    for (size_t t = 0; t < generic->type_parameter_count; t++) {
+        type_arguments[t] = NULL;
+    }
+
+    for (size_t i = 0; i < generic->arg_count; i++) {
+        const char* declared = generic->parameter_types[i];
+        int is_type_parameter = 0;
+        for (size_t t = 0; t < generic->type_parameter_count; t++) {
+            if (strcmp(declared, generic->type_parameters[t]) != 0) continue;
+            is_type_parameter = 1;
+            if (!type_arguments[t]) {
+                type_arguments[t] = arg_types[i];
+            } else if (strcmp(type_arguments[t], arg_types[i]) != 0) {
+                // Semantics.md: actual types must match for every use of a type parameter
+                fprintf(stderr, "Type mismatch in '%s': %s bound to both '%s' and '%s'\n",
+                        generic->name, generic->type_parameters[t], type_arguments[t], arg_types[i]);
+                exit(EXIT_FAILURE);
+            }
+        }
+        if (!is_type_parameter && strcmp(declared, arg_types[i]) != 0) {
+            fprintf(stderr, "Type mismatch in '%s': input '%s' expects '%s' but got '%s'\n",
+                    generic->name, generic->parameters[i], declared, arg_types[i]);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    for (size_t t = 0; t < generic->type_parameter_count; t++) {
+        if (!type_arguments[t]) {
+            fprintf(stderr, "Cannot infer type parameter '%s' of '%s'\n", generic->type_parameters[t], generic->name);
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+// Fold constant integer subexpressions; instantiated bodies often collapse once types are known
+ASTNode* fold_constants(ASTNode* node) {
+    if (!node) return NULL;
+
+    switch (node->type) {
+        case NODE_BINARY_EXPR: {
+            node->binary.left = fold_constants(node->binary.left);
+            node->binary.right = fold_constants(node->binary.right);
+            ASTNode* left = node->binary.left;
+            ASTNode* right = node->binary.right;
+            if (left->type != NODE_NUMBER || right->type != NODE_NUMBER) break;
+            if (strchr(left->number_value, '.') || strchr(right->number_value, '.')) break;
+
+            int a = atoi(left->number_value);
+            int b = atoi(right->number_value);
+            int result;
+            // Wrap modulo 2^32 like the VM, so folding never changes a result
+            switch (node->binary.op) {
+                case '+': result = (int)((uint32_t)a + (uint32_t)b); break;
+                case '-': result = (int)((uint32_t)a - (uint32_t)b); break;
+                case '*': result = (int)((uint32_t)a * (uint32_t)b); break;
+                case '/':
+                    if (b == 0) return node; // Leave the runtime error in place
+                    result = b == -1 ? (int)(0u - (uint32_t)a) : a / b;
+                    break;
+                default:
+                    return node;
+            }
+            char buffer[32];
+            snprintf(buffer, sizeof(buffer), "%d", result);
+            node->type = NODE_NUMBER;
+            node->number_value = strdup(buffer);
+            break;
+        }
+        case NODE_ASSIGNMENT:
+            node->assignment.value = fold_constants(node->assignment.value);
+            break;
+        case NODE_IF:
+            node->if_node.condition = fold_constants(node->if_node.condition);
+            node->if_node.then_branch = fold_constants(node->if_node.then_branch);
+            node->if_node.else_branch = fold_constants(node->if_node.else_branch);
+            break;
+        case NODE_WHILE:
+            node->while_node.condition = fold_constants(node->while_node.condition);
+            node->while_node.body = fold_constants(node->while_node.body);
+            break;
+        case NODE_RETURN:
+            node->return_node.value = fold_constants(node->return_node.value);
+            break;
+        case NODE_BLOCK:
+            for (size_t i = 0; i < node->block.size; i++) {
+                node->block.statements[i] = fold_constants(node->block.statements[i]);
+            }
+            break;
+        case NODE_FUNCTION_CALL:
+            for (size_t i = 0; i < node->function_call.arg_count; i++) {
+                node->function_call.arguments[i] = fold_constants(node->function_call.arguments[i]);
+            }
+            break;
+        default:
+            break;
+    }
+    return node;
+}
+
+// Find or create the instantiation of 'generic' for the given argument types
+Instantiation* instantiate_generic(GenericDefinition* generic, const char** arg_types) {
+    const char* type_arguments[MAX_TYPE_PARAMETERS];
+    bind_type_arguments(generic, arg_types, type_arguments);
+
+    char* key = mangle_instantiation(generic->name, type_arguments, generic->type_parameter_count, 1);
+    for (size_t i = 0; i < generic_table.instantiation_count; i++) {
+        if (strcmp(generic_table.instantiations[i].key, key) == 0) {
+            free(key);
+            return &generic_table.instantiations[i];
+        }
+    }
+
+    if (generic_table.instantiation_count >= MAX_INSTANTIATIONS) {
+        fprintf(stderr, "Maximum number of generic instantiations reached!\n");
+        exit(EXIT_FAILURE);
+    }
+    Instantiation* instance = &generic_table.instantiations[generic_table.instantiation_count++];
+    instance->key = key;
+    instance->mangled_name = mangle_instantiation(generic->name, type_arguments, generic->type_parameter_count, 0);
+    instance->parameter_types = malloc(sizeof(char*) * (generic->arg_count ? generic->arg_count : 1));
+    for (size_t i = 0; i < generic->arg_count; i++) {
+        instance->parameter_types[i] = (char*)arg_types[i];
+    }
+    instance->return_type = NULL;
+
+    // Registered before its body is processed so recursive instantiations hit the cache
+    ASTNode* body = clone_ast(generic->body, NULL);
+    instance->function_def = create_function_def_node(instance->mangled_name, generic->parameters, generic->arg_count, body);
+
+    TypeScope* scope = (TypeScope*)calloc(1, sizeof(TypeScope));
+    for (size_t i = 0; i < generic->arg_count; i++) {
+        bind_type(scope, generic->parameters[i], arg_types[i]);
+    }
+    monomorphize_calls(body, scope);
+    instance->return_type = infer_return_type(body, scope);
+    free(scope);
+
+    instance->function_def->function_def.body = fold_constants(body);
+    return instance;
+}
+
+const char* infer_type(ASTNode* node, TypeScope* scope) {
+    if (!node) return NULL;
+
+    switch (node->type) {
+        case NODE_NUMBER:
+            return strchr(node->number_value, '.') ? "float" : "int";
+        case NODE_STRING:
+            return "string";
+        case NODE_IDENTIFIER:
+            return lookup_type(scope, node->identifier); // NULL for globals and other unknowns
+        case NODE_BINARY_EXPR:
+            return arithmetic_type(infer_type(node->binary.left, scope), infer_type(node->binary.right, scope));
+        case NODE_FUNCTION_CALL: {
+            // Calls are monomorphized before their result type is needed
+            for (size_t i = 0; i < generic_table.instantiation_count; i++) {
+                if (strcmp(generic_table.instantiations[i].mangled_name, node->function_call.function_name) == 0) {
+                    return generic_table.instantiations[i].return_type ? generic_table.instantiations[i].return_type : "int";
+                }
+            }
+            return "int"; // Non-generic functions return int in the runtime
+        }
+        default:
+            return "int";
+    }
+}
+
+// Rewrite calls to generic nodes into calls to their instantiations
+void monomorphize_calls(ASTNode* node, TypeScope* scope) {
+    if (!node) return;
+
+    switch (node->type) {
+        case NODE_FUNCTION_CALL: {
+            for (size_t i = 0; i < node->function_call.arg_count; i++) {
+                monomorphize_calls(node->function_call.arguments[i], scope);
+            }
+            GenericDefinition* generic = find_generic(node->function_call.function_name);
+            if (!generic) break;
+            if (node->function_call.arg_count != generic->arg_count) {
+                fprintf(stderr, "Generic node '%s' expected %zu arguments but got %zu\n",
+                        generic->name, generic->arg_count, node->function_call.arg_count);
+                exit(EXIT_FAILURE);
+            }
+
+            const char* arg_types[MAX_VARIABLES];
+            for (size_t i = 0; i < node->function_call.arg_count; i++) {
+                // Runtime values are ints, so an argument of unknown static type is specialized as int
+                const char* type = infer_type(node->function_call.arguments[i], scope);
+                arg_types[i] = type ? type : "int";
+            }
+            Instantiation* instance = instantiate_generic(generic, arg_types);
+            node->function_call.function_name = instance->mangled_name;
+            node->function_call.cache.epoch = 0; // The cached target was for the generic name
+            break;
+        }
+        case NODE_BINARY_EXPR:
+            monomorphize_calls(node->binary.left, scope);
+            monomorphize_calls(node->binary.right, scope);
+            break;
+        case NODE_ASSIGNMENT:
+            monomorphize_calls(node->assignment.value, scope);
+            bind_assignment_type(node, scope);
+            break;
+        case NODE_IF:
+            monomorphize_calls(node->if_node.condition, scope);
+            monomorphize_calls(node->if_node.then_branch, scope);
+            monomorphize_calls(node->if_node.else_branch, scope);
+            break;
+        case NODE_WHILE:
+            monomorphize_calls(node->while_node.condition, scope);
+            monomorphize_calls(node->while_node.body, scope);
+            break;
+        case NODE_RETURN:
+            monomorphize_calls(node->return_node.value, scope);
+            break;
+        case NODE_BLOCK:
+            for (size_t i = 0; i < node->block.size; i++) {
+                monomorphize_calls(node->block.statements[i], scope);
+            }
+            break;
+        case NODE_FUNCTION_DEF: {
+            // Non-generic functions take int inputs in the runtime
+            TypeScope* inner = (TypeScope*)calloc(1, sizeof(TypeScope));
+            for (size_t i = 0; i < node->function_def.arg_count; i++) {
+                bind_type(inner, node->function_def.parameters[i], "int");
+            }
+            monomorphize_calls(node->function_def.body, inner);
+            free(inner);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+// Entry point: resolve every generic call in the program, drop the generic
+// declarations and prepend the instantiated definitions so they are
+// registered before the first statement that calls them.
+ASTNode* monomorphize_program(ASTNode* root) {
+    size_t first_instance = generic_table.instantiation_count;
+    TypeScope* scope = (TypeScope*)calloc(1, sizeof(TypeScope));
+    monomorphize_calls(root, scope);
+    free(scope);
+
+    size_t instance_count = generic_table.instantiation_count - first_instance;
+    ASTNode** statements = malloc(sizeof(ASTNode*) * (instance_count + root->block.size + 1));
+    size_t count = 0;
+    for (size_t i = first_instance; i < generic_table.instantiation_count; i++) {
+        statements[count++] = generic_table.instantiations[i].function_def;
+    }
+    for (size_t i = 0; i < root->block.size; i++) {
+        if (root->block.statements[i]->type != NODE_GENERIC_DEF) {
+            statements[count++] = root->block.statements[i];
+        }
+    }
+    root->block.statements = statements;
+    root->block.size = count;
+    return root;
+}
+
+const char* c_type_name(const char* type) {
+    if (strcmp(type, "string") == 0) return "const char*";
+    if (strcmp(type, "float") == 0) return "double";
+    return "int";
+}
+
+// Emit an instantiation with its concrete C signature
+void generate_instantiation_code(Instantiation* instance) {
+    ASTNode* def = instance->function_def;
+    printf("%s %s(", c_type_name(instance->return_type ? instance->return_type : "int"), instance->mangled_name);
+    for (size_t i = 0; i < def->function_def.arg_count; i++) {
+        if (i > 0) printf(", ");
+        printf("%s %s", c_type_name(instance->parameter_types[i]), def->function_def.parameters[i]);
+    }
+    printf(") ");
+    generate_code(def->function_def.body);
+}
+
+int main() {
+    const char* source_code =
+        "node Add<T>* { input: a: T, b: T process: { return a + b; } }"
+        "x = Add(1, 2); y = Add(1.5, 2.5); z = Add(x, 40);";
+    Lexer* lexer = create_lexer(source_code);
+    Parser* parser = create_parser(lexer);
+
+    ASTNode* root = parse_block(parser);
+    root = monomorphize_program(root);
+
+    // Add<int> is instantiated once and shared by both integer call sites
+    printf("Generated Code:\n");
+    for (size_t i = 0; i < generic_table.instantiation_count; i++) {
+        generate_instantiation_code(&generic_table.instantiations[i]);
+    }
+    return 0;
+}
@@ -0,0 +1,322 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <math.h>
+
+// One 64-bit word for every runtime value.
+//
+// A double is stored as its own bits. Every other value lives inside the
+// quiet-NaN space, which real arithmetic never produces because NaN results
+// are canonicalized when boxed:
+//
+//   double     any bit pattern without all of QNAN set
+//   int        QNAN | TAG_INT     | 32-bit payload
+//   special    QNAN | TAG_SPECIAL | nil, false, true or NEUTRAL
+//   pointer    SIGN | QNAN        | 48-bit address of a heap object
+//
+// Values fit in one register, copy without allocation, and are half the size
+// of Data. Heap objects (strings and arrays) start with the collector's
+// Object header and are linked into 'heap', so gc() sees them. While
+// 'allocation_region' is set, they go onto that list instead: the frame
+// interpreter points it at the current frame's region for allocation sites
+// that escape analysis proved frame-local, and frees the region when the
+// frame is popped (see Call Stack.c).
+//
+// A boxed string holds a runtime String (see Runtime Strings.c), so short
+// strings are stored inline and '+' on long strings builds a rope node in
+// O(1) instead of copying both operands.
+typedef uint64_t BoxedValue;
+
+#define SIGN_BIT ((uint64_t)0x8000000000000000ULL)
+#define QNAN ((uint64_t)0x7FFC000000000000ULL)
+#define TAG_INT ((uint64_t)0x0001000000000000ULL)
+#define TAG_SPECIAL ((uint64_t)0x0002000000000000ULL)
+#define POINTER_MASK ((uint64_t)0x0000FFFFFFFFFFFFULL)
+#define CANONICAL_NAN ((uint64_t)0x7FF8000000000000ULL)
+
+#define BOXED_NIL (QNAN | TAG_SPECIAL | 1)
+#define BOXED_FALSE (QNAN | TAG_SPECIAL | 2)
+#define BOXED_TRUE (QNAN | TAG_SPECIAL | 3)
+#define BOXED_NEUTRAL (QNAN | TAG_SPECIAL | 4)
+
+typedef enum {
+    HEAP_STRING,
+    HEAP_ARRAY,
+    HEAP_LAZY           // See Lazy Values.c
+} HeapKind;
+
+typedef struct {
+    Object header;              // The collector's header; must come first
+    HeapKind kind;
+} HeapObject;
+
+typedef struct {
+    HeapObject base;
+    String string;              // See Runtime Strings.c
+} BoxedString;
+
+typedef struct {
+    HeapObject base;
+    BoxedValue* items;
+    size_t count;
+    size_t capacity;
+} BoxedArray;
+
+int is_double(BoxedValue value) { return (value & QNAN) != QNAN; }
+int is_int(BoxedValue value) { return (value & (SIGN_BIT | QNAN | TAG_INT | TAG_SPECIAL)) == (QNAN | TAG_INT); }
+int is_pointer(BoxedValue value) { return (value & (SIGN_BIT | QNAN)) == (SIGN_BIT | QNAN); }
+int is_number(BoxedValue value) { return is_double(value) || is_int(value); }
+int is_bool(BoxedValue value) { return value == BOXED_TRUE || value == BOXED_FALSE; }
+
+BoxedValue box_double(double number) {
+    if (isnan(number)) return CANONICAL_NAN;
+    BoxedValue value;
+    memcpy(&value, &number, sizeof(double));
+    return value;
+}
+
+double unbox_double(BoxedValue value) {
+    double number;
+    memcpy(&number, &value, sizeof(double));
+    return number;
+}
+
+BoxedValue box_int(int32_t number) { return QNAN | TAG_INT | (uint32_t)number; }
+int32_t unbox_int(BoxedValue value) { return (int32_t)(uint32_t)value; }
+BoxedValue box_bool(int condition) { return condition ? BOXED_TRUE : BOXED_FALSE; }
+BoxedValue box_pointer(HeapObject* object) { return SIGN_BIT | QNAN | (uint64_t)(uintptr_t)object; }
+HeapObject* unbox_pointer(BoxedValue value) { return (HeapObject*)(uintptr_t)(value & POINTER_MASK); }
+
+int is_heap_kind(BoxedValue value, HeapKind kind) {
+    return is_pointer(value) && unbox_pointer(value)->kind == kind;
+}
+
+double as_double(BoxedValue value) {
+    return is_int(value) ? (double)unbox_int(value) : unbox_double(value);
+}
+
+// Integer view used where the older int-only runtime reads a value.
+// Doubles truncate toward zero and saturate at the int range; NaN reads as 0.
+int as_int(BoxedValue value) {
+    if (is_int(value)) return unbox_int(value);
+    if (is_double(value)) {
+        double number = unbox_double(value);
+        if (number != number) return 0;
+        if (number >= (double)INT_MAX) return INT_MAX;
+        if (number <= (double)INT_MIN) return INT_MIN;
+        return (int)number;
+    }
+    return value == BOXED_TRUE;
+}
+
+_Thread_local Object** allocation_region = NULL;
+
+HeapObject* allocate_heap_object(HeapKind kind, size_t size) {
+    HeapObject* object = calloc(1, size);
+    if (!object) {
+        fprintf(stderr, "Out of memory allocating a heap object\n");
+        exit(EXIT_FAILURE);
+    }
+    object->kind = kind;
+    if (allocation_region) {
+        object->header.next = *allocation_region;
+        *allocation_region = &object->header;
+        return object;
+    }
+    // Lazy values may be forced on other threads, so the push is atomic
+    Object* head = __atomic_load_n(&heap, __ATOMIC_RELAXED);
+    do {
+        object->header.next = head;
+    } while (!__atomic_compare_exchange_n(&heap, &head, &object->header, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    return object;
+}
+
+// Takes over the caller's reference to 'value'
+BoxedValue box_string_value(String value) {
+    BoxedString* string = (BoxedString*)allocate_heap_object(HEAP_STRING, sizeof(BoxedString));
+    string->string = value;
+    return box_pointer(&string->base);
+}
+
+BoxedValue box_string(const char* chars, size_t length) {
+    return box_string_value(string_from(chars, length));
+}
+
+BoxedString* as_string(BoxedValue value) {
+    return is_heap_kind(value, HEAP_STRING) ? (BoxedString*)unbox_pointer(value) : NULL;
+}
+
+BoxedValue new_array(size_t capacity) {
+    BoxedArray* array = (BoxedArray*)allocate_heap_object(HEAP_ARRAY, sizeof(BoxedArray));
+    array->capacity = capacity ? capacity : 4;
+    array->items = malloc(sizeof(BoxedValue) * array->capacity);
+    if (!array->items) {
+        fprintf(stderr, "Out of memory allocating an array\n");
+        exit(EXIT_FAILURE);
+    }
+    return box_pointer(&array->base);
+}
+
+BoxedArray* as_array(BoxedValue value) {
+    return is_heap_kind(value, HEAP_ARRAY) ? (BoxedArray*)unbox_pointer(value) : NULL;
+}
+
+// Free every object of a region; nothing outside it may still refer to them
+void release_region(Object* region) {
+    while (region) {
+        Object* next = region->next;
+        HeapObject* object = (HeapObject*)region;
+        if (object->kind == HEAP_STRING) string_release(&((BoxedString*)object)->string);
+        if (object->kind == HEAP_ARRAY) free(((BoxedArray*)object)->items);
+        free(object);
+        region = next;
+    }
+}
+
+void array_push(BoxedValue array_value, BoxedValue item) {
+    BoxedArray* array = as_array(array_value);
+    if (array->count == array->capacity) {
+        array->capacity *= 2;
+        array->items = realloc(array->items, sizeof(BoxedValue) * array->capacity);
+        if (!array->items) {
+            fprintf(stderr, "Out of memory growing an array\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    array->items[array->count++] = item;
+}
+
+BoxedValue array_get(BoxedValue array_value, size_t index) {
+    BoxedArray* array = as_array(array_value);
+    if (!array || index >= array->count) {
+        fprintf(stderr, "Array index %zu out of range\n", index);
+        exit(EXIT_FAILURE);
+    }
+    return array->items[index];
+}
+
+BoxedValue force_value(BoxedValue value); // See Lazy Values.c
+
+// nil, false and NEUTRAL don't take a branch
+int is_truthy_value(BoxedValue value) {
+    value = force_value(value);
+    if (is_int(value)) return unbox_int(value) != 0;
+    if (is_double(value)) return unbox_double(value) != 0;
+    if (is_pointer(value)) {
+        BoxedString* string = as_string(value);
+        return string ? string_length(&string->string) != 0 : 1;
+    }
+    return value == BOXED_TRUE;
+}
+
+BoxedValue box_number_literal(const char* text) {
+    if (strchr(text, '.')) return box_double(strtod(text, NULL));
+    long long number = strtoll(text, NULL, 10);
+    if (number >= INT32_MIN && number <= INT32_MAX) return box_int((int32_t)number);
+    return box_double((double)number);
+}
+
+// Int arithmetic wraps modulo 2^32, INT32_MIN / -1 included, like the VM,
+// register VM, JIT, AOT and Type Feedback tiers; mixing in a double promotes
+BoxedValue boxed_binary(char op, BoxedValue left, BoxedValue right) {
+    left = force_value(left);
+    right = force_value(right);
+    if (is_int(left) && is_int(right)) {
+        int32_t x = unbox_int(left), y = unbox_int(right);
+        switch (op) {
+            case '+': return box_int((int32_t)((uint32_t)x + (uint32_t)y));
+            case '-': return box_int((int32_t)((uint32_t)x - (uint32_t)y));
+            case '*': return box_int((int32_t)((uint32_t)x * (uint32_t)y));
+            case '/':
+                if (y == 0) {
+                    fprintf(stderr, "Division by zero\n");
+                    exit(EXIT_FAILURE);
+                }
+                return box_int(y == -1 ? (int32_t)(0u - (uint32_t)x) : x / y);
+            case '<': return box_bool(x < y);
+            case '>': return box_bool(x > y);
+        }
+    }
+
+    if (is_number(left) && is_number(right)) {
+        double x = as_double(left), y = as_double(right);
+        switch (op) {
+            case '+': return box_double(x + y);
+            case '-': return box_double(x - y);
+            case '*': return box_double(x * y);
+            case '/': return box_double(x / y);
+            case '<': return box_bool(x < y);
+            case '>': return box_bool(x > y);
+        }
+    }
+
+    BoxedString* a = as_string(left);
+    BoxedString* b = as_string(right);
+    if (a && b && op == '+') {
+        return box_string_value(string_concat(&a->string, &b->string));
+    }
+    if (a && b && (op == '<' || op == '>')) {
+        int order = string_compare(&a->string, &b->string);
+        return box_bool(op == '<' ? order < 0 : order > 0);
+    }
+
+    fprintf(stderr, "Invalid operands for '%c'\n", op);
+    exit(EXIT_FAILURE);
+}
+
+void print_boxed_value(FILE* out, BoxedValue value) {
+    if (is_int(value)) {
+        fprintf(out, "%d", unbox_int(value));
+    } else if (is_double(value)) {
+        // Whole numbers below 2^53 print as integers;
+        // anything else with the fewest digits that read back the same double
+        double number = unbox_double(value);
+        if (number > -9007199254740992.0 && number < 9007199254740992.0 && number == (double)(int64_t)number) {
+            fprintf(out, "%lld", (long long)number);
+        } else {
+            char text[32];
+            for (int precision = 15; precision <= 17; precision++) {
+                snprintf(text, sizeof(text), "%.*g", precision, number);
+                if (strtod(text, NULL) == number) break;
+            }
+            fputs(text, out);
+        }
+    } else if (value == BOXED_TRUE) {
+        fputs("true", out);
+    } else if (value == BOXED_FALSE) {
+        fputs("false", out);
+    } else if (value == BOXED_NEUTRAL) {
+        fputs("neutral", out);
+    } else if (is_heap_kind(value, HEAP_LAZY)) {
+        fputs("<lazy>", out);
+    } else if (as_string(value)) {
+        fputs(string_chars(&as_string(value)->string), out);
+    } else if (as_array(value)) {
+        BoxedArray* array = as_array(value);
+        fputc('[', out);
+        for (size_t i = 0; i < array->count; i++) {
+            if (i > 0) fputs(", ", out);
+            print_boxed_value(out, array->items[i]);
+        }
+        fputc(']', out);
+    } else {
+        fputs("nil", out);
+    }
+}
+
+int main() {
+    BoxedValue values = new_array(0);
+    array_push(values, box_int(42));
+    array_push(values, box_double(2.5));
+    array_push(values, boxed_binary('*', box_int(65536), box_int(65536))); // Wraps to 0
+    array_push(values, BOXED_NEUTRAL);
+    array_push(values, boxed_binary('+', box_string("node", 4), box_string("graph", 5)));
+    array_push(values, BOXED_NIL);
+
+    printf("sizeof(BoxedValue) = %zu\n", sizeof(BoxedValue));
+    print_boxed_value(stdout, values);
+    printf("\n");
+    return 0;
+}
@@ -0,0 +1,373 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+
+// Native builtins: C functions over BoxedValue, registered with their arity,
+// parameter types and flags.
+//
+// bind_native_calls runs once after parsing. It rewrites each call to a
+// builtin that no user function shadows into NODE_NATIVE_CALL, with the
+// Builtin* stored in the node, and checks arity while doing so. The
+// interpreter then calls through the pointer: no name lookup, no strcmp
+// against "print". A pure builtin whose arguments are all literals is
+// folded to its result during the same pass. The purity analysis reads the
+// same flags, so calls to pure builtins don't make a function impure.
+//
+// A new builtin is one register_builtin call; the dispatcher doesn't change.
+#define BUILTIN_VARIADIC -1
+#define MAX_BUILTIN_PARAMS 4
+#define NATIVE_STACK_ARGS 8
+
+typedef enum {
+    BUILTIN_PURE = 1,            // Result depends only on the arguments; no effects
+    BUILTIN_VECTORIZABLE = 2,    // Elementwise over numbers, safe to apply across an array
+    BUILTIN_THREAD_SAFE = 4      // No shared state; may run on any thread
+} BuiltinFlags;
+
+typedef enum {
+    KIND_ANY,
+    KIND_NUMBER,
+    KIND_INT,
+    KIND_STRING,
+    KIND_ARRAY
+} ValueKind;
+
+typedef BoxedValue (*NativeFunction)(BoxedValue* args, size_t arg_count);
+
+typedef struct Builtin {
+    const char* name;
+    NativeFunction function;
+    int arity;                               // BUILTIN_VARIADIC for any count
+    ValueKind params[MAX_BUILTIN_PARAMS];    // Variadic builtins check every argument against params[0]
+    ValueKind result;
+    unsigned flags;
+} Builtin;
+
+typedef struct {
+    Builtin** builtins;
+    size_t count;
+    size_t capacity;
+} BuiltinRegistry;
+
+BuiltinRegistry builtin_registry = { NULL, 0, 0 };
+
+// Modify the ASTNode structure: native call sites hold their builtin
+typedef struct ASTNode {
+    ASTNodeType type;
+    union {
+        // Other node types...
+        struct {
+            char* function_name;
+            ASTNode** arguments;
+            size_t arg_count;
+            InlineCache cache;
+            Builtin* native;     // Set for NODE_NATIVE_CALL
+        } function_call;
+    };
+} ASTNode;
+
+Builtin* register_builtin(const char* name, NativeFunction function, int arity, const ValueKind* params, ValueKind result, unsigned flags) {
+    if (builtin_registry.count == builtin_registry.capacity) {
+        builtin_registry.capacity = builtin_registry.capacity ? builtin_registry.capacity * 2 : 32;
+        builtin_registry.builtins = realloc(builtin_registry.builtins, sizeof(Builtin*) * builtin_registry.capacity);
+    }
+    Builtin* builtin = calloc(1, sizeof(Builtin));
+    if (!builtin || !builtin_registry.builtins) {
+        fprintf(stderr, "Out of memory registering builtin '%s'\n", name);
+        exit(EXIT_FAILURE);
+    }
+    builtin->name = name;
+    builtin->function = function;
+    builtin->arity = arity;
+    int declared = arity == BUILTIN_VARIADIC ? 1 : arity;
+    for (int i = 0; i < declared && i < MAX_BUILTIN_PARAMS; i++) builtin->params[i] = params[i];
+    builtin->result = result;
+    builtin->flags = flags;
+    builtin_registry.builtins[builtin_registry.count++] = builtin;
+    return builtin;
+}
+
+// Only the binder and the purity analysis look builtins up by name
+Builtin* find_builtin(const char* name) {
+    for (size_t i = 0; i < builtin_registry.count; i++) {
+        if (strcmp(builtin_registry.builtins[i]->name, name) == 0) return builtin_registry.builtins[i];
+    }
+    return NULL;
+}
+
+int value_has_kind(BoxedValue value, ValueKind kind) {
+    switch (kind) {
+        case KIND_NUMBER: return is_number(value);
+        case KIND_INT: return is_int(value);
+        case KIND_STRING: return as_string(value) != NULL;
+        case KIND_ARRAY: return as_array(value) != NULL;
+        default: return 1;
+    }
+}
+
+const char* kind_name(ValueKind kind) {
+    static const char* names[] = { "any", "number", "int", "string", "array" };
+    return names[kind];
+}
+
+BoxedValue invoke_builtin(Builtin* builtin, BoxedValue* args, size_t arg_count) {
+    for (size_t i = 0; i < arg_count; i++) {
+        args[i] = force_value(args[i]);
+        ValueKind kind = builtin->params[builtin->arity == BUILTIN_VARIADIC ? 0 : i];
+        if (!value_has_kind(args[i], kind)) {
+            fprintf(stderr, "Argument %zu of '%s' must be %s\n", i + 1, builtin->name, kind_name(kind));
+            exit(EXIT_FAILURE);
+        }
+    }
+    return builtin->function(args, arg_count);
+}
+
+BoxedValue native_print(BoxedValue* args, size_t arg_count) {
+    for (size_t i = 0; i < arg_count; i++) {
+        print_boxed_value(stdout, args[i]);
+        printf(" ");
+    }
+    printf("\n");
+    return BOXED_NIL;
+}
+
+BoxedValue native_abs(BoxedValue* args, size_t arg_count) {
+    (void)arg_count;
+    if (is_int(args[0]) && unbox_int(args[0]) != INT32_MIN) return box_int(abs(unbox_int(args[0])));
+    return box_double(fabs(as_double(args[0])));
+}
+
+BoxedValue native_min(BoxedValue* args, size_t arg_count) {
+    (void)arg_count;
+    return as_double(args[1]) < as_double(args[0]) ? args[1] : args[0];
+}
+
+BoxedValue native_max(BoxedValue* args, size_t arg_count) {
+    (void)arg_count;
+    return as_double(args[1]) > as_double(args[0]) ? args[1] : args[0];
+}
+
+BoxedValue native_sqrt(BoxedValue* args, size_t arg_count) {
+    (void)arg_count;
+    return box_double(sqrt(as_double(args[0])));
+}
+
+BoxedValue native_floor(BoxedValue* args, size_t arg_count) {
+    (void)arg_count;
+    if (is_int(args[0])) return args[0];
+    double result = floor(unbox_double(args[0]));
+    return result >= INT32_MIN && result <= INT32_MAX ? box_int((int32_t)result) : box_double(result);
+}
+
+BoxedValue native_pow(BoxedValue* args, size_t arg_count) {
+    (void)arg_count;
+    return box_double(pow(as_double(args[0]), as_double(args[1])));
+}
+
+BoxedValue native_len(BoxedValue* args, size_t arg_count) {
+    (void)arg_count;
+    BoxedString* string = as_string(args[0]);
+    BoxedArray* array = as_array(args[0]);
+    if (!string && !array) {
+        fprintf(stderr, "Argument 1 of 'len' must be a string or an array\n");
+        exit(EXIT_FAILURE);
+    }
+    return box_int((int32_t)(string ? string_length(&string->string) : array->count));
+}
+
+BoxedValue native_array(BoxedValue* args, size_t arg_count) {
+    BoxedValue array = new_array(arg_count);
+    for (size_t i = 0; i < arg_count; i++) array_push(array, args[i]);
+    return array;
+}
+
+// link(parts...) joins strings as one balanced rope, like link { connect: ... }
+BoxedValue native_link(BoxedValue* args, size_t arg_count) {
+    String stack_parts[NATIVE_STACK_ARGS];
+    String* parts = arg_count <= NATIVE_STACK_ARGS ? stack_parts : malloc(sizeof(String) * arg_count);
+    if (!parts) {
+        fprintf(stderr, "Out of memory linking %zu strings\n", arg_count);
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < arg_count; i++) parts[i] = as_string(args[i])->string; // Borrowed; string_link retains
+    BoxedValue result = box_string_value(string_link(parts, arg_count));
+    if (parts != stack_parts) free(parts);
+    return result;
+}
+
+BoxedValue native_clock(BoxedValue* args, size_t arg_count) {
+    (void)args;
+    (void)arg_count;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return box_double((double)now.tv_sec + now.tv_nsec / 1e9);
+}
+
+void initialize_builtins() {
+    static const ValueKind any[] = { KIND_ANY };
+    static const ValueKind number[] = { KIND_NUMBER, KIND_NUMBER };
+    static const ValueKind string[] = { KIND_STRING };
+    const unsigned math = BUILTIN_PURE | BUILTIN_VECTORIZABLE | BUILTIN_THREAD_SAFE;
+
+    register_builtin("print", native_print, BUILTIN_VARIADIC, any, KIND_ANY, 0);
+    register_builtin("abs", native_abs, 1, number, KIND_NUMBER, math);
+    register_builtin("min", native_min, 2, number, KIND_NUMBER, math);
+    register_builtin("max", native_max, 2, number, KIND_NUMBER, math);
+    register_builtin("sqrt", native_sqrt, 1, number, KIND_NUMBER, math);
+    register_builtin("floor", native_floor, 1, number, KIND_NUMBER, math);
+    register_builtin("pow", native_pow, 2, number, KIND_NUMBER, math);
+    register_builtin("len", native_len, 1, any, KIND_INT, BUILTIN_PURE | BUILTIN_THREAD_SAFE);
+    register_builtin("link", native_link, BUILTIN_VARIADIC, string, KIND_STRING, BUILTIN_PURE | BUILTIN_THREAD_SAFE);
+    register_builtin("array", native_array, BUILTIN_VARIADIC, any, KIND_ARRAY, BUILTIN_THREAD_SAFE);
+    register_builtin("clock", native_clock, 0, any, KIND_NUMBER, BUILTIN_THREAD_SAFE);
+}
+
+// Names the program defines itself; those shadow builtins
+void collect_defined_names(ASTNode* node, char*** names, size_t* count) {
+    if (!node) return;
+
+    switch (node->type) {
+        case NODE_FUNCTION_DEF:
+            *names = realloc(*names, sizeof(char*) * (*count + 1));
+            (*names)[(*count)++] = node->function_def.function_name;
+            collect_defined_names(node->function_def.body, names, count);
+            break;
+        case NODE_IF:
+            collect_defined_names(node->if_node.then_branch, names, count);
+            collect_defined_names(node->if_node.else_branch, names, count);
+            break;
+        case NODE_WHILE:
+            collect_defined_names(node->while_node.body, names, count);
+            break;
+        case NODE_BLOCK:
+            for (size_t i = 0; i < node->block.size; i++) {
+                collect_defined_names(node->block.statements[i], names, count);
+            }
+            break;
+    }
+}
+
+int is_defined_name(char** names, size_t count, const char* name) {
+    for (size_t i = 0; i < count; i++) {
+        if (strcmp(names[i], name) == 0) return 1;
+    }
+    return 0;
+}
+
+// Replace a pure call on literal arguments with its numeric result
+void fold_native_call(ASTNode* node) {
+    BoxedValue args[MAX_BUILTIN_PARAMS];
+    Builtin* builtin = node->function_call.native;
+    if (!(builtin->flags & BUILTIN_PURE) || node->function_call.arg_count > MAX_BUILTIN_PARAMS) return;
+    for (size_t i = 0; i < node->function_call.arg_count; i++) {
+        ASTNode* argument = node->function_call.arguments[i];
+        if (argument->type != NODE_NUMBER) return;
+        args[i] = box_number_literal(argument->number_value);
+        if (!value_has_kind(args[i], builtin->params[builtin->arity == BUILTIN_VARIADIC ? 0 : i])) return; // Report it at run time
+    }
+
+    BoxedValue result = builtin->function(args, node->function_call.arg_count);
+    char text[32];
+    if (is_int(result)) snprintf(text, sizeof(text), "%d", unbox_int(result));
+    else if (is_double(result) && isfinite(unbox_double(result))) snprintf(text, sizeof(text), "%.17g", unbox_double(result));
+    else return;
+    if (strchr(text, 'e')) return; // The literal syntax has no exponents
+    if (is_double(result) && !strchr(text, '.')) strcat(text, ".0"); // Keep it a double
+
+    node->type = NODE_NUMBER;
+    node->number_value = strdup(text);
+}
+
+void bind_calls_in(ASTNode* node, char** defined, size_t defined_count) {
+    if (!node) return;
+
+    switch (node->type) {
+        case NODE_FUNCTION_CALL:
+        case NODE_TAIL_CALL: {
+            for (size_t i = 0; i < node->function_call.arg_count; i++) {
+                bind_calls_in(node->function_call.arguments[i], defined, defined_count);
+            }
+            if (is_defined_name(defined, defined_count, node->function_call.function_name)) break;
+            Builtin* builtin = find_builtin(node->function_call.function_name);
+            if (!builtin) break;
+            if (builtin->arity != BUILTIN_VARIADIC && (size_t)builtin->arity != node->function_call.arg_count) {
+                fprintf(stderr, "Builtin '%s' expected %d arguments but got %zu\n", builtin->name, builtin->arity, node->function_call.arg_count);
+                exit(EXIT_FAILURE);
+            }
+            node->type = NODE_NATIVE_CALL;
+            node->function_call.native = builtin;
+            fold_native_call(node);
+            break;
+        }
+        case NODE_FUNCTION_DEF:
+            bind_calls_in(node->function_def.body, defined, defined_count);
+            break;
+        case NODE_ASSIGNMENT:
+            bind_calls_in(node->assignment.value, defined, defined_count);
+            break;
+        case NODE_BINARY_EXPR:
+            bind_calls_in(node->binary.left, defined, defined_count);
+            bind_calls_in(node->binary.right, defined, defined_count);
+            break;
+        case NODE_IF:
+            bind_calls_in(node->if_node.condition, defined, defined_count);
+            bind_calls_in(node->if_node.then_branch, defined, defined_count);
+            bind_calls_in(node->if_node.else_branch, defined, defined_count);
+            break;
+        case NODE_WHILE:
+            bind_calls_in(node->while_node.condition, defined, defined_count);
+            bind_calls_in(node->while_node.body, defined, defined_count);
+            break;
+        case NODE_RETURN:
+            bind_calls_in(node->return_node.value, defined, defined_count);
+            break;
+        case NODE_BLOCK:
+            for (size_t i = 0; i < node->block.size; i++) {
+                bind_calls_in(node->block.statements[i], defined, defined_count);
+            }
+            break;
+    }
+}
+
+void bind_native_calls(ASTNode* root) {
+    char** defined = NULL;
+    size_t defined_count = 0;
+    collect_defined_names(root, &defined, &defined_count);
+    bind_calls_in(root, defined, defined_count);
+    free(defined);
+}
+
+// Direct dispatch for NODE_NATIVE_CALL in the frame interpreter
+BoxedValue call_native(CallFrame* frame, ASTNode* node) {
+    BoxedValue stack_args[NATIVE_STACK_ARGS];
+    size_t count = node->function_call.arg_count;
+    BoxedValue* args = count <= NATIVE_STACK_ARGS ? stack_args : malloc(sizeof(BoxedValue) * count);
+    for (size_t i = 0; i < count; i++) {
+        args[i] = frame_evaluate(frame, node->function_call.arguments[i]);
+    }
+    Object** region = allocation_region;
+    allocation_region = site_region(frame, node); // See Call Stack.c
+    BoxedValue result = invoke_builtin(node->function_call.native, args, count);
+    allocation_region = region;
+    if (args != stack_args) free(args);
+    return result;
+}
+
+int main() {
+    const char* source_code =
+        "function hyp(a, b) { return sqrt(a * a + b * b); }"
+        "print(hyp(3, 4), max(2, 7), pow(2, 10), abs(0 - 5), link(\"node\", \"graph\"));";
+    Lexer* lexer = create_lexer(source_code);
+    Parser* parser = create_parser(lexer);
+
+    initialize_stdlib();
+    initialize_builtins();
+    ASTNode* root = parse_block(parser);
+    bind_native_calls(root);    // pow(2, 10) folds to 1024.0 here
+    mark_program_tail_calls(root);
+    frame_run_program(root);
+    return 0;
+}
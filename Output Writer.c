@@ -0,0 +1,417 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+
+// Buffered output for code generation and print.
+//
+// printf locks stdout, consults the locale and parses its format string on
+// every call. A writer formats straight into its own buffer and only hits
+// the sink when the buffer fills or on an explicit flush. Integers and
+// floats are converted by hand, without locale lookups, and nothing is
+// allocated once a writer exists.
+//
+// Sinks are a file descriptor, a FILE* or a growable memory buffer. Each
+// thread has its own stdout writer. Writers on a terminal flush at every
+// newline; elsewhere they flush when full, at exit (main thread) or when
+// writer_flush is called. Other threads must call writer_flush(thread_output())
+// before they finish.
+#define WRITER_BUFFER_SIZE (64 * 1024)
+#define WRITER_DEFAULT_PRECISION 6
+
+typedef enum {
+    SINK_FD,
+    SINK_FILE,
+    SINK_MEMORY
+} SinkKind;
+
+typedef struct {
+    SinkKind kind;
+    int fd;
+    FILE* file;
+    char* buffer;
+    size_t size;
+    size_t capacity;
+    int line_buffered;
+    int owns_buffer;
+    int failed;        // Sticky: set once a write to the sink fails
+} OutputWriter;
+
+static const char digit_pairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+void writer_init_fd(OutputWriter* writer, int fd, char* buffer, size_t capacity) {
+    memset(writer, 0, sizeof(OutputWriter));
+    writer->kind = SINK_FD;
+    writer->fd = fd;
+    writer->buffer = buffer;
+    writer->capacity = capacity;
+    writer->line_buffered = isatty(fd);
+}
+
+void writer_init_file(OutputWriter* writer, FILE* file, char* buffer, size_t capacity) {
+    memset(writer, 0, sizeof(OutputWriter));
+    writer->kind = SINK_FILE;
+    writer->file = file;
+    writer->buffer = buffer;
+    writer->capacity = capacity;
+}
+
+// Memory writers own their buffer and grow it; writer_contents exposes the text
+void writer_init_memory(OutputWriter* writer, size_t initial_capacity) {
+    memset(writer, 0, sizeof(OutputWriter));
+    writer->kind = SINK_MEMORY;
+    writer->capacity = initial_capacity ? initial_capacity : 256;
+    writer->buffer = malloc(writer->capacity);
+    writer->owns_buffer = 1;
+    if (!writer->buffer) {
+        fprintf(stderr, "Memory allocation failed for output buffer\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+void writer_flush(OutputWriter* writer) {
+    if (writer->kind == SINK_MEMORY || writer->size == 0) return;
+
+    if (writer->kind == SINK_FILE) {
+        if (fwrite(writer->buffer, 1, writer->size, writer->file) != writer->size) writer->failed = 1;
+        fflush(writer->file);
+    } else {
+        // Keep ordering with anything still sitting in stdio's buffer
+        if (writer->fd == STDOUT_FILENO) fflush(stdout);
+        size_t written = 0;
+        while (written < writer->size) {
+            ssize_t n = write(writer->fd, writer->buffer + written, writer->size - written);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                writer->failed = 1;
+                break;
+            }
+            written += (size_t)n;
+        }
+    }
+    writer->size = 0;
+}
+
+// Make room for `needed` more bytes
+void writer_reserve(OutputWriter* writer, size_t needed) {
+    if (writer->size + needed <= writer->capacity) return;
+
+    if (writer->kind != SINK_MEMORY) {
+        writer_flush(writer);
+        return;
+    }
+    size_t capacity = writer->capacity;
+    while (capacity < writer->size + needed) capacity *= 2;
+    char* buffer = realloc(writer->buffer, capacity);
+    if (!buffer) {
+        fprintf(stderr, "Memory allocation failed for output buffer\n");
+        exit(EXIT_FAILURE);
+    }
+    writer->buffer = buffer;
+    writer->capacity = capacity;
+}
+
+void writer_write(OutputWriter* writer, const char* data, size_t length) {
+    if (writer->kind != SINK_MEMORY && length > writer->capacity) {
+        // Larger than the whole buffer: send it straight through
+        writer_flush(writer);
+        OutputWriter direct = *writer;
+        direct.buffer = (char*)data;
+        direct.size = length;
+        writer_flush(&direct);
+        writer->failed |= direct.failed;
+        return;
+    }
+    writer_reserve(writer, length);
+    memcpy(writer->buffer + writer->size, data, length);
+    writer->size += length;
+    if (writer->line_buffered && memchr(data, '\n', length)) writer_flush(writer);
+}
+
+void writer_put_char(OutputWriter* writer, char c) {
+    writer_reserve(writer, 1);
+    writer->buffer[writer->size++] = c;
+    if (c == '\n' && writer->line_buffered) writer_flush(writer);
+}
+
+void writer_put_string(OutputWriter* writer, const char* text) {
+    writer_write(writer, text, strlen(text));
+}
+
+void writer_put_uint64(OutputWriter* writer, uint64_t value) {
+    char digits[20];
+    char* end = digits + sizeof(digits);
+    char* p = end;
+
+    while (value >= 100) {
+        unsigned pair = (unsigned)(value % 100) * 2;
+        value /= 100;
+        *--p = digit_pairs[pair + 1];
+        *--p = digit_pairs[pair];
+    }
+    if (value >= 10) {
+        unsigned pair = (unsigned)value * 2;
+        *--p = digit_pairs[pair + 1];
+        *--p = digit_pairs[pair];
+    } else {
+        *--p = (char)('0' + value);
+    }
+    writer_write(writer, p, (size_t)(end - p));
+}
+
+void writer_put_int64(OutputWriter* writer, int64_t value) {
+    if (value < 0) {
+        writer_put_char(writer, '-');
+        writer_put_uint64(writer, (uint64_t)0 - (uint64_t)value); // Also right for INT64_MIN
+    } else {
+        writer_put_uint64(writer, (uint64_t)value);
+    }
+}
+
+void writer_put_int(OutputWriter* writer, int value) {
+    writer_put_int64(writer, value);
+}
+
+// Fixed notation with `precision` fractional digits, trailing zeros dropped.
+// Magnitudes past 2^63 switch to d.ddde+NN. This is not printf: the scaled
+// fraction is rounded half up in double arithmetic, so ties round away
+// from zero (0.125 at precision 2 gives 0.13, printf gives 0.12) and the
+// last digits of large or long values may differ. Use it for diagnostics
+// and generated code, not where output has to match printf exactly.
+void writer_put_double(OutputWriter* writer, double value, int precision) {
+    if (value != value) {
+        writer_put_string(writer, "nan");
+        return;
+    }
+    if (value < 0 || (value == 0 && 1 / value < 0)) {
+        writer_put_char(writer, '-');
+        value = -value;
+    }
+    if (value > 1.7976931348623157e308) {
+        writer_put_string(writer, "inf");
+        return;
+    }
+    if (precision < 0) precision = 0;
+    if (precision > 17) precision = 17;
+
+    int exponent = 0;
+    if (value >= 9.2e18) {
+        while (value >= 10) {
+            value /= 10;
+            exponent++;
+        }
+    }
+
+    uint64_t scale = 1;
+    for (int i = 0; i < precision; i++) scale *= 10;
+    uint64_t integer_part = (uint64_t)value;
+    double fraction = value - (double)integer_part;
+    uint64_t fraction_digits = (uint64_t)(fraction * (double)scale + 0.5);
+    if (fraction_digits >= scale) {
+        integer_part++;
+        fraction_digits -= scale;
+    }
+
+    writer_put_uint64(writer, integer_part);
+    if (precision > 0 && fraction_digits > 0) {
+        char digits[17];
+        int count = precision;
+        while (fraction_digits % 10 == 0) {
+            fraction_digits /= 10;
+            count--;
+        }
+        for (int i = count - 1; i >= 0; i--) {
+            digits[i] = (char)('0' + fraction_digits % 10);
+            fraction_digits /= 10;
+        }
+        writer_put_char(writer, '.');
+        writer_write(writer, digits, (size_t)count);
+    }
+    if (exponent > 0) {
+        writer_put_string(writer, "e+");
+        writer_put_uint64(writer, (uint64_t)exponent);
+    }
+}
+
+// Text written so far, NUL-terminated (memory writers only)
+const char* writer_contents(OutputWriter* writer) {
+    writer_reserve(writer, 1);
+    writer->buffer[writer->size] = '\0';
+    return writer->buffer;
+}
+
+void writer_close(OutputWriter* writer) {
+    writer_flush(writer);
+    if (writer->owns_buffer) free(writer->buffer);
+    writer->buffer = NULL;
+    writer->capacity = 0;
+}
+
+static _Thread_local OutputWriter thread_writer;
+static _Thread_local int thread_writer_ready = 0;
+static OutputWriter* main_thread_writer = NULL;
+
+void flush_main_thread_output() {
+    if (main_thread_writer) writer_flush(main_thread_writer);
+}
+
+// This thread's stdout writer; the buffer is allocated once, on first use
+OutputWriter* thread_output() {
+    if (!thread_writer_ready) {
+        char* buffer = malloc(WRITER_BUFFER_SIZE);
+        if (!buffer) {
+            fprintf(stderr, "Memory allocation failed for output buffer\n");
+            exit(EXIT_FAILURE);
+        }
+        writer_init_fd(&thread_writer, STDOUT_FILENO, buffer, WRITER_BUFFER_SIZE);
+        thread_writer.owns_buffer = 1;
+        thread_writer_ready = 1;
+        if (!main_thread_writer) {
+            main_thread_writer = &thread_writer;
+            atexit(flush_main_thread_output);
+        }
+    }
+    return &thread_writer;
+}
+
+// Modify the standard library print to format into the thread's writer
+void stdlib_print(RuntimeEnvironment* env, ASTNode** arguments, size_t arg_count) {
+    OutputWriter* out = thread_output();
+    for (size_t i = 0; i < arg_count; i++) {
+        int value = evaluate_expression(env, arguments[i]);
+        writer_put_int(out, value);
+        writer_put_char(out, ' ');
+    }
+    writer_put_char(out, '\n');
+}
+
+void generate_code_to(OutputWriter* out, ASTNode* node) {
+    if (!node) return; // Handle null nodes
+
+    switch (node->type) {
+        case NODE_NUMBER:
+            writer_put_string(out, node->number_value);
+            writer_put_char(out, ' ');
+            break;
+        case NODE_IDENTIFIER:
+            writer_put_string(out, node->identifier);
+            writer_put_char(out, ' ');
+            break;
+        case NODE_STRING:
+            writer_put_char(out, '"');
+            writer_put_string(out, node->string_value);
+            writer_write(out, "\" ", 2);
+            break;
+        case NODE_BINARY_EXPR:
+            writer_put_char(out, '(');
+            generate_code_to(out, node->binary.left);
+            writer_put_char(out, ' ');
+            writer_put_char(out, node->binary.op);
+            writer_put_char(out, ' ');
+            generate_code_to(out, node->binary.right);
+            writer_put_char(out, ')');
+            break;
+        case NODE_ASSIGNMENT:
+            writer_put_string(out, node->assignment.identifier);
+            writer_write(out, " = ", 3);
+            generate_code_to(out, node->assignment.value);
+            writer_write(out, ";\n", 2);
+            break;
+        case NODE_IF:
+            writer_write(out, "if (", 4);
+            generate_code_to(out, node->if_node.condition);
+            writer_write(out, ") {\n", 4);
+            generate_code_to(out, node->if_node.then_branch);
+            if (node->if_node.else_branch) {
+                writer_write(out, "} else {\n", 9);
+                generate_code_to(out, node->if_node.else_branch);
+            }
+            writer_write(out, "}\n", 2);
+            break;
+        case NODE_WHILE:
+            writer_write(out, "while (", 7);
+            generate_code_to(out, node->while_node.condition);
+            writer_write(out, ") {\n", 4);
+            generate_code_to(out, node->while_node.body);
+            writer_write(out, "}\n", 2);
+            break;
+        case NODE_RETURN:
+            writer_write(out, "return ", 7);
+            generate_code_to(out, node->return_node.value);
+            writer_write(out, ";\n", 2);
+            break;
+        case NODE_BLOCK:
+            writer_write(out, "{\n", 2);
+            for (size_t i = 0; i < node->block.size; i++) {
+                generate_code_to(out, node->block.statements[i]);
+            }
+            writer_write(out, "}\n", 2);
+            break;
+        case NODE_FUNCTION_CALL:
+        case NODE_TAIL_CALL:
+            writer_put_string(out, node->function_call.function_name);
+            writer_put_char(out, '(');
+            for (size_t i = 0; i < node->function_call.arg_count; i++) {
+                if (i > 0) writer_write(out, ", ", 2);
+                generate_code_to(out, node->function_call.arguments[i]);
+            }
+            writer_write(out, ") ", 2);
+            break;
+        case NODE_FUNCTION_DEF:
+            writer_write(out, "function ", 9);
+            writer_put_string(out, node->function_def.function_name);
+            writer_put_char(out, '(');
+            for (size_t i = 0; i < node->function_def.arg_count; i++) {
+                if (i > 0) writer_write(out, ", ", 2);
+                writer_put_string(out, node->function_def.parameters[i]);
+            }
+            writer_write(out, ") ", 2);
+            generate_code_to(out, node->function_def.body);
+            break;
+        default:
+            fprintf(stderr, "Unknown AST Node Type!\n");
+            break;
+    }
+}
+
+// Modify generate_code to go through the buffered writer
+void generate_code(ASTNode* node) {
+    generate_code_to(thread_output(), node);
+}
+
+int main() {
+    const char* source_code = "x = 10; while (x > 0) { x = x - 1; }";
+    Lexer* lexer = create_lexer(source_code);
+    Parser* parser = create_parser(lexer);
+
+    ASTNode* root = parse_block(parser);
+
+    // Generated code can be captured in memory as well as streamed
+    OutputWriter captured;
+    writer_init_memory(&captured, 0);
+    generate_code_to(&captured, root);
+
+    OutputWriter* out = thread_output();
+    writer_put_string(out, "Generated Code (");
+    writer_put_uint64(out, captured.size);
+    writer_put_string(out, " bytes):\n");
+    writer_put_string(out, writer_contents(&captured));
+    writer_put_double(out, 3.14159265, WRITER_DEFAULT_PRECISION);
+    writer_put_char(out, '\n');
+    writer_flush(out);
+
+    writer_close(&captured);
+    return 0;
+}
@@ -0,0 +1,187 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+
+// Parallel code generation for node definitions and modules.
+//
+// Each top-level definition is lowered on a worker thread into its own
+// fragment module. A fragment has private constant and symbol pools, so
+// workers share no mutable state and take no locks. Once all workers finish,
+// the driver walks the program in source order. It emits top-level
+// statements itself and relinks each fragment at the position of its
+// definition (link_fragment, see Compilation Cache.c), so pool indices are
+// assigned in the same order every time. The module's bytes don't depend on
+// thread count or scheduling, and are identical to compile_module's, nested
+// definitions included.
+//
+// Jobs are claimed from a shared atomic counter, so a long definition
+// doesn't hold up a thread's other jobs. UNS_COMPILE_THREADS overrides the
+// worker count, which defaults to the number of online cores.
+#define MAX_COMPILE_THREADS 64
+
+typedef void (*CompileJobFunction)(void* jobs, size_t index);
+
+typedef struct {
+    void* jobs;
+    size_t count;
+    size_t next;               // Next unclaimed job; advanced atomically
+    CompileJobFunction run;
+} CompilePool;
+
+size_t compile_thread_count() {
+    const char* configured = getenv("UNS_COMPILE_THREADS");
+    long threads = configured ? atol(configured) : sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads < 1) threads = 1;
+    if (threads > MAX_COMPILE_THREADS) threads = MAX_COMPILE_THREADS;
+    return (size_t)threads;
+}
+
+void* compile_worker(void* argument) {
+    CompilePool* pool = (CompilePool*)argument;
+    for (;;) {
+        size_t index = __atomic_fetch_add(&pool->next, 1, __ATOMIC_RELAXED);
+        if (index >= pool->count) return NULL;
+        pool->run(pool->jobs, index);
+    }
+}
+
+// Run every job; the calling thread works too, so one thread means no pthreads at all
+void run_compile_jobs(void* jobs, size_t count, CompileJobFunction run, size_t threads) {
+    CompilePool pool = { jobs, count, 0, run };
+    pthread_t workers[MAX_COMPILE_THREADS];
+    size_t started = 0;
+
+    if (threads > count) threads = count;
+    for (size_t i = 1; i < threads; i++) {
+        if (pthread_create(&workers[started], NULL, compile_worker, &pool) == 0) started++;
+    }
+    compile_worker(&pool);
+    for (size_t i = 0; i < started; i++) pthread_join(workers[i], NULL);
+}
+
+typedef struct {
+    ASTNode* definition;
+    CodeModule* fragment;
+} FunctionJob;
+
+void compile_function_job(void* jobs, size_t index) {
+    FunctionJob* job = &((FunctionJob*)jobs)[index];
+    job->fragment = compile_module(job->definition);
+}
+
+CodeModule* compile_module_parallel(ASTNode* root, size_t threads) {
+    size_t count = root && root->type == NODE_BLOCK ? root->block.size : 1;
+    FunctionJob* jobs = calloc(count, sizeof(FunctionJob));
+    size_t job_count = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        ASTNode* statement = root && root->type == NODE_BLOCK ? root->block.statements[i] : root;
+        if (statement && statement->type == NODE_FUNCTION_DEF) jobs[job_count++].definition = statement;
+    }
+    run_compile_jobs(jobs, job_count, compile_function_job, threads);
+
+    // Deterministic link, in source order
+    CodeModule* module = create_code_module();
+    add_code_object(module, "<main>");
+    Emitter emitter = { module, &module->functions[0], 0, root };
+    size_t next_job = 0;
+    for (size_t i = 0; i < count; i++) {
+        ASTNode* statement = root && root->type == NODE_BLOCK ? root->block.statements[i] : root;
+        if (statement && statement->type == NODE_FUNCTION_DEF) {
+            CodeModule* fragment = jobs[next_job++].fragment;
+            link_fragment(module, fragment);
+            free_code_module(fragment);
+            emitter.code = &module->functions[0]; // 'functions' may have moved
+        } else {
+            emit_statement(&emitter, statement);
+        }
+    }
+    emit_op(&emitter, OP_HALT);
+
+    free(jobs);
+    return module;
+}
+
+typedef struct {
+    ASTNode* root;
+    CodeModule* module;
+} ModuleJob;
+
+void compile_module_job(void* jobs, size_t index) {
+    ModuleJob* job = &((ModuleJob*)jobs)[index];
+    job->module = compile_module(job->root);
+}
+
+// Independent modules, one job each; modules[i] is the result for roots[i]
+void compile_modules_parallel(ASTNode** roots, CodeModule** modules, size_t count, size_t threads) {
+    ModuleJob* jobs = calloc(count ? count : 1, sizeof(ModuleJob));
+    for (size_t i = 0; i < count; i++) jobs[i].root = roots[i];
+    run_compile_jobs(jobs, count, compile_module_job, threads);
+    for (size_t i = 0; i < count; i++) modules[i] = jobs[i].module;
+    free(jobs);
+}
+
+typedef struct {
+    ASTNode* statement;
+    OutputWriter text;
+} TextJob;
+
+void generate_text_job(void* jobs, size_t index) {
+    TextJob* job = &((TextJob*)jobs)[index];
+    writer_init_memory(&job->text, 1024);
+    generate_code_to(&job->text, job->statement);
+}
+
+// Text output for generate_code: statements render in parallel into memory
+// writers, which are then concatenated in order
+void generate_code_parallel(OutputWriter* out, ASTNode* root, size_t threads) {
+    if (!root || root->type != NODE_BLOCK) {
+        generate_code_to(out, root);
+        return;
+    }
+
+    TextJob* jobs = calloc(root->block.size ? root->block.size : 1, sizeof(TextJob));
+    for (size_t i = 0; i < root->block.size; i++) jobs[i].statement = root->block.statements[i];
+    run_compile_jobs(jobs, root->block.size, generate_text_job, threads);
+
+    writer_write(out, "{\n", 2);
+    for (size_t i = 0; i < root->block.size; i++) {
+        writer_write(out, jobs[i].text.buffer, jobs[i].text.size);
+        writer_close(&jobs[i].text);
+    }
+    writer_write(out, "}\n", 2);
+    free(jobs);
+}
+
+int main() {
+    const char* source_code =
+        "function square(x) { return x * x; }"
+        "function cube(x) { return x * square(x); }"
+        "function hypot2(a, b) { return square(a) + square(b); }"
+        "function scale(n) { function twice(x) { return x * 2; } return twice(n) * 3; }"
+        "print(square(7), cube(3), hypot2(3, 4), scale(5));";
+    Lexer* lexer = create_lexer(source_code);
+    Parser* parser = create_parser(lexer);
+
+    ASTNode* root = parse_block(parser);
+
+    // The parallel build serializes to the same bytes as compile_module
+    CodeModule* serial = compile_module(root);
+    CodeModule* parallel = compile_module_parallel(root, compile_thread_count());
+    ByteBuffer a = serialize_code_module(serial);
+    ByteBuffer b = serialize_code_module(parallel);
+    printf("identical: %s\n", a.size == b.size && memcmp(a.data, b.data, a.size) == 0 ? "yes" : "no");
+
+    disassemble_module(parallel, stdout);
+    generate_code_parallel(thread_output(), root, compile_thread_count());
+    writer_flush(thread_output());
+
+    free(a.data);
+    free(b.data);
+    free_code_module(serial);
+    free_code_module(parallel);
+    return 0;
+}
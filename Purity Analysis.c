@@ -0,0 +1,340 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+// Purity classification and automatic memoization of deterministic nodes.
+//
+// A function is pure when its result depends only on its inputs: it performs
+// no I/O (print, export, append_to_file, ...), writes no program-level
+// variables, makes no random checks and calls only pure functions. Pure
+// functions get a bounded memo cache keyed on argument values.
+#define MAX_PURITY_FUNCTIONS 256
+#define MAX_GLOBAL_NAMES 256
+#define MEMO_MAX_ARGS 8
+#define MEMO_CACHE_SIZE 1024   // Entries per function; must be a power of two
+
+typedef enum {
+    PURITY_PURE,
+    PURITY_IMPURE
+} Purity;
+
+// Calls with observable effects, plus anything nondeterministic
+const char* impure_builtins[] = {
+    "print", "export", "append_to_file", "write_to_file", "read_from_file",
+    "load_binary_data", "error_log", "checkpoint", "random", NULL
+};
+
+typedef struct {
+    int valid;
+    uint64_t hash;
+    int args[MEMO_MAX_ARGS];
+    int result;
+} MemoEntry;
+
+typedef struct {
+    MemoEntry entries[MEMO_CACHE_SIZE];   // Direct-mapped; a colliding miss replaces the entry
+    size_t hits;
+    size_t misses;
+} MemoCache;
+
+typedef struct {
+    char* name;
+    ASTNode* def;
+    Purity purity;
+    MemoCache* cache;   // Only allocated for pure functions
+} PurityInfo;
+
+typedef struct {
+    PurityInfo functions[MAX_PURITY_FUNCTIONS];
+    size_t count;
+    char* global_names[MAX_GLOBAL_NAMES];   // Names assigned at program level
+    size_t global_count;
+} PurityTable;
+
+PurityTable purity_table = { .count = 0, .global_count = 0 };
+
+PurityInfo* find_purity(const char* name) {
+    for (size_t i = 0; i < purity_table.count; i++) {
+        if (strcmp(purity_table.functions[i].name, name) == 0) {
+            return &purity_table.functions[i];
+        }
+    }
+    return NULL;
+}
+
+int is_impure_builtin(const char* name) {
+    for (size_t i = 0; impure_builtins[i]; i++) {
+        if (strcmp(impure_builtins[i], name) == 0) return 1;
+    }
+    return 0;
+}
+
+int is_global_name(const char* name) {
+    for (size_t i = 0; i < purity_table.global_count; i++) {
+        if (strcmp(purity_table.global_names[i], name) == 0) return 1;
+    }
+    return 0;
+}
+
+// Does this subtree do anything that makes the enclosing function impure?
+int has_side_effects(ASTNode* node) {
+    if (!node) return 0;
+
+    switch (node->type) {
+        case NODE_NATIVE_CALL:
+            if (!(node->function_call.native->flags & BUILTIN_PURE)) return 1;
+            for (size_t i = 0; i < node->function_call.arg_count; i++) {
+                if (has_side_effects(node->function_call.arguments[i])) return 1;
+            }
+            return 0;
+        case NODE_FUNCTION_CALL:
+        case NODE_TAIL_CALL: {
+            if (is_impure_builtin(node->function_call.function_name)) return 1;
+            PurityInfo* callee = find_purity(node->function_call.function_name);
+            if (!callee || callee->purity == PURITY_IMPURE) return 1; // Unknown callees are assumed impure
+            for (size_t i = 0; i < node->function_call.arg_count; i++) {
+                if (has_side_effects(node->function_call.arguments[i])) return 1;
+            }
+            return 0;
+        }
+        case NODE_ASSIGNMENT:
+            if (is_global_name(node->assignment.identifier)) return 1;
+            return has_side_effects(node->assignment.value);
+        case NODE_BINARY_EXPR:
+            return has_side_effects(node->binary.left) || has_side_effects(node->binary.right);
+        case NODE_IF:
+            return has_side_effects(node->if_node.condition) ||
+                   has_side_effects(node->if_node.then_branch) ||
+                   has_side_effects(node->if_node.else_branch);
+        case NODE_WHILE:
+            return has_side_effects(node->while_node.condition) || has_side_effects(node->while_node.body);
+        case NODE_RETURN:
+            return has_side_effects(node->return_node.value);
+        case NODE_BLOCK:
+            for (size_t i = 0; i < node->block.size; i++) {
+                if (has_side_effects(node->block.statements[i])) return 1;
+            }
+            return 0;
+        case NODE_NUMBER:
+        case NODE_IDENTIFIER:
+        case NODE_STRING:
+            return 0;
+        default:
+            // export, checks and other statements are effects until proven otherwise
+            return 1;
+    }
+}
+
+void collect_purity_candidates(ASTNode* node) {
+    if (!node) return;
+
+    if (node->type == NODE_FUNCTION_DEF) {
+        if (find_purity(node->function_def.function_name)) {
+            // Redefinition: the callee can change at runtime, so neither version is cached
+            find_purity(node->function_def.function_name)->def = NULL;
+        } else if (purity_table.count < MAX_PURITY_FUNCTIONS) {
+            PurityInfo* info = &purity_table.functions[purity_table.count++];
+            info->name = node->function_def.function_name;
+            info->def = node;
+            info->purity = PURITY_PURE; // Optimistic; refined to a fixpoint below
+            info->cache = NULL;
+        }
+    } else if (node->type == NODE_ASSIGNMENT) {
+        if (!is_global_name(node->assignment.identifier) && purity_table.global_count < MAX_GLOBAL_NAMES) {
+            purity_table.global_names[purity_table.global_count++] = node->assignment.identifier;
+        }
+    } else if (node->type == NODE_BLOCK) {
+        for (size_t i = 0; i < node->block.size; i++) {
+            collect_purity_candidates(node->block.statements[i]);
+        }
+    }
+}
+
+// Classify every function in the program. Recursive functions such as
+// factorial start pure and stay pure unless some body proves otherwise.
+void classify_purity(ASTNode* root) {
+    collect_purity_candidates(root);
+
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        for (size_t i = 0; i < purity_table.count; i++) {
+            PurityInfo* info = &purity_table.functions[i];
+            if (info->purity == PURITY_IMPURE) continue;
+            if (!info->def || info->def->function_def.arg_count > MEMO_MAX_ARGS ||
+                has_side_effects(info->def->function_def.body)) {
+                info->purity = PURITY_IMPURE;
+                changed = 1;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < purity_table.count; i++) {
+        PurityInfo* info = &purity_table.functions[i];
+        if (info->purity == PURITY_PURE) {
+            info->cache = (MemoCache*)calloc(1, sizeof(MemoCache));
+        }
+    }
+}
+
+uint64_t hash_arguments(const int* args, size_t count) {
+    uint64_t hash = 1469598103934665603ULL; // FNV-1a offset basis
+    for (size_t i = 0; i < count; i++) {
+        hash ^= (uint32_t)args[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash ^ (hash >> 29);
+}
+
+// Run a function body with already-evaluated arguments. Tail calls reuse
+// the frame exactly as in execute_function, so a pure tail-recursive
+// function runs in constant C stack; only the entry call is memoized.
+int execute_function_with_values(Function* function, const int* values) {
+    RuntimeEnvironment* local_env = create_runtime_environment();
+    for (size_t i = 0; i < function->arg_count; i++) {
+        set_variable(local_env, function->arguments[i], values[i]);
+    }
+
+    int next_values[MAX_VARIABLES];
+    for (;;) {
+        int result = 0;
+        ASTNode* tail_call = NULL;
+        if (execute_statement(local_env, function->body, &result, &tail_call) != FLOW_TAIL_CALL) {
+            free_runtime_environment(local_env);
+            return result;
+        }
+
+        Function* callee = resolve_call_site(tail_call);
+        if (!callee) {
+            fprintf(stderr, "Undefined function '%s'\n", tail_call->function_call.function_name);
+            exit(EXIT_FAILURE);
+        }
+        if (!callee->body) {
+            stdlib_print(local_env, tail_call->function_call.arguments, tail_call->function_call.arg_count);
+            free_runtime_environment(local_env);
+            return 0;
+        }
+        if (tail_call->function_call.arg_count != callee->arg_count) {
+            fprintf(stderr, "Function '%s' expected %zu arguments but got %zu\n", callee->name, callee->arg_count, tail_call->function_call.arg_count);
+            exit(EXIT_FAILURE);
+        }
+
+        for (size_t i = 0; i < callee->arg_count; i++) {
+            next_values[i] = evaluate_expression(local_env, tail_call->function_call.arguments[i]);
+        }
+        reset_runtime_environment(local_env);
+        for (size_t i = 0; i < callee->arg_count; i++) {
+            set_variable(local_env, callee->arguments[i], next_values[i]);
+        }
+        function = callee;
+    }
+}
+
+int execute_function_memoized(RuntimeEnvironment* env, Function* function, PurityInfo* info, ASTNode** arguments, size_t arg_count) {
+    if (arg_count != function->arg_count) {
+        fprintf(stderr, "Function '%s' expected %zu arguments but got %zu\n", function->name, function->arg_count, arg_count);
+        exit(EXIT_FAILURE);
+    }
+
+    int values[MEMO_MAX_ARGS];
+    for (size_t i = 0; i < arg_count; i++) {
+        values[i] = evaluate_expression(env, arguments[i]);
+    }
+
+    uint64_t hash = hash_arguments(values, arg_count);
+    MemoEntry* entry = &info->cache->entries[hash & (MEMO_CACHE_SIZE - 1)];
+    if (entry->valid && entry->hash == hash && memcmp(entry->args, values, sizeof(int) * arg_count) == 0) {
+        info->cache->hits++;
+        return entry->result;
+    }
+
+    info->cache->misses++;
+    int result = execute_function_with_values(function, values);
+
+    // Re-fetch: recursive calls may have replaced the slot meanwhile
+    entry = &info->cache->entries[hash & (MEMO_CACHE_SIZE - 1)];
+    entry->valid = 1;
+    entry->hash = hash;
+    memcpy(entry->args, values, sizeof(int) * arg_count);
+    entry->result = result;
+    return result;
+}
+
+// Modify function call execution so pure functions go through their memo cache
+int execute_function_call(RuntimeEnvironment* env, ASTNode* node) {
+    if (strcmp(node->function_call.function_name, "print") == 0) {
+        stdlib_print(env, node->function_call.arguments, node->function_call.arg_count);
+        return 0;
+    }
+
+    Function* function = resolve_call_site(node);
+    if (!function) {
+        fprintf(stderr, "Undefined function '%s'\n", node->function_call.function_name);
+        exit(EXIT_FAILURE);
+    }
+
+    PurityInfo* info = find_purity(function->name);
+    if (info && info->purity == PURITY_PURE) {
+        return execute_function_memoized(env, function, info, node->function_call.arguments, node->function_call.arg_count);
+    }
+    return execute_function(env, function, node->function_call.arguments, node->function_call.arg_count);
+}
+
+// Modify evaluate_expression so calls inside expressions, such as
+// print(factorial(n)) and n * factorial(n - 1), also use the memo cache
+int evaluate_expression(RuntimeEnvironment* env, ASTNode* node) {
+    switch (node->type) {
+        case NODE_NUMBER:
+            return atoi(node->number_value);
+        case NODE_IDENTIFIER:
+            return get_variable(env, node->identifier);
+        case NODE_FUNCTION_CALL:
+        case NODE_TAIL_CALL:
+            return execute_function_call(env, node);
+        case NODE_BINARY_EXPR:
+            {
+                int left_value = evaluate_expression(env, node->binary.left);
+                int right_value = evaluate_expression(env, node->binary.right);
+                switch (node->binary.op) {
+                    case '+': return left_value + right_value;
+                    case '-': return left_value - right_value;
+                    case '*': return left_value * right_value;
+                    case '/': return left_value / right_value;
+                    case '<': return left_value < right_value;
+                    case '>': return left_value > right_value;
+                }
+            }
+            break;
+    }
+    return 0;
+}
+
+void print_memo_statistics() {
+    for (size_t i = 0; i < purity_table.count; i++) {
+        PurityInfo* info = &purity_table.functions[i];
+        if (info->cache) {
+            printf("%s: pure, %zu hits, %zu misses\n", info->name, info->cache->hits, info->cache->misses);
+        } else {
+            printf("%s: impure\n", info->name);
+        }
+    }
+}
+
+int main() {
+    const char* source_code =
+        "function factorial(n) { if (n < 2) { return 1; } return n * factorial(n - 1); }"
+        "function show(n) { print(factorial(n)); }"
+        "{ show(10); show(10); show(12); }";
+    Lexer* lexer = create_lexer(source_code);
+    Parser* parser = create_parser(lexer);
+
+    initialize_stdlib();
+
+    ASTNode* root = parse_block(parser);
+    classify_purity(root);
+
+    execute_node(create_runtime_environment(), root);
+    print_memo_statistics();
+    return 0;
+}
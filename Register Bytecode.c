@@ -0,0 +1,583 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+// Register-based variant of the stack bytecode, in the style of Lua 5.
+//
+// Every frame has a window of registers: locals occupy registers
+// 0..local_count-1 and stack temporaries follow them. Instructions name their
+// operands directly. Source operands are "RK" operands: values below
+// RK_CONSTANT are registers, values with the bit set index the constant pool.
+//
+// Code is produced in two steps. translate_to_registers maps each stack
+// instruction one-to-one onto register moves and three-address operations.
+// peephole_optimize then removes the moves: LOAD/PUSH operands are substituted
+// into their single use, op+STORE pairs write straight into the local, and
+// compare+branch pairs become superinstructions. For `x = x + 1` that turns
+// four stack instructions into one ADD.
+#define RK_CONSTANT 0x8000
+#define RK_IS_CONSTANT(x) ((x) & RK_CONSTANT)
+#define REG_STACK_SIZE (1024 * 1024)
+#define REG_MAX_FRAMES 65536
+
+typedef enum {
+    R_MOVE,              // a <- RK(b)
+    R_ADD,               // a <- RK(b) + RK(c)
+    R_SUB,
+    R_MUL,
+    R_DIV,
+    R_LT,
+    R_GT,
+    R_JUMP,              // goto a
+    R_JUMP_IF_FALSE,     // if !RK(b) goto a
+    R_JUMP_IF_NOT_LT,    // if !(RK(b) < RK(c)) goto a     (superinstruction)
+    R_JUMP_IF_NOT_GT,    // if !(RK(b) > RK(c)) goto a     (superinstruction)
+    R_CALL,              // a..a+c-1 <- args, call function b, result in a
+    R_TAIL_CALL,         // same operands, reuses the frame
+    R_UNDEFINED,         // call to symbol b, which no function defines
+    R_PRINT,             // print a..a+c-1
+    R_RETURN,            // return RK(b)
+    R_HALT,
+    R_NOP,               // Removed by the peephole pass before execution
+    R_COUNT
+} RegOpCode;
+
+const char* reg_opcode_names[R_COUNT] = {
+    "MOVE", "ADD", "SUB", "MUL", "DIV", "LT", "GT", "JUMP", "JUMP_IF_FALSE",
+    "JUMP_IF_NOT_LT", "JUMP_IF_NOT_GT", "CALL", "TAIL_CALL", "UNDEFINED", "PRINT", "RETURN", "HALT", "NOP"
+};
+
+typedef struct {
+    uint32_t a;    // Destination register, jump target or call base
+    uint16_t b;
+    uint16_t c;
+    uint8_t op;
+} RegInstruction;
+
+typedef struct {
+    const char* name;
+    RegInstruction* code;
+    size_t length;
+    uint16_t arg_count;
+    uint16_t local_count;
+    uint16_t register_count;   // Locals plus the deepest temporary
+} RegFunction;
+
+typedef struct {
+    CodeModule* module;        // Constant pool and symbols are shared with the stack code
+    RegFunction* functions;
+    size_t function_count;
+} RegModule;
+
+int is_binary_reg_op(uint8_t op) {
+    return op >= R_ADD && op <= R_GT;
+}
+
+int is_jump_reg_op(uint8_t op) {
+    return op == R_JUMP || op == R_JUMP_IF_FALSE || op == R_JUMP_IF_NOT_LT || op == R_JUMP_IF_NOT_GT;
+}
+
+int is_window_reg_op(uint8_t op) {
+    return op == R_CALL || op == R_TAIL_CALL || op == R_PRINT;
+}
+
+void append_reg_instruction(RegFunction* function, size_t* capacity, uint8_t op, uint32_t a, uint16_t b, uint16_t c) {
+    function->code = grow_array(function->code, capacity, function->length + 1, sizeof(RegInstruction));
+    RegInstruction* instruction = &function->code[function->length++];
+    instruction->op = op;
+    instruction->a = a;
+    instruction->b = b;
+    instruction->c = c;
+}
+
+// One-to-one translation from stack code; stack depth d lives in register local_count + d
+void translate_to_registers(CodeModule* module, size_t f, RegFunction* function) {
+    CodeObject* code = &module->functions[f];
+    size_t capacity = 0;
+    uint32_t* new_index = malloc(sizeof(uint32_t) * (code->code.size + 1));
+    uint32_t depth = 0;
+    uint32_t max_depth = 0;
+    uint32_t base = code->local_count;
+
+    function->name = code->name;
+    function->arg_count = code->arg_count;
+    function->local_count = code->local_count;
+    function->code = NULL;
+    function->length = 0;
+
+    for (size_t pc = 0; pc < code->code.size; pc += opcode_sizes[code->code.data[pc]]) {
+        const uint8_t* ip = code->code.data + pc;
+        new_index[pc] = (uint32_t)function->length;
+
+        switch ((OpCode)ip[0]) {
+            case OP_PUSH_CONST: {
+                uint16_t k = read_u16(ip + 1);
+                if (k >= RK_CONSTANT) {
+                    fprintf(stderr, "Too many constants for register code in '%s'!\n", code->name);
+                    exit(EXIT_FAILURE);
+                }
+                append_reg_instruction(function, &capacity, R_MOVE, base + depth++, k | RK_CONSTANT, 0);
+                break;
+            }
+            case OP_LOAD:
+                append_reg_instruction(function, &capacity, R_MOVE, base + depth++, read_u16(ip + 1), 0);
+                break;
+            case OP_STORE:
+                depth--;
+                append_reg_instruction(function, &capacity, R_MOVE, read_u16(ip + 1), base + depth, 0);
+                break;
+            case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV: case OP_LT: case OP_GT:
+                depth--;
+                append_reg_instruction(function, &capacity, R_ADD + (ip[0] - OP_ADD), base + depth - 1, base + depth - 1, base + depth);
+                break;
+            case OP_JUMP:
+                append_reg_instruction(function, &capacity, R_JUMP, read_u32(ip + 1), 0, 0);
+                break;
+            case OP_JUMP_IF_FALSE:
+                depth--;
+                append_reg_instruction(function, &capacity, R_JUMP_IF_FALSE, read_u32(ip + 1), base + depth, 0);
+                break;
+            case OP_CALL:
+            case OP_TAIL_CALL: {
+                uint8_t argc = ip[3];
+                const char* name = module->symbols[read_u16(ip + 1)];
+                int target = find_code_object(module, name);
+                depth -= argc;
+                if (target < 0) {
+                    append_reg_instruction(function, &capacity, R_UNDEFINED, base + depth, read_u16(ip + 1), argc);
+                } else {
+                    append_reg_instruction(function, &capacity, ip[0] == OP_CALL ? R_CALL : R_TAIL_CALL, base + depth, (uint16_t)target, argc);
+                }
+                if (ip[0] == OP_CALL) depth++;
+                break;
+            }
+            case OP_PRINT:
+                depth -= ip[1];
+                append_reg_instruction(function, &capacity, R_PRINT, base + depth, 0, ip[1]);
+                break;
+            case OP_POP:
+                depth--;
+                break;
+            case OP_RETURN:
+                depth--;
+                append_reg_instruction(function, &capacity, R_RETURN, 0, base + depth, 0);
+                break;
+            case OP_HALT:
+                append_reg_instruction(function, &capacity, R_HALT, 0, 0, 0);
+                break;
+            default:
+                break;
+        }
+        if (depth > max_depth) max_depth = depth;
+    }
+    new_index[code->code.size] = (uint32_t)function->length;
+
+    // Jump operands still hold byte offsets into the stack code
+    for (size_t i = 0; i < function->length; i++) {
+        if (is_jump_reg_op(function->code[i].op)) {
+            function->code[i].a = new_index[function->code[i].a];
+        }
+    }
+
+    if (base + max_depth >= RK_CONSTANT) {
+        fprintf(stderr, "Too many registers in '%s'!\n", code->name);
+        exit(EXIT_FAILURE);
+    }
+    function->register_count = (uint16_t)(base + max_depth);
+    free(new_index);
+}
+
+// Does the instruction read register r, and is that read an explicit operand?
+int reads_register(RegInstruction* instruction, uint16_t r, int* explicit_read) {
+    uint8_t op = instruction->op;
+    *explicit_read = 1;
+    if (op == R_MOVE || op == R_JUMP_IF_FALSE || op == R_RETURN) return instruction->b == r;
+    if (is_binary_reg_op(op) || op == R_JUMP_IF_NOT_LT || op == R_JUMP_IF_NOT_GT) {
+        return instruction->b == r || instruction->c == r;
+    }
+    if (is_window_reg_op(op) || op == R_UNDEFINED) {
+        *explicit_read = 0;
+        return r >= instruction->a && r < instruction->a + instruction->c;
+    }
+    return 0;
+}
+
+int writes_register(RegInstruction* instruction, uint16_t r) {
+    uint8_t op = instruction->op;
+    if (op == R_MOVE || is_binary_reg_op(op)) return instruction->a == r;
+    if (op == R_CALL) return instruction->a == r;
+    return 0;
+}
+
+void replace_read(RegInstruction* instruction, uint16_t from, uint16_t to) {
+    if (instruction->b == from) instruction->b = to;
+    else if (instruction->c == from) instruction->c = to;
+}
+
+void peephole_optimize(RegFunction* function) {
+    size_t length = function->length;
+    RegInstruction* code = function->code;
+    uint16_t first_temp = function->local_count;
+
+    char* is_target = calloc(length + 1, 1);
+    for (size_t i = 0; i < length; i++) {
+        if (is_jump_reg_op(code[i].op)) is_target[code[i].a] = 1;
+    }
+
+    // 1. Forward-substitute `MOVE temp <- src` into the single reader of temp,
+    //    or drop it when temp is overwritten first (the `PUSH 0; POP` of a print)
+    for (size_t i = 0; i < length; i++) {
+        if (code[i].op != R_MOVE || code[i].a < first_temp) continue;
+        uint16_t temp = (uint16_t)code[i].a;
+        uint16_t source = code[i].b;
+
+        for (size_t j = i + 1; j < length; j++) {
+            if (is_target[j]) break;
+            int explicit_read;
+            if (reads_register(&code[j], temp, &explicit_read)) {
+                if (explicit_read) {
+                    replace_read(&code[j], temp, source);
+                    code[i].op = R_NOP;
+                }
+                break;
+            }
+            if (writes_register(&code[j], temp)) {
+                code[i].op = R_NOP;   // Pushed and popped without a reader
+                break;
+            }
+            if (is_jump_reg_op(code[j].op)) break;
+            // The source register must still hold the same value at the reader
+            if (!RK_IS_CONSTANT(source) && writes_register(&code[j], source)) break;
+            if (code[j].op == R_CALL && !RK_IS_CONSTANT(source) && source >= code[j].a) break;
+        }
+    }
+
+    // 2. `op temp <- b, c; MOVE x <- temp` becomes `op x <- b, c`
+    for (size_t i = 0; i + 1 < length; i++) {
+        if (!is_binary_reg_op(code[i].op) || code[i].a < first_temp) continue;
+        size_t j = i + 1;
+        while (j < length && code[j].op == R_NOP && !is_target[j]) j++;
+        if (j >= length || is_target[j]) continue;
+        if (code[j].op == R_MOVE && code[j].b == code[i].a) {
+            code[i].a = code[j].a;
+            code[j].op = R_NOP;
+        }
+    }
+
+    // 3. Superinstructions: compare into temp followed by a branch on it
+    for (size_t i = 0; i + 1 < length; i++) {
+        if ((code[i].op != R_LT && code[i].op != R_GT) || code[i].a < first_temp) continue;
+        size_t j = i + 1;
+        while (j < length && code[j].op == R_NOP && !is_target[j]) j++;
+        if (j >= length || is_target[j]) continue;
+        if (code[j].op == R_JUMP_IF_FALSE && code[j].b == code[i].a) {
+            code[j].op = code[i].op == R_LT ? R_JUMP_IF_NOT_LT : R_JUMP_IF_NOT_GT;
+            code[j].b = code[i].b;
+            code[j].c = code[i].c;
+            code[i].op = R_NOP;
+        }
+    }
+
+    // 4. Jump threading: a jump to an unconditional jump goes straight to its target
+    for (size_t i = 0; i < length; i++) {
+        if (!is_jump_reg_op(code[i].op)) continue;
+        for (int hops = 0; hops < 8; hops++) {
+            uint32_t target = code[i].a;
+            while (target < length && code[target].op == R_NOP) target++;
+            if (target >= length || code[target].op != R_JUMP || target == i) break;
+            code[i].a = code[target].a;
+        }
+    }
+
+    // 5. Compact away NOPs; a target on a NOP moves to the next live instruction
+    uint32_t* new_index = malloc(sizeof(uint32_t) * (length + 1));
+    size_t live = 0;
+    for (size_t i = 0; i < length; i++) {
+        new_index[i] = (uint32_t)live;
+        if (code[i].op != R_NOP) code[live++] = code[i];
+    }
+    new_index[length] = (uint32_t)live;
+    for (size_t i = 0; i < live; i++) {
+        if (is_jump_reg_op(code[i].op)) code[i].a = new_index[code[i].a];
+    }
+    function->length = live;
+
+    free(new_index);
+    free(is_target);
+}
+
+RegModule* compile_register_module(CodeModule* module) {
+    RegModule* reg_module = (RegModule*)calloc(1, sizeof(RegModule));
+    reg_module->module = module;
+    reg_module->function_count = module->function_count;
+    reg_module->functions = calloc(module->function_count ? module->function_count : 1, sizeof(RegFunction));
+    for (size_t f = 0; f < module->function_count; f++) {
+        translate_to_registers(module, f, &reg_module->functions[f]);
+        peephole_optimize(&reg_module->functions[f]);
+    }
+    return reg_module;
+}
+
+void free_register_module(RegModule* reg_module) {
+    for (size_t f = 0; f < reg_module->function_count; f++) free(reg_module->functions[f].code);
+    free(reg_module->functions);
+    free(reg_module);
+}
+
+void print_rk(FILE* out, CodeModule* module, uint16_t operand) {
+    if (RK_IS_CONSTANT(operand)) {
+        fprintf(out, "#%d", module->constants[operand & ~RK_CONSTANT]);
+    } else {
+        fprintf(out, "r%u", operand);
+    }
+}
+
+void disassemble_register_module(RegModule* reg_module, FILE* out) {
+    for (size_t f = 0; f < reg_module->function_count; f++) {
+        RegFunction* function = &reg_module->functions[f];
+        fprintf(out, "%s (args %u, registers %u):\n", function->name, function->arg_count, function->register_count);
+        for (size_t i = 0; i < function->length; i++) {
+            RegInstruction* instruction = &function->code[i];
+            fprintf(out, "  %04zu %s", i, reg_opcode_names[instruction->op]);
+            switch (instruction->op) {
+                case R_MOVE:
+                    fprintf(out, " r%u ", instruction->a);
+                    print_rk(out, reg_module->module, instruction->b);
+                    break;
+                case R_ADD: case R_SUB: case R_MUL: case R_DIV: case R_LT: case R_GT:
+                    fprintf(out, " r%u ", instruction->a);
+                    print_rk(out, reg_module->module, instruction->b);
+                    fprintf(out, " ");
+                    print_rk(out, reg_module->module, instruction->c);
+                    break;
+                case R_JUMP:
+                    fprintf(out, " %u", instruction->a);
+                    break;
+                case R_JUMP_IF_FALSE:
+                    fprintf(out, " %u ", instruction->a);
+                    print_rk(out, reg_module->module, instruction->b);
+                    break;
+                case R_JUMP_IF_NOT_LT: case R_JUMP_IF_NOT_GT:
+                    fprintf(out, " %u ", instruction->a);
+                    print_rk(out, reg_module->module, instruction->b);
+                    fprintf(out, " ");
+                    print_rk(out, reg_module->module, instruction->c);
+                    break;
+                case R_CALL: case R_TAIL_CALL:
+                    fprintf(out, " r%u %s/%u", instruction->a, reg_module->functions[instruction->b].name, instruction->c);
+                    break;
+                case R_UNDEFINED:
+                    fprintf(out, " %s", reg_module->module->symbols[instruction->b]);
+                    break;
+                case R_PRINT:
+                    fprintf(out, " r%u/%u", instruction->a, instruction->c);
+                    break;
+                case R_RETURN:
+                    fprintf(out, " ");
+                    print_rk(out, reg_module->module, instruction->b);
+                    break;
+                default:
+                    break;
+            }
+            fprintf(out, "\n");
+        }
+    }
+}
+
+typedef struct {
+    RegFunction* function;
+    RegInstruction* return_ip;
+    int32_t* registers;
+    int32_t* result;     // Caller register receiving the return value
+} RegFrame;
+
+#ifdef VM_THREADED
+#define REG_CASE(op) L_##op:
+#define REG_DISPATCH() goto *reg_labels[ip->op]
+#else
+#define REG_CASE(op) case op:
+#define REG_DISPATCH() goto dispatch
+#endif
+
+#define RK(x) (RK_IS_CONSTANT(x) ? constants[(x) & ~RK_CONSTANT] : registers[(x)])
+
+// Register interpreter; same frame discipline as the stack VM
+int32_t reg_execute(RegModule* reg_module, size_t function_index, const int32_t* args, size_t arg_count) {
+#ifdef VM_THREADED
+    static const void* reg_labels[R_COUNT] = {
+        &&L_R_MOVE, &&L_R_ADD, &&L_R_SUB, &&L_R_MUL, &&L_R_DIV, &&L_R_LT, &&L_R_GT, &&L_R_JUMP,
+        &&L_R_JUMP_IF_FALSE, &&L_R_JUMP_IF_NOT_LT, &&L_R_JUMP_IF_NOT_GT, &&L_R_CALL, &&L_R_TAIL_CALL,
+        &&L_R_UNDEFINED, &&L_R_PRINT, &&L_R_RETURN, &&L_R_HALT, &&L_R_NOP
+    };
+#endif
+    const int32_t* constants = reg_module->module->constants;
+    RegFunction* function = &reg_module->functions[function_index];
+    if (arg_count != function->arg_count) vm_error("wrong number of arguments to", function->name);
+
+    int32_t* stack = calloc(REG_STACK_SIZE, sizeof(int32_t));
+    RegFrame* frames = malloc(sizeof(RegFrame) * REG_MAX_FRAMES);
+    if (!stack || !frames) vm_error("out of memory creating register VM", NULL);
+
+    int32_t result = 0;
+    if (arg_count > 0) memcpy(stack, args, sizeof(int32_t) * arg_count);
+    size_t frame_count = 1;
+    RegFrame* frame = &frames[0];
+    frame->function = function;
+    frame->return_ip = NULL;
+    frame->registers = stack;
+    frame->result = &result;
+
+    int32_t* registers = stack;
+    RegInstruction* ip = function->code;
+
+#ifdef VM_THREADED
+    REG_DISPATCH();
+#else
+dispatch:
+    switch (ip->op) {
+#endif
+
+    REG_CASE(R_MOVE)
+        registers[ip->a] = RK(ip->b);
+        ip++;
+        REG_DISPATCH();
+
+    REG_CASE(R_ADD)
+        registers[ip->a] = (int32_t)((uint32_t)RK(ip->b) + (uint32_t)RK(ip->c));
+        ip++;
+        REG_DISPATCH();
+
+    REG_CASE(R_SUB)
+        registers[ip->a] = (int32_t)((uint32_t)RK(ip->b) - (uint32_t)RK(ip->c));
+        ip++;
+        REG_DISPATCH();
+
+    REG_CASE(R_MUL)
+        registers[ip->a] = (int32_t)((uint32_t)RK(ip->b) * (uint32_t)RK(ip->c));
+        ip++;
+        REG_DISPATCH();
+
+    REG_CASE(R_DIV) {
+        int32_t divisor = RK(ip->c);
+        if (divisor == 0) vm_error("division by zero in", frame->function->name);
+        registers[ip->a] = divisor == -1 ? (int32_t)(0u - (uint32_t)RK(ip->b)) : RK(ip->b) / divisor;
+        ip++;
+        REG_DISPATCH();
+    }
+
+    REG_CASE(R_LT)
+        registers[ip->a] = RK(ip->b) < RK(ip->c);
+        ip++;
+        REG_DISPATCH();
+
+    REG_CASE(R_GT)
+        registers[ip->a] = RK(ip->b) > RK(ip->c);
+        ip++;
+        REG_DISPATCH();
+
+    REG_CASE(R_JUMP)
+        ip = frame->function->code + ip->a;
+        REG_DISPATCH();
+
+    REG_CASE(R_JUMP_IF_FALSE)
+        ip = RK(ip->b) ? ip + 1 : frame->function->code + ip->a;
+        REG_DISPATCH();
+
+    REG_CASE(R_JUMP_IF_NOT_LT)
+        ip = RK(ip->b) < RK(ip->c) ? ip + 1 : frame->function->code + ip->a;
+        REG_DISPATCH();
+
+    REG_CASE(R_JUMP_IF_NOT_GT)
+        ip = RK(ip->b) > RK(ip->c) ? ip + 1 : frame->function->code + ip->a;
+        REG_DISPATCH();
+
+    REG_CASE(R_CALL) {
+        RegFunction* callee = &reg_module->functions[ip->b];
+        if (ip->c != callee->arg_count) vm_error("wrong number of arguments to", callee->name);
+        if (frame_count >= REG_MAX_FRAMES) vm_error("call stack overflow in", callee->name);
+        int32_t* callee_registers = registers + ip->a;   // Arguments are already in place
+        if (callee_registers + callee->register_count > stack + REG_STACK_SIZE) vm_error("register stack overflow in", callee->name);
+        // Locals start at zero, as in the stack VM, not with the caller's leftovers
+        memset(callee_registers + callee->arg_count, 0, sizeof(int32_t) * (callee->register_count - callee->arg_count));
+
+        RegFrame* caller = frame;
+        frame = &frames[frame_count++];
+        frame->function = callee;
+        frame->return_ip = ip + 1;
+        frame->registers = callee_registers;
+        frame->result = caller->registers + ip->a;
+        registers = callee_registers;
+        ip = callee->code;
+        REG_DISPATCH();
+    }
+
+    REG_CASE(R_TAIL_CALL) {
+        RegFunction* callee = &reg_module->functions[ip->b];
+        if (ip->c != callee->arg_count) vm_error("wrong number of arguments to", callee->name);
+        if (registers + callee->register_count > stack + REG_STACK_SIZE) vm_error("register stack overflow in", callee->name);
+        memmove(registers, registers + ip->a, sizeof(int32_t) * ip->c);
+        memset(registers + callee->arg_count, 0, sizeof(int32_t) * (callee->register_count - callee->arg_count));
+        frame->function = callee;
+        ip = callee->code;
+        REG_DISPATCH();
+    }
+
+    REG_CASE(R_UNDEFINED)
+        vm_error("undefined function", reg_module->module->symbols[ip->b]);
+        REG_DISPATCH();
+
+    REG_CASE(R_PRINT)
+        for (uint16_t i = 0; i < ip->c; i++) printf("%d ", registers[ip->a + i]);
+        printf("\n");
+        ip++;
+        REG_DISPATCH();
+
+    REG_CASE(R_RETURN) {
+        *frame->result = RK(ip->b);
+        ip = frame->return_ip;
+        if (--frame_count == 0) goto done;
+        frame = &frames[frame_count - 1];
+        registers = frame->registers;
+        REG_DISPATCH();
+    }
+
+    REG_CASE(R_HALT)
+        goto done;
+
+    REG_CASE(R_NOP)
+        ip++;
+        REG_DISPATCH();
+
+#ifndef VM_THREADED
+    default:
+        vm_error("invalid opcode", NULL);
+    }
+#endif
+
+done:
+    free(stack);
+    free(frames);
+    return result;
+}
+
+int main() {
+    const char* source_code =
+        "i = 0; total = 0;"
+        "while (i < 1000000) { total = total + i * 2; i = i + 1; }"
+        "print(total);";
+    Lexer* lexer = create_lexer(source_code);
+    Parser* parser = create_parser(lexer);
+
+    ASTNode* root = parse_block(parser);
+    CodeModule* module = compile_module(root);
+    RegModule* reg_module = compile_register_module(module);
+
+    // The loop body is three instructions: MUL, ADD into total, ADD into i
+    disassemble_register_module(reg_module, stdout);
+    reg_execute(reg_module, 0, NULL, 0);
+
+    free_register_module(reg_module);
+    free_code_module(module);
+    return 0;
+}
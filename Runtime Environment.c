@@ -1,48 +1,260 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <stdint.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
-#define MAX_VARIABLES 256
+// Variables live in a dense array kept in insertion order, so iteration is
+// stable. A SwissTable-style index maps each key to its position in that
+// array. The index has one control byte per slot: 7 bits of the key's hash,
+// or EMPTY. Lookups compare a whole group of 16 control bytes at once
+// (SSE2 when available, a scalar loop otherwise) and only touch slots whose
+// byte matches. Keys are interned Symbols, so a hit is a pointer compare.
+// Both tables grow at 7/8 load; nothing is ever removed individually, so
+// there are no tombstones.
+#define MAX_VARIABLES 256         // Parameters per function; variables are unbounded
+#define GROUP_WIDTH 16
+#define CONTROL_EMPTY ((int8_t)-128)
+#define MIN_INDEX_CAPACITY 16
 
 typedef struct {
     char* name;
-    int value;
+    uint64_t hash;
+} Symbol;
+
+typedef struct {
+    Symbol* symbol;
+    BoxedValue value;           // See NaN Boxing.c
 } Variable;
 
 typedef struct {
-    Variable variables[MAX_VARIABLES];
+    int8_t* control;            // capacity + GROUP_WIDTH bytes; the tail mirrors the first group
+    uint32_t* slots;            // Position in the dense array
+    size_t capacity;            // Power of two
+} SwissIndex;
+
+typedef struct {
+    Variable* variables;        // Insertion order
     size_t var_count;
+    size_t var_capacity;
+    SwissIndex index;
 } RuntimeEnvironment;
 
+uint64_t hash_name(const char* name) {
+    uint64_t hash = 1469598103934665603ULL;
+    for (const unsigned char* p = (const unsigned char*)name; *p; p++) {
+        hash = (hash ^ *p) * 1099511628211ULL;
+    }
+    hash ^= hash >> 32;
+    hash *= 0xd6e8feb86659fd93ULL;
+    return hash ^ (hash >> 32);
+}
+
+// Bit i is set when control byte i of the group equals 'byte'
+uint32_t group_match(const int8_t* group, int8_t byte) {
+#ifdef __SSE2__
+    __m128i bytes = _mm_loadu_si128((const __m128i*)group);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(byte)));
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < GROUP_WIDTH; i++) {
+        if (group[i] == byte) mask |= 1u << i;
+    }
+    return mask;
+#endif
+}
+
+int8_t hash_tag(uint64_t hash) {
+    return (int8_t)(hash >> 57); // 0..127, never EMPTY
+}
+
+void init_swiss_index(SwissIndex* index, size_t capacity) {
+    index->capacity = capacity;
+    index->control = malloc(capacity + GROUP_WIDTH);
+    index->slots = malloc(sizeof(uint32_t) * capacity);
+    if (!index->control || !index->slots) {
+        fprintf(stderr, "Out of memory growing variable table\n");
+        exit(EXIT_FAILURE);
+    }
+    memset(index->control, CONTROL_EMPTY, capacity + GROUP_WIDTH);
+}
+
+void set_control(SwissIndex* index, size_t position, int8_t tag) {
+    index->control[position] = tag;
+    if (position < GROUP_WIDTH) index->control[index->capacity + position] = tag;
+}
+
+// First EMPTY slot on the probe sequence for 'hash'. Triangular steps over
+// groups visit every slot because capacity is a power of two.
+size_t find_empty_slot(SwissIndex* index, uint64_t hash) {
+    size_t mask = index->capacity - 1;
+    size_t position = (size_t)hash & mask;
+    for (size_t stride = GROUP_WIDTH;; stride += GROUP_WIDTH) {
+        uint32_t empty = group_match(index->control + position, CONTROL_EMPTY);
+        if (empty) return (position + __builtin_ctz(empty)) & mask;
+        position = (position + stride) & mask;
+    }
+}
+
+void insert_index(SwissIndex* index, uint64_t hash, uint32_t slot) {
+    size_t position = find_empty_slot(index, hash);
+    set_control(index, position, hash_tag(hash));
+    index->slots[position] = slot;
+}
+
+// Interned names: one Symbol per distinct string, for the life of the program
+typedef struct {
+    Symbol** symbols;
+    size_t count;
+    size_t capacity;
+    SwissIndex index;
+} SymbolTable;
+
+SymbolTable symbol_table = { NULL, 0, 0, { NULL, NULL, 0 } };
+
+Symbol* lookup_symbol(const char* name) {
+    if (!symbol_table.count) return NULL;
+    uint64_t hash = hash_name(name);
+    int8_t tag = hash_tag(hash);
+    SwissIndex* index = &symbol_table.index;
+    size_t mask = index->capacity - 1;
+    size_t position = (size_t)hash & mask;
+    for (size_t stride = GROUP_WIDTH;; stride += GROUP_WIDTH) {
+        const int8_t* group = index->control + position;
+        for (uint32_t match = group_match(group, tag); match; match &= match - 1) {
+            Symbol* symbol = symbol_table.symbols[index->slots[(position + __builtin_ctz(match)) & mask]];
+            if (symbol->hash == hash && strcmp(symbol->name, name) == 0) return symbol;
+        }
+        if (group_match(group, CONTROL_EMPTY)) return NULL;
+        position = (position + stride) & mask;
+    }
+}
+
+Symbol* intern_name(const char* name) {
+    Symbol* symbol = lookup_symbol(name);
+    if (symbol) return symbol;
+
+    if (symbol_table.count == symbol_table.capacity) {
+        symbol_table.capacity = symbol_table.capacity ? symbol_table.capacity * 2 : 64;
+        symbol_table.symbols = realloc(symbol_table.symbols, sizeof(Symbol*) * symbol_table.capacity);
+    }
+    if ((symbol_table.count + 1) * 8 > symbol_table.index.capacity * 7) {
+        free(symbol_table.index.control);
+        free(symbol_table.index.slots);
+        init_swiss_index(&symbol_table.index, symbol_table.index.capacity ? symbol_table.index.capacity * 2 : 128);
+        for (size_t i = 0; i < symbol_table.count; i++) insert_index(&symbol_table.index, symbol_table.symbols[i]->hash, (uint32_t)i);
+    }
+
+    symbol = malloc(sizeof(Symbol));
+    if (!symbol || !symbol_table.symbols) {
+        fprintf(stderr, "Out of memory interning '%s'\n", name);
+        exit(EXIT_FAILURE);
+    }
+    symbol->name = strdup(name);
+    symbol->hash = hash_name(name);
+    insert_index(&symbol_table.index, symbol->hash, (uint32_t)symbol_table.count);
+    symbol_table.symbols[symbol_table.count++] = symbol;
+    return symbol;
+}
+
 RuntimeEnvironment* create_runtime_environment() {
     RuntimeEnvironment* env = malloc(sizeof(RuntimeEnvironment));
+    env->variables = malloc(sizeof(Variable) * 8);
     env->var_count = 0;
+    env->var_capacity = 8;
+    init_swiss_index(&env->index, MIN_INDEX_CAPACITY);
     return env;
 }
 
-void set_variable(RuntimeEnvironment* env, const char* name, int value) {
-    for (size_t i = 0; i < env->var_count; i++) {
-        if (strcmp(env->variables[i].name, name) == 0) {
-            env->variables[i].value = value; // Update existing variable
-            return;
+void free_runtime_environment(RuntimeEnvironment* env) {
+    free(env->variables);
+    free(env->index.control);
+    free(env->index.slots);
+    free(env);
+}
+
+// Drop every binding but keep the storage, so a frame can be reused
+void reset_runtime_environment(RuntimeEnvironment* env) {
+    env->var_count = 0;
+    memset(env->index.control, CONTROL_EMPTY, env->index.capacity + GROUP_WIDTH);
+}
+
+Variable* find_variable(RuntimeEnvironment* env, Symbol* symbol) {
+    int8_t tag = hash_tag(symbol->hash);
+    size_t mask = env->index.capacity - 1;
+    size_t position = (size_t)symbol->hash & mask;
+    for (size_t stride = GROUP_WIDTH;; stride += GROUP_WIDTH) {
+        const int8_t* group = env->index.control + position;
+        for (uint32_t match = group_match(group, tag); match; match &= match - 1) {
+            Variable* variable = &env->variables[env->index.slots[(position + __builtin_ctz(match)) & mask]];
+            if (variable->symbol == symbol) return variable;
         }
+        if (group_match(group, CONTROL_EMPTY)) return NULL;
+        position = (position + stride) & mask;
     }
+}
+
+void set_symbol_variable(RuntimeEnvironment* env, Symbol* symbol, BoxedValue value) {
+    Variable* variable = find_variable(env, symbol);
+    if (variable) {
+        variable->value = value; // Update existing variable
+        return;
+    }
+
     // Add new variable
-    if (env->var_count < MAX_VARIABLES) {
-        env->variables[env->var_count].name = strdup(name);
-        env->variables[env->var_count].value = value;
-        env->var_count++;
+    if (env->var_count == env->var_capacity) {
+        env->var_capacity *= 2;
+        env->variables = realloc(env->variables, sizeof(Variable) * env->var_capacity);
+        if (!env->variables) {
+            fprintf(stderr, "Out of memory adding variable '%s'\n", symbol->name);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if ((env->var_count + 1) * 8 > env->index.capacity * 7) {
+        free(env->index.control);
+        free(env->index.slots);
+        init_swiss_index(&env->index, env->index.capacity * 2);
+        for (size_t i = 0; i < env->var_count; i++) insert_index(&env->index, env->variables[i].symbol->hash, (uint32_t)i);
     }
+    env->variables[env->var_count].symbol = symbol;
+    env->variables[env->var_count].value = value;
+    insert_index(&env->index, symbol->hash, (uint32_t)env->var_count);
+    env->var_count++;
 }
 
-int get_variable(RuntimeEnvironment* env, const char* name) {
-    for (size_t i = 0; i < env->var_count; i++) {
-        if (strcmp(env->variables[i].name, name) == 0) {
-            return env->variables[i].value; // Return variable value
-        }
+BoxedValue get_symbol_variable(RuntimeEnvironment* env, Symbol* symbol) {
+    Variable* variable = find_variable(env, symbol);
+    if (!variable) {
+        fprintf(stderr, "Variable '%s' not found!\n", symbol->name);
+        exit(EXIT_FAILURE);
     }
-    fprintf(stderr, "Variable '%s' not found!\n", name);
-    exit(EXIT_FAILURE);
+    return variable->value; // Return variable value
+}
+
+void set_boxed_variable(RuntimeEnvironment* env, const char* name, BoxedValue value) {
+    set_symbol_variable(env, intern_name(name), value);
+}
+
+BoxedValue get_boxed_variable(RuntimeEnvironment* env, const char* name) {
+    // A name that was never interned can't be bound anywhere
+    Symbol* symbol = lookup_symbol(name);
+    Variable* variable = symbol ? find_variable(env, symbol) : NULL;
+    if (!variable) {
+        fprintf(stderr, "Variable '%s' not found!\n", name);
+        exit(EXIT_FAILURE);
+    }
+    return variable->value; // Return variable value
+}
+
+// The int interface used by the older interpreters
+void set_variable(RuntimeEnvironment* env, const char* name, int value) {
+    set_boxed_variable(env, name, box_int(value));
+}
+
+int get_variable(RuntimeEnvironment* env, const char* name) {
+    return as_int(get_boxed_variable(env, name));
 }
 
 void execute_node(RuntimeEnvironment* env, ASTNode* node) {
@@ -0,0 +1,354 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+// Runtime strings: small-string optimization, shared immutable nodes and
+// ropes for link/connect.
+//
+// A String is a 24-byte value. Up to STRING_INLINE_MAX bytes live inside it,
+// so short names and labels never allocate. Longer strings point to a
+// reference-counted StringNode. Strings are immutable, so copying one only
+// bumps the count. The length is always stored. A node's hash is computed
+// on first use and kept in the node, so every copy shares it; inline
+// strings are short enough to hash on demand.
+//
+// A node is either flat (the characters follow it) or a concatenation of
+// two nodes. Concatenating long strings makes a concatenation node in O(1)
+// instead of copying, so a link chain that appends n pieces costs O(n)
+// instead of O(n^2). The first time the characters are needed, the rope is
+// flattened into one buffer. That buffer is cached in the node, so it
+// happens once. Flattening and freeing walk the tree with an explicit
+// stack, so a million-piece chain doesn't overflow the C stack.
+//
+// Boxed strings (NaN Boxing.c) and Type Feedback's strings are Strings, and
+// their '+' goes through string_concat. The link builtin (Native
+// Builtins.c) joins its parts with string_link.
+//
+// Nodes may be shared between threads. Reference counts are atomic, and
+// the flat buffer is published with a compare-and-swap; a thread that
+// loses the race frees its copy. A flattened node keeps its children,
+// because another thread may still be reading them.
+#define STRING_INLINE_MAX 22
+#define STRING_SHARED 0xFF       // inline_length of a String that uses a node
+#define ROPE_FLAT_MAX 256        // Shorter results are copied, not linked
+
+typedef struct StringNode {
+    uint32_t refcount;           // Accessed atomically
+    uint32_t depth;              // 0 for a flat node
+    uint32_t hash;               // 0 until string_hash computes it; accessed atomically
+    size_t length;
+    struct StringNode* left;     // Concatenation only
+    struct StringNode* right;
+    char* flat;                  // Characters, NUL-terminated; NULL until a concatenation is flattened
+    char chars[];                // Flat nodes: the characters themselves
+} StringNode;
+
+typedef union {
+    struct {
+        char chars[STRING_INLINE_MAX + 1];   // Inline bytes plus NUL
+        uint8_t inline_length;               // STRING_SHARED when 'node' is used
+    };
+    StringNode* node;                        // Overlaps the first inline bytes
+} String;
+
+StringNode* new_flat_node(const char* chars, size_t length) {
+    StringNode* node = malloc(sizeof(StringNode) + length + 1);
+    if (!node) {
+        fprintf(stderr, "Out of memory allocating a %zu-byte string\n", length);
+        exit(EXIT_FAILURE);
+    }
+    node->refcount = 1;
+    node->depth = 0;
+    node->hash = 0;
+    node->length = length;
+    node->left = node->right = NULL;
+    node->flat = node->chars;
+    if (chars) memcpy(node->chars, chars, length);
+    node->chars[length] = '\0';
+    return node;
+}
+
+StringNode* retain_node(StringNode* node) {
+    __atomic_fetch_add(&node->refcount, 1, __ATOMIC_RELAXED);
+    return node;
+}
+
+// Frees every node whose count reaches zero, without recursion
+void release_node(StringNode* node) {
+    if (__atomic_sub_fetch(&node->refcount, 1, __ATOMIC_ACQ_REL) != 0) return;
+
+    size_t count = 0, capacity = 16;
+    StringNode** dead = malloc(sizeof(StringNode*) * capacity);
+    if (!dead) {
+        fprintf(stderr, "Out of memory releasing a string\n");
+        exit(EXIT_FAILURE);
+    }
+    dead[count++] = node;
+    while (count > 0) {
+        StringNode* current = dead[--count];
+        StringNode* children[2] = { current->left, current->right };
+        for (int i = 0; i < 2; i++) {
+            if (!children[i] || __atomic_sub_fetch(&children[i]->refcount, 1, __ATOMIC_ACQ_REL) != 0) continue;
+            if (count == capacity) {
+                capacity *= 2;
+                dead = realloc(dead, sizeof(StringNode*) * capacity);
+                if (!dead) {
+                    fprintf(stderr, "Out of memory releasing a string\n");
+                    exit(EXIT_FAILURE);
+                }
+            }
+            dead[count++] = children[i];
+        }
+        if (current->flat != current->chars) free(current->flat);
+        free(current);
+    }
+    free(dead);
+}
+
+int string_is_inline(const String* string) {
+    return string->inline_length != STRING_SHARED;
+}
+
+size_t string_length(const String* string) {
+    return string_is_inline(string) ? string->inline_length : string->node->length;
+}
+
+String string_from(const char* chars, size_t length) {
+    String string;
+    memset(&string, 0, sizeof(String));
+    if (length <= STRING_INLINE_MAX) {
+        memcpy(string.chars, chars, length);
+        string.inline_length = (uint8_t)length;
+    } else {
+        string.node = new_flat_node(chars, length);
+        string.inline_length = STRING_SHARED;
+    }
+    return string;
+}
+
+String string_from_cstr(const char* chars) {
+    return string_from(chars, strlen(chars));
+}
+
+// Another reference to the same characters; no bytes are copied
+String string_copy(const String* string) {
+    if (!string_is_inline(string)) retain_node(string->node);
+    return *string;
+}
+
+void string_release(String* string) {
+    if (!string_is_inline(string)) release_node(string->node);
+    memset(string, 0, sizeof(String));
+}
+
+// Copy a rope's leaves into 'out', last leaf first. Only left children
+// wait on the stack, so a left-leaning append chain needs almost none.
+void flatten_into(StringNode* root, char* out) {
+    size_t count = 0, capacity = (size_t)root->depth + 2;
+    StringNode** pending = malloc(sizeof(StringNode*) * capacity);
+    if (!pending) {
+        fprintf(stderr, "Out of memory flattening a string\n");
+        exit(EXIT_FAILURE);
+    }
+    size_t end = root->length;
+    pending[count++] = root;
+    while (count > 0) {
+        StringNode* node = pending[--count];
+        const char* flat = __atomic_load_n(&node->flat, __ATOMIC_ACQUIRE);
+        if (flat) {
+            end -= node->length;
+            memcpy(out + end, flat, node->length);
+            continue;
+        }
+        pending[count++] = node->left;
+        pending[count++] = node->right;  // Popped first: it fills the end
+    }
+    free(pending);
+}
+
+const char* node_chars(StringNode* node) {
+    char* flat = __atomic_load_n(&node->flat, __ATOMIC_ACQUIRE);
+    if (flat) return flat;
+
+    char* buffer = malloc(node->length + 1);
+    if (!buffer) {
+        fprintf(stderr, "Out of memory flattening a %zu-byte string\n", node->length);
+        exit(EXIT_FAILURE);
+    }
+    flatten_into(node, buffer);
+    buffer[node->length] = '\0';
+    char* expected = NULL;
+    if (!__atomic_compare_exchange_n(&node->flat, &expected, buffer, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        free(buffer); // Another thread flattened it first
+        return expected;
+    }
+    return buffer;
+}
+
+// NUL-terminated characters; flattens a rope the first time
+const char* string_chars(const String* string) {
+    return string_is_inline(string) ? string->chars : node_chars(string->node);
+}
+
+// FNV-1a over the bytes with a final mix, as hash_name does for names
+uint32_t hash_chars(const char* chars, size_t length) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)chars[i];
+        hash *= 1099511628211ULL;
+    }
+    hash ^= hash >> 32;
+    return (uint32_t)hash ? (uint32_t)hash : 1; // 0 means "not computed"
+}
+
+// Inline strings are hashed each time; a node caches its hash
+uint32_t string_hash(const String* string) {
+    if (string_is_inline(string)) return hash_chars(string->chars, string->inline_length);
+    StringNode* node = string->node;
+    uint32_t hash = __atomic_load_n(&node->hash, __ATOMIC_RELAXED);
+    if (hash) return hash;
+    hash = hash_chars(node_chars(node), node->length);
+    __atomic_store_n(&node->hash, hash, __ATOMIC_RELAXED); // Racing threads store the same value
+    return hash;
+}
+
+int string_equals(const String* a, const String* b) {
+    size_t length = string_length(a);
+    if (length != string_length(b)) return 0;
+    if (!string_is_inline(a) && !string_is_inline(b)) {
+        if (a->node == b->node) return 1;
+        uint32_t hash_a = __atomic_load_n(&a->node->hash, __ATOMIC_RELAXED);
+        uint32_t hash_b = __atomic_load_n(&b->node->hash, __ATOMIC_RELAXED);
+        if (hash_a && hash_b && hash_a != hash_b) return 0;
+    }
+    return memcmp(string_chars(a), string_chars(b), length) == 0;
+}
+
+int string_compare(const String* a, const String* b) {
+    size_t length_a = string_length(a), length_b = string_length(b);
+    int order = memcmp(string_chars(a), string_chars(b), length_a < length_b ? length_a : length_b);
+    if (order != 0) return order;
+    return length_a < length_b ? -1 : length_a > length_b;
+}
+
+// The string as a node, for use as a rope child. Inline strings get a
+// small flat node; shared strings are retained.
+StringNode* string_node(const String* string) {
+    if (string_is_inline(string)) return new_flat_node(string->chars, string->inline_length);
+    return retain_node(string->node);
+}
+
+String string_concat(const String* a, const String* b) {
+    size_t length_a = string_length(a), length_b = string_length(b);
+    if (length_b == 0) return string_copy(a);
+    if (length_a == 0) return string_copy(b);
+
+    size_t length = length_a + length_b;
+    String result;
+    memset(&result, 0, sizeof(String));
+    if (length <= STRING_INLINE_MAX) {
+        memcpy(result.chars, a->chars, length_a);
+        memcpy(result.chars + length_a, b->chars, length_b);
+        result.inline_length = (uint8_t)length;
+        return result;
+    }
+
+    StringNode* node;
+    if (length <= ROPE_FLAT_MAX) {
+        node = new_flat_node(NULL, length);
+        memcpy(node->chars, string_chars(a), length_a);
+        memcpy(node->chars + length_a, string_chars(b), length_b);
+    } else {
+        node = malloc(sizeof(StringNode));
+        if (!node) {
+            fprintf(stderr, "Out of memory concatenating strings\n");
+            exit(EXIT_FAILURE);
+        }
+        node->refcount = 1;
+        node->hash = 0;
+        node->length = length;
+        node->left = string_node(a);
+        node->right = string_node(b);
+        node->depth = (node->left->depth > node->right->depth ? node->left->depth : node->right->depth) + 1;
+        node->flat = NULL;
+    }
+    result.node = node;
+    result.inline_length = STRING_SHARED;
+    return result;
+}
+
+// link $target { connect: parts... }: join the parts as a balanced rope,
+// so the result's depth is logarithmic in the number of parts
+String string_link(const String* parts, size_t count) {
+    if (count == 0) return string_from("", 0);
+    if (count == 1) return string_copy(&parts[0]);
+    String left = string_link(parts, count / 2);
+    String right = string_link(parts + count / 2, count - count / 2);
+    String result = string_concat(&left, &right);
+    string_release(&left);
+    string_release(&right);
+    return result;
+}
+
+// One link step in a chain: *target becomes *target + part
+void string_append(String* target, const String* part) {
+    String result = string_concat(target, part);
+    string_release(target);
+    *target = result;
+}
+
+// Modify Value: strings are runtime Strings instead of bare char*
+typedef union {
+    int int_value;
+    float float_value;
+    String string_value;
+} Value;
+
+typedef struct {
+    DataType type;
+    Value value;
+} Data;
+
+// Modify print_data for String values
+void print_data(Data data) {
+    switch (data.type) {
+        case TYPE_INT:
+            printf("Integer: %d\n", data.value.int_value);
+            break;
+        case TYPE_FLOAT:
+            printf("Float: %.2f\n", data.value.float_value);
+            break;
+        case TYPE_STRING:
+            printf("String: %s\n", string_chars(&data.value.string_value));
+            break;
+        default:
+            printf("No value\n");
+    }
+}
+
+int main() {
+    Data greeting = { TYPE_STRING, .value.string_value = string_from_cstr("Hello, UNS-Language!") };
+    print_data(greeting); // 20 bytes: stored inline, nothing allocated
+    printf("inline: %d, sizeof(String): %zu\n", string_is_inline(&greeting.value.string_value), sizeof(String));
+
+    // A link chain of a million appends; each step is O(1)
+    String output = string_from("", 0);
+    String piece = string_from_cstr("node;");
+    for (int i = 0; i < 1000000; i++) string_append(&output, &piece);
+    String shared = string_copy(&output);
+    printf("length %zu, depth %u, hash %08x\n", string_length(&output), output.node->depth, string_hash(&output));
+    printf("starts with %.15s, equal to copy: %d\n", string_chars(&shared), string_equals(&output, &shared));
+
+    String parts[3] = { string_from_cstr("link "), string_from_cstr("$Result"), string_from_cstr(" { connect: $Sum }") };
+    String linked = string_link(parts, 3);
+    printf("%s\n", string_chars(&linked));
+
+    for (int i = 0; i < 3; i++) string_release(&parts[i]);
+    string_release(&linked);
+    string_release(&piece);
+    string_release(&shared);
+    string_release(&output);
+    string_release(&greeting.value.string_value);
+    return 0;
+}
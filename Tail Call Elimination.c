@@ -0,0 +1,367 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+// A call in tail position is rewritten to NODE_TAIL_CALL (numbered with the
+// other node types in Language Enforcer.c). It reuses the function_call
+// fields of the ASTNode union, so no other pass has to change.
+
+// Result of executing one statement inside a function body
+typedef enum {
+    FLOW_NORMAL,     // Fall through to the next statement
+    FLOW_RETURN,     // 'result' holds the return value
+    FLOW_TAIL_CALL   // 'tail_call' holds the call to run in the current frame
+} ControlFlow;
+
+ControlFlow execute_statement(RuntimeEnvironment* env, ASTNode* node, int* result, ASTNode** tail_call);
+
+// Mark `return f(...)` calls reachable from a function body. Returns nested in
+// if/while/blocks are still in tail position because nothing runs after them.
+void mark_tail_calls(ASTNode* node) {
+    if (!node) return;
+
+    switch (node->type) {
+        case NODE_RETURN:
+            if (node->return_node.value && node->return_node.value->type == NODE_FUNCTION_CALL) {
+                node->return_node.value->type = NODE_TAIL_CALL;
+            }
+            break;
+        case NODE_IF:
+            mark_tail_calls(node->if_node.then_branch);
+            mark_tail_calls(node->if_node.else_branch);
+            break;
+        case NODE_WHILE:
+            mark_tail_calls(node->while_node.body);
+            break;
+        case NODE_BLOCK:
+            for (size_t i = 0; i < node->block.size; i++) {
+                mark_tail_calls(node->block.statements[i]);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+// Run over the whole program after parsing (and after inlining)
+void mark_program_tail_calls(ASTNode* node) {
+    if (!node) return;
+
+    if (node->type == NODE_FUNCTION_DEF) {
+        mark_tail_calls(node->function_def.body);
+    } else if (node->type == NODE_BLOCK) {
+        for (size_t i = 0; i < node->block.size; i++) {
+            mark_program_tail_calls(node->block.statements[i]);
+        }
+    }
+}
+
+// free_runtime_environment and reset_runtime_environment: see Runtime Environment.c
+
+// Modify function execution so tail calls reuse the current frame instead of
+// recursing: arguments are evaluated in the old bindings, the frame is reset,
+// the new parameters are bound and the loop continues with the callee body.
+int execute_function(RuntimeEnvironment* env, Function* function, ASTNode** arguments, size_t arg_count) {
+    if (arg_count != function->arg_count) {
+        fprintf(stderr, "Function '%s' expected %zu arguments but got %zu\n", function->name, function->arg_count, arg_count);
+        exit(EXIT_FAILURE);
+    }
+
+    RuntimeEnvironment* local_env = create_runtime_environment();
+    for (size_t i = 0; i < arg_count; i++) {
+        set_variable(local_env, function->arguments[i], evaluate_expression(env, arguments[i]));
+    }
+
+    int values[MAX_VARIABLES];
+    for (;;) {
+        int result = 0;
+        ASTNode* tail_call = NULL;
+        ControlFlow flow = execute_statement(local_env, function->body, &result, &tail_call);
+        if (flow != FLOW_TAIL_CALL) {
+            free_runtime_environment(local_env);
+            return result;
+        }
+
+        Function* callee = resolve_call_site(tail_call);
+        if (!callee) {
+            fprintf(stderr, "Undefined function '%s'\n", tail_call->function_call.function_name);
+            exit(EXIT_FAILURE);
+        }
+        if (!callee->body) {
+            // Builtins have no frame to reuse
+            stdlib_print(local_env, tail_call->function_call.arguments, tail_call->function_call.arg_count);
+            free_runtime_environment(local_env);
+            return 0;
+        }
+        if (tail_call->function_call.arg_count != callee->arg_count) {
+            fprintf(stderr, "Function '%s' expected %zu arguments but got %zu\n", callee->name, callee->arg_count, tail_call->function_call.arg_count);
+            exit(EXIT_FAILURE);
+        }
+
+        // Evaluate every argument before any parameter is overwritten
+        for (size_t i = 0; i < callee->arg_count; i++) {
+            values[i] = evaluate_expression(local_env, tail_call->function_call.arguments[i]);
+        }
+        reset_runtime_environment(local_env);
+        for (size_t i = 0; i < callee->arg_count; i++) {
+            set_variable(local_env, callee->arguments[i], values[i]);
+        }
+        function = callee;
+    }
+}
+
+// Statement executor that propagates returns out of nested if/while/blocks
+ControlFlow execute_statement(RuntimeEnvironment* env, ASTNode* node, int* result, ASTNode** tail_call) {
+    if (!node) return FLOW_NORMAL;
+
+    switch (node->type) {
+        case NODE_RETURN:
+            if (node->return_node.value && node->return_node.value->type == NODE_TAIL_CALL) {
+                *tail_call = node->return_node.value;
+                return FLOW_TAIL_CALL;
+            }
+            *result = evaluate_expression(env, node->return_node.value);
+            return FLOW_RETURN;
+        case NODE_IF:
+            if (evaluate_expression(env, node->if_node.condition)) {
+                return execute_statement(env, node->if_node.then_branch, result, tail_call);
+            }
+            return execute_statement(env, node->if_node.else_branch, result, tail_call);
+        case NODE_WHILE:
+            while (evaluate_expression(env, node->while_node.condition)) {
+                ControlFlow flow = execute_statement(env, node->while_node.body, result, tail_call);
+                if (flow != FLOW_NORMAL) return flow;
+            }
+            return FLOW_NORMAL;
+        case NODE_BLOCK:
+            for (size_t i = 0; i < node->block.size; i++) {
+                ControlFlow flow = execute_statement(env, node->block.statements[i], result, tail_call);
+                if (flow != FLOW_NORMAL) return flow;
+            }
+            return FLOW_NORMAL;
+        case NODE_ASSIGNMENT:
+            set_variable(env, node->assignment.identifier, evaluate_expression(env, node->assignment.value));
+            return FLOW_NORMAL;
+        default:
+            execute_node(env, node);
+            return FLOW_NORMAL;
+    }
+}
+
+// Modify evaluate_expression so calls and comparisons work inside function bodies
+int evaluate_expression(RuntimeEnvironment* env, ASTNode* node) {
+    switch (node->type) {
+        case NODE_NUMBER:
+            return atoi(node->number_value);
+        case NODE_IDENTIFIER:
+            return get_variable(env, node->identifier);
+        case NODE_FUNCTION_CALL:
+        case NODE_TAIL_CALL: {
+            // A tail call reached outside a function body is an ordinary call
+            Function* function = resolve_call_site(node);
+            if (!function) {
+                fprintf(stderr, "Undefined function '%s'\n", node->function_call.function_name);
+                exit(EXIT_FAILURE);
+            }
+            if (!function->body) {
+                stdlib_print(env, node->function_call.arguments, node->function_call.arg_count);
+                return 0;
+            }
+            return execute_function(env, function, node->function_call.arguments, node->function_call.arg_count);
+        }
+        case NODE_BINARY_EXPR:
+            {
+                int left_value = evaluate_expression(env, node->binary.left);
+                int right_value = evaluate_expression(env, node->binary.right);
+                switch (node->binary.op) {
+                    case '+': return left_value + right_value;
+                    case '-': return left_value - right_value;
+                    case '*': return left_value * right_value;
+                    case '/': return left_value / right_value;
+                    case '<': return left_value < right_value;
+                    case '>': return left_value > right_value;
+                }
+            }
+            break;
+        // Handle more cases as necessary
+    }
+    return 0;
+}
+
+void generate_function_code(ASTNode* node);
+
+// Modify generate_code: after mark_tail_calls a tree holds returns and
+// NODE_TAIL_CALL nodes, which print as ordinary C statements and calls
+void generate_code(ASTNode* node) {
+    if (!node) return;
+
+    switch (node->type) {
+        case NODE_BINARY_EXPR:
+            printf("(");
+            generate_code(node->binary.left);
+            printf(" %c ", node->binary.op);
+            generate_code(node->binary.right);
+            printf(")");
+            break;
+        case NODE_NUMBER:
+            printf("%s", node->number_value);
+            break;
+        case NODE_IDENTIFIER:
+            printf("%s", node->identifier);
+            break;
+        case NODE_ASSIGNMENT:
+            printf("%s = ", node->assignment.identifier);
+            generate_code(node->assignment.value);
+            printf(";\n");
+            break;
+        case NODE_FUNCTION_CALL:
+        case NODE_TAIL_CALL:
+            printf("%s(", node->function_call.function_name);
+            for (size_t i = 0; i < node->function_call.arg_count; i++) {
+                if (i > 0) printf(", ");
+                generate_code(node->function_call.arguments[i]);
+            }
+            printf(")");
+            break;
+        case NODE_RETURN:
+            printf("return ");
+            generate_code(node->return_node.value);
+            printf(";\n");
+            break;
+        case NODE_IF:
+            printf("if (");
+            generate_code(node->if_node.condition);
+            printf(") ");
+            generate_code(node->if_node.then_branch);
+            if (node->if_node.else_branch) {
+                printf(" else ");
+                generate_code(node->if_node.else_branch);
+            }
+            break;
+        case NODE_WHILE:
+            printf("while (");
+            generate_code(node->while_node.condition);
+            printf(") ");
+            generate_code(node->while_node.body);
+            break;
+        case NODE_BLOCK:
+            printf("{\n");
+            for (size_t i = 0; i < node->block.size; i++) {
+                generate_code(node->block.statements[i]);
+                if (node->block.statements[i]->type == NODE_FUNCTION_CALL) printf(";\n");
+            }
+            printf("}\n");
+            break;
+        case NODE_FUNCTION_DEF:
+            generate_function_code(node);
+            break;
+        default:
+            fprintf(stderr, "Unknown node type!\n");
+            break;
+    }
+}
+
+// Code generation for function definitions. Self tail calls become parameter
+// reassignment plus a jump back to the function entry; other tail calls are
+// emitted as `return f(...)`, which the C compiler turns into a sibling jump.
+void generate_tail_code(ASTNode* node, ASTNode* function_def) {
+    if (!node) return;
+
+    switch (node->type) {
+        case NODE_RETURN: {
+            ASTNode* value = node->return_node.value;
+            if (value && value->type == NODE_TAIL_CALL &&
+                strcmp(value->function_call.function_name, function_def->function_def.function_name) == 0) {
+                // Temporaries keep every argument evaluated against the old parameters
+                printf("{\n");
+                for (size_t i = 0; i < value->function_call.arg_count; i++) {
+                    printf("int __tail%zu = ", i);
+                    generate_code(value->function_call.arguments[i]);
+                    printf(";\n");
+                }
+                for (size_t i = 0; i < value->function_call.arg_count; i++) {
+                    printf("%s = __tail%zu;\n", function_def->function_def.parameters[i], i);
+                }
+                printf("goto tail_entry;\n");
+                printf("}\n");
+            } else if (value && value->type == NODE_TAIL_CALL) {
+                printf("return %s(", value->function_call.function_name);
+                for (size_t i = 0; i < value->function_call.arg_count; i++) {
+                    if (i > 0) printf(", ");
+                    generate_code(value->function_call.arguments[i]);
+                }
+                printf(");\n");
+            } else {
+                generate_code(node);
+            }
+            break;
+        }
+        case NODE_IF:
+            printf("if (");
+            generate_code(node->if_node.condition);
+            printf(") {\n");
+            generate_tail_code(node->if_node.then_branch, function_def);
+            if (node->if_node.else_branch) {
+                printf("} else {\n");
+                generate_tail_code(node->if_node.else_branch, function_def);
+            }
+            printf("}\n");
+            break;
+        case NODE_WHILE:
+            printf("while (");
+            generate_code(node->while_node.condition);
+            printf(") {\n");
+            generate_tail_code(node->while_node.body, function_def);
+            printf("}\n");
+            break;
+        case NODE_BLOCK:
+            printf("{\n");
+            for (size_t i = 0; i < node->block.size; i++) {
+                generate_tail_code(node->block.statements[i], function_def);
+            }
+            printf("}\n");
+            break;
+        default:
+            generate_code(node);
+            if (node->type == NODE_FUNCTION_CALL) printf(";\n");
+            break;
+    }
+}
+
+void generate_function_code(ASTNode* node) {
+    printf("int %s(", node->function_def.function_name);
+    for (size_t i = 0; i < node->function_def.arg_count; i++) {
+        if (i > 0) printf(", ");
+        printf("int %s", node->function_def.parameters[i]);
+    }
+    printf(") {\n");
+    printf("tail_entry:\n");
+    generate_tail_code(node->function_def.body, node);
+    printf("return 0;\n");
+    printf("}\n");
+}
+
+int main() {
+    // Tail-recursive accumulator from the Recursive syntax examples
+    const char* source_code =
+        "function sum(n, acc) { if (n < 1) { return acc; } else { return sum(n - 1, acc + n); } }"
+        "print(sum(1000000, 0));";
+    Lexer* lexer = create_lexer(source_code);
+    Parser* parser = create_parser(lexer);
+
+    initialize_stdlib();
+
+    ASTNode* root = parse_block(parser);
+    mark_program_tail_calls(root);
+
+    printf("Generated Code:\n");
+    for (size_t i = 0; i < root->block.size; i++) {
+        if (root->block.statements[i]->type == NODE_FUNCTION_DEF) {
+            generate_function_code(root->block.statements[i]);
+        }
+    }
+
+    // Runs in a single frame regardless of n
+    execute_node(create_runtime_environment(), root);
+    return 0;
+}
@@ -0,0 +1,415 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TRITS_X86 1
+#endif
+
+// Trinary values and packed trit vectors.
+//
+// The old Trinary enum declared NEUTRAL = 0.5, which an enum truncates to 0,
+// so NEUTRAL was the same as FALSE. Trinary is now ordered
+// FALSE < NEUTRAL < TRUE. With that order, Kleene AND is min, OR is max
+// and NOT is the mirror image.
+//
+// A TritVector stores trits in two bit-planes: a 'true' plane and a 'false'
+// plane, 64 trits per word. Neutral trits have neither bit set. With this
+// encoding every operation works on whole words:
+//
+//   AND        T = aT & bT          F = aF | bF
+//   OR         T = aT | bT          F = aF & bF
+//   NOT        T = aF               F = aT
+//   consensus  T = aT & bT          F = aF & bF
+//   majority   T = maj(aT, bT, cT)  F = maj(aF, bF, cF)
+//
+// Planes are padded to whole AVX2 registers (4 words) and the bits past
+// 'length' are always zero, so the kernels never need a tail loop.
+// init_trit_kernels picks AVX2 versions when the CPU has them; the scalar
+// versions already handle 64 trits per instruction.
+#define TRIT_WORD_BITS 64
+#define TRIT_ALIGN_WORDS 4
+
+// Modify Trinary: ordered so that AND is min and OR is max
+typedef enum { FALSE = 0, NEUTRAL = 1, TRUE = 2 } Trinary;
+
+Trinary is_trinary(double value) {
+    if (value == 1) return TRUE;
+    else if (value == 0) return FALSE;
+    else return NEUTRAL;
+}
+
+double trinary_to_double(Trinary value) {
+    return value * 0.5;
+}
+
+Trinary trinary_and(Trinary a, Trinary b) { return a < b ? a : b; }
+Trinary trinary_or(Trinary a, Trinary b) { return a > b ? a : b; }
+Trinary trinary_not(Trinary a) { return (Trinary)(TRUE - a); }
+
+BoxedValue box_trinary(Trinary value) {
+    return value == TRUE ? BOXED_TRUE : value == FALSE ? BOXED_FALSE : BOXED_NEUTRAL;
+}
+
+Trinary as_trinary(BoxedValue value) {
+    if (value == BOXED_TRUE) return TRUE;
+    if (value == BOXED_FALSE) return FALSE;
+    if (is_number(value)) return is_trinary(as_double(value));
+    return NEUTRAL;
+}
+
+typedef struct {
+    size_t length;          // Trits
+    size_t word_count;      // Words per plane, a multiple of TRIT_ALIGN_WORDS
+    uint64_t* true_plane;
+    uint64_t* false_plane;
+} TritVector;
+
+// All trits start out NEUTRAL
+TritVector* trit_vector_new(size_t length) {
+    TritVector* vector = malloc(sizeof(TritVector));
+    size_t words = (length + TRIT_WORD_BITS - 1) / TRIT_WORD_BITS;
+    words = (words + TRIT_ALIGN_WORDS - 1) / TRIT_ALIGN_WORDS * TRIT_ALIGN_WORDS;
+    if (words == 0) words = TRIT_ALIGN_WORDS;
+    uint64_t* planes = vector ? aligned_alloc(32, sizeof(uint64_t) * words * 2) : NULL;
+    if (!planes) {
+        fprintf(stderr, "Out of memory allocating %zu trits\n", length);
+        exit(EXIT_FAILURE);
+    }
+    memset(planes, 0, sizeof(uint64_t) * words * 2);
+    vector->length = length;
+    vector->word_count = words;
+    vector->true_plane = planes;
+    vector->false_plane = planes + words;
+    return vector;
+}
+
+void trit_vector_free(TritVector* vector) {
+    if (!vector) return;
+    free(vector->true_plane); // Both planes share one allocation
+    free(vector);
+}
+
+void check_same_length(const TritVector* a, const TritVector* b) {
+    if (a->length != b->length) {
+        fprintf(stderr, "Trit vector length mismatch: %zu and %zu\n", a->length, b->length);
+        exit(EXIT_FAILURE);
+    }
+}
+
+Trinary trit_get(const TritVector* vector, size_t index) {
+    uint64_t bit = 1ull << (index % TRIT_WORD_BITS);
+    if (vector->true_plane[index / TRIT_WORD_BITS] & bit) return TRUE;
+    if (vector->false_plane[index / TRIT_WORD_BITS] & bit) return FALSE;
+    return NEUTRAL;
+}
+
+void trit_set(TritVector* vector, size_t index, Trinary value) {
+    if (index >= vector->length) {
+        fprintf(stderr, "Trit index %zu out of range (length %zu)\n", index, vector->length);
+        exit(EXIT_FAILURE);
+    }
+    size_t word = index / TRIT_WORD_BITS;
+    uint64_t bit = 1ull << (index % TRIT_WORD_BITS);
+    vector->true_plane[word] = (vector->true_plane[word] & ~bit) | (value == TRUE ? bit : 0);
+    vector->false_plane[word] = (vector->false_plane[word] & ~bit) | (value == FALSE ? bit : 0);
+}
+
+typedef void (*TritBinaryKernel)(const uint64_t* aT, const uint64_t* aF, const uint64_t* bT, const uint64_t* bF,
+                                 uint64_t* outT, uint64_t* outF, size_t words);
+typedef void (*TritTernaryKernel)(const uint64_t* const inT[3], const uint64_t* const inF[3],
+                                  uint64_t* outT, uint64_t* outF, size_t words);
+
+typedef struct {
+    const char* level;
+    TritBinaryKernel and;
+    TritBinaryKernel or;
+    TritBinaryKernel consensus;
+    TritTernaryKernel majority;
+    size_t (*popcount)(const uint64_t* words, size_t count);
+    size_t (*from_doubles)(const double* values, size_t count, uint64_t* outT, uint64_t* outF);
+} TritKernels;
+
+TritKernels trit_kernels;
+
+void scalar_trit_and(const uint64_t* aT, const uint64_t* aF, const uint64_t* bT, const uint64_t* bF,
+                     uint64_t* outT, uint64_t* outF, size_t words) {
+    for (size_t i = 0; i < words; i++) {
+        outT[i] = aT[i] & bT[i];
+        outF[i] = aF[i] | bF[i];
+    }
+}
+
+void scalar_trit_or(const uint64_t* aT, const uint64_t* aF, const uint64_t* bT, const uint64_t* bF,
+                    uint64_t* outT, uint64_t* outF, size_t words) {
+    for (size_t i = 0; i < words; i++) {
+        outT[i] = aT[i] | bT[i];
+        outF[i] = aF[i] & bF[i];
+    }
+}
+
+void scalar_trit_consensus(const uint64_t* aT, const uint64_t* aF, const uint64_t* bT, const uint64_t* bF,
+                           uint64_t* outT, uint64_t* outF, size_t words) {
+    for (size_t i = 0; i < words; i++) {
+        outT[i] = aT[i] & bT[i];
+        outF[i] = aF[i] & bF[i];
+    }
+}
+
+void scalar_trit_majority(const uint64_t* const inT[3], const uint64_t* const inF[3],
+                          uint64_t* outT, uint64_t* outF, size_t words) {
+    for (size_t i = 0; i < words; i++) {
+        uint64_t t0 = inT[0][i], t1 = inT[1][i], t2 = inT[2][i];
+        uint64_t f0 = inF[0][i], f1 = inF[1][i], f2 = inF[2][i];
+        outT[i] = (t0 & t1) | (t2 & (t0 | t1));
+        outF[i] = (f0 & f1) | (f2 & (f0 | f1));
+    }
+}
+
+size_t scalar_popcount(const uint64_t* words, size_t count) {
+    size_t total = 0;
+    for (size_t i = 0; i < count; i++) total += (size_t)__builtin_popcountll(words[i]);
+    return total;
+}
+
+// Classify doubles with is_trinary's rules into whole words; returns the
+// number of values consumed (a multiple of 64, the caller does the rest)
+size_t scalar_from_doubles(const double* values, size_t count, uint64_t* outT, uint64_t* outF) {
+    size_t i = 0;
+    for (; i + TRIT_WORD_BITS <= count; i += TRIT_WORD_BITS) {
+        uint64_t t = 0, f = 0;
+        for (size_t bit = 0; bit < TRIT_WORD_BITS; bit++) {
+            t |= (uint64_t)(values[i + bit] == 1) << bit;
+            f |= (uint64_t)(values[i + bit] == 0) << bit;
+        }
+        outT[i / TRIT_WORD_BITS] = t;
+        outF[i / TRIT_WORD_BITS] = f;
+    }
+    return i;
+}
+
+#ifdef TRITS_X86
+
+// Word counts are multiples of TRIT_ALIGN_WORDS and planes are 32-byte aligned
+
+__attribute__((target("avx2")))
+void avx2_trit_and(const uint64_t* aT, const uint64_t* aF, const uint64_t* bT, const uint64_t* bF,
+                   uint64_t* outT, uint64_t* outF, size_t words) {
+    for (size_t i = 0; i < words; i += TRIT_ALIGN_WORDS) {
+        __m256i t = _mm256_and_si256(_mm256_load_si256((const __m256i*)(aT + i)), _mm256_load_si256((const __m256i*)(bT + i)));
+        __m256i f = _mm256_or_si256(_mm256_load_si256((const __m256i*)(aF + i)), _mm256_load_si256((const __m256i*)(bF + i)));
+        _mm256_store_si256((__m256i*)(outT + i), t);
+        _mm256_store_si256((__m256i*)(outF + i), f);
+    }
+}
+
+__attribute__((target("avx2")))
+void avx2_trit_or(const uint64_t* aT, const uint64_t* aF, const uint64_t* bT, const uint64_t* bF,
+                  uint64_t* outT, uint64_t* outF, size_t words) {
+    for (size_t i = 0; i < words; i += TRIT_ALIGN_WORDS) {
+        __m256i t = _mm256_or_si256(_mm256_load_si256((const __m256i*)(aT + i)), _mm256_load_si256((const __m256i*)(bT + i)));
+        __m256i f = _mm256_and_si256(_mm256_load_si256((const __m256i*)(aF + i)), _mm256_load_si256((const __m256i*)(bF + i)));
+        _mm256_store_si256((__m256i*)(outT + i), t);
+        _mm256_store_si256((__m256i*)(outF + i), f);
+    }
+}
+
+__attribute__((target("avx2")))
+void avx2_trit_consensus(const uint64_t* aT, const uint64_t* aF, const uint64_t* bT, const uint64_t* bF,
+                         uint64_t* outT, uint64_t* outF, size_t words) {
+    for (size_t i = 0; i < words; i += TRIT_ALIGN_WORDS) {
+        __m256i t = _mm256_and_si256(_mm256_load_si256((const __m256i*)(aT + i)), _mm256_load_si256((const __m256i*)(bT + i)));
+        __m256i f = _mm256_and_si256(_mm256_load_si256((const __m256i*)(aF + i)), _mm256_load_si256((const __m256i*)(bF + i)));
+        _mm256_store_si256((__m256i*)(outT + i), t);
+        _mm256_store_si256((__m256i*)(outF + i), f);
+    }
+}
+
+__attribute__((target("avx2")))
+__m256i avx2_majority_bits(__m256i x, __m256i y, __m256i z) {
+    return _mm256_or_si256(_mm256_and_si256(x, y), _mm256_and_si256(z, _mm256_or_si256(x, y)));
+}
+
+__attribute__((target("avx2")))
+void avx2_trit_majority(const uint64_t* const inT[3], const uint64_t* const inF[3],
+                        uint64_t* outT, uint64_t* outF, size_t words) {
+    for (size_t i = 0; i < words; i += TRIT_ALIGN_WORDS) {
+        __m256i t = avx2_majority_bits(_mm256_load_si256((const __m256i*)(inT[0] + i)),
+                                       _mm256_load_si256((const __m256i*)(inT[1] + i)),
+                                       _mm256_load_si256((const __m256i*)(inT[2] + i)));
+        __m256i f = avx2_majority_bits(_mm256_load_si256((const __m256i*)(inF[0] + i)),
+                                       _mm256_load_si256((const __m256i*)(inF[1] + i)),
+                                       _mm256_load_si256((const __m256i*)(inF[2] + i)));
+        _mm256_store_si256((__m256i*)(outT + i), t);
+        _mm256_store_si256((__m256i*)(outF + i), f);
+    }
+}
+
+// Hardware popcount, four independent accumulators to hide its latency
+__attribute__((target("popcnt")))
+size_t popcnt_popcount(const uint64_t* words, size_t count) {
+    uint64_t c0 = 0, c1 = 0, c2 = 0, c3 = 0;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        c0 += (uint64_t)__builtin_popcountll(words[i]);
+        c1 += (uint64_t)__builtin_popcountll(words[i + 1]);
+        c2 += (uint64_t)__builtin_popcountll(words[i + 2]);
+        c3 += (uint64_t)__builtin_popcountll(words[i + 3]);
+    }
+    for (; i < count; i++) c0 += (uint64_t)__builtin_popcountll(words[i]);
+    return (size_t)(c0 + c1 + c2 + c3);
+}
+
+// Four doubles per compare; movemask turns each compare into 4 plane bits
+__attribute__((target("avx2")))
+size_t avx2_from_doubles(const double* values, size_t count, uint64_t* outT, uint64_t* outF) {
+    const __m256d one = _mm256_set1_pd(1.0), zero = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + TRIT_WORD_BITS <= count; i += TRIT_WORD_BITS) {
+        uint64_t t = 0, f = 0;
+        for (size_t bit = 0; bit < TRIT_WORD_BITS; bit += 4) {
+            __m256d x = _mm256_loadu_pd(values + i + bit);
+            t |= (uint64_t)_mm256_movemask_pd(_mm256_cmp_pd(x, one, _CMP_EQ_OQ)) << bit;
+            f |= (uint64_t)_mm256_movemask_pd(_mm256_cmp_pd(x, zero, _CMP_EQ_OQ)) << bit;
+        }
+        outT[i / TRIT_WORD_BITS] = t;
+        outF[i / TRIT_WORD_BITS] = f;
+    }
+    return i;
+}
+
+#endif
+
+void init_trit_kernels() {
+    trit_kernels = (TritKernels){
+        "scalar", scalar_trit_and, scalar_trit_or, scalar_trit_consensus, scalar_trit_majority,
+        scalar_popcount, scalar_from_doubles
+    };
+#ifdef TRITS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("popcnt")) trit_kernels.popcount = popcnt_popcount;
+    if (__builtin_cpu_supports("avx2")) {
+        trit_kernels.level = "avx2";
+        trit_kernels.and = avx2_trit_and;
+        trit_kernels.or = avx2_trit_or;
+        trit_kernels.consensus = avx2_trit_consensus;
+        trit_kernels.majority = avx2_trit_majority;
+        trit_kernels.from_doubles = avx2_from_doubles;
+    }
+#endif
+}
+
+TritKernels* get_trit_kernels() {
+    if (!trit_kernels.level) init_trit_kernels();
+    return &trit_kernels;
+}
+
+TritVector* trit_vector_binary(const TritVector* a, const TritVector* b, TritBinaryKernel kernel) {
+    check_same_length(a, b);
+    TritVector* result = trit_vector_new(a->length);
+    kernel(a->true_plane, a->false_plane, b->true_plane, b->false_plane,
+           result->true_plane, result->false_plane, a->word_count);
+    return result;
+}
+
+TritVector* trit_vector_and(const TritVector* a, const TritVector* b) {
+    return trit_vector_binary(a, b, get_trit_kernels()->and);
+}
+
+TritVector* trit_vector_or(const TritVector* a, const TritVector* b) {
+    return trit_vector_binary(a, b, get_trit_kernels()->or);
+}
+
+// TRUE or FALSE where both agree, NEUTRAL where they don't
+TritVector* trit_vector_consensus(const TritVector* a, const TritVector* b) {
+    return trit_vector_binary(a, b, get_trit_kernels()->consensus);
+}
+
+// Swapping the planes is the whole operation
+TritVector* trit_vector_not(const TritVector* a) {
+    TritVector* result = trit_vector_new(a->length);
+    memcpy(result->true_plane, a->false_plane, sizeof(uint64_t) * a->word_count);
+    memcpy(result->false_plane, a->true_plane, sizeof(uint64_t) * a->word_count);
+    return result;
+}
+
+// TRUE where at least two inputs are TRUE, FALSE where at least two are
+// FALSE, NEUTRAL otherwise
+TritVector* trit_vector_majority(const TritVector* a, const TritVector* b, const TritVector* c) {
+    check_same_length(a, b);
+    check_same_length(a, c);
+    TritVector* result = trit_vector_new(a->length);
+    const uint64_t* const inT[3] = { a->true_plane, b->true_plane, c->true_plane };
+    const uint64_t* const inF[3] = { a->false_plane, b->false_plane, c->false_plane };
+    get_trit_kernels()->majority(inT, inF, result->true_plane, result->false_plane, a->word_count);
+    return result;
+}
+
+size_t trit_vector_count(const TritVector* vector, Trinary value) {
+    TritKernels* kernels = get_trit_kernels();
+    size_t trues = kernels->popcount(vector->true_plane, vector->word_count);
+    if (value == TRUE) return trues;
+    size_t falses = kernels->popcount(vector->false_plane, vector->word_count);
+    if (value == FALSE) return falses;
+    return vector->length - trues - falses;
+}
+
+// The :IS NEUTRAL: check over a whole state array: index of the first
+// NEUTRAL trit, or -1 if every trit is decided
+long trit_vector_find_neutral(const TritVector* vector) {
+    for (size_t word = 0; word * TRIT_WORD_BITS < vector->length; word++) {
+        uint64_t neutral = ~(vector->true_plane[word] | vector->false_plane[word]);
+        size_t valid = vector->length - word * TRIT_WORD_BITS;
+        if (valid < TRIT_WORD_BITS) neutral &= (1ull << valid) - 1;
+        if (neutral) return (long)(word * TRIT_WORD_BITS + (size_t)__builtin_ctzll(neutral));
+    }
+    return -1;
+}
+
+// Pack a state array of doubles (1 TRUE, 0 FALSE, anything else NEUTRAL)
+TritVector* trit_vector_from_doubles(const double* values, size_t count) {
+    TritVector* vector = trit_vector_new(count);
+    size_t done = get_trit_kernels()->from_doubles(values, count, vector->true_plane, vector->false_plane);
+    for (size_t i = done; i < count; i++) trit_set(vector, i, is_trinary(values[i]));
+    return vector;
+}
+
+void print_trits(const TritVector* vector, size_t count) {
+    static const char symbols[] = { 'F', 'N', 'T' };
+    for (size_t i = 0; i < count && i < vector->length; i++) putchar(symbols[trit_get(vector, i)]);
+    putchar('\n');
+}
+
+int main() {
+    size_t n = 10000000;
+    double* states = malloc(sizeof(double) * n);
+    for (size_t i = 0; i < n; i++) states[i] = (i % 3) * 0.5; // FALSE, NEUTRAL, TRUE, ...
+    states[n - 1] = 7;                                        // Not a trinary value; reads as NEUTRAL
+
+    TritVector* a = trit_vector_from_doubles(states, n);
+    TritVector* b = trit_vector_not(a);
+    TritVector* both = trit_vector_and(a, b);
+    TritVector* either = trit_vector_or(a, b);
+    TritVector* agreed = trit_vector_consensus(a, either);
+    TritVector* vote = trit_vector_majority(a, b, either);
+
+    printf("Kernels: %s\n", get_trit_kernels()->level);
+    printf("a      "); print_trits(a, 9);
+    printf("not a  "); print_trits(b, 9);
+    printf("and    "); print_trits(both, 9);
+    printf("or     "); print_trits(either, 9);
+    printf("agreed "); print_trits(agreed, 9);
+    printf("vote   "); print_trits(vote, 9);
+    printf("neutral trits: %zu, first at %ld\n", trit_vector_count(a, NEUTRAL), trit_vector_find_neutral(a));
+    printf("true trits after OR: %zu\n", trit_vector_count(either, TRUE));
+
+    trit_vector_free(a);
+    trit_vector_free(b);
+    trit_vector_free(both);
+    trit_vector_free(either);
+    trit_vector_free(agreed);
+    trit_vector_free(vote);
+    free(states);
+    return 0;
+}
@@ -0,0 +1,517 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+// Type feedback and speculative specialization for dynamically typed code.
+//
+// Functions are lowered once into a slot-resolved tree (TypedNode) that is
+// evaluated over Data values. Every arithmetic and comparison node is a
+// feedback site: while generic, it records the operand type pairs it sees.
+// Once a function is hot, each monomorphic site is rewritten in place into
+// a specialized form (int+int, float*float, string+string, ...). That form
+// checks its operand tags and runs the fast path with no dispatch. Because
+// the rewrite is in place, a hot loop picks up the specialized code on its
+// next iteration.
+//
+// A failed guard deoptimizes. The failing operation finishes on the generic
+// path with the values it already has, so nothing is evaluated twice. Every
+// site in the function then goes back to generic and resumes profiling,
+// and the function is re-specialized later with the widened feedback.
+// After TYPED_MAX_DEOPTS deoptimizations the function stays generic.
+//
+// String values are runtime Strings (see Runtime Strings.c), so '+' on
+// strings builds a rope instead of copying both sides, and a loop that
+// keeps appending to one variable stays linear.
+#define TYPED_HOT_THRESHOLD 1000      // Calls plus loop iterations
+#define TYPED_MAX_DEOPTS 4
+#define TYPED_MAX_FUNCTIONS 256
+
+typedef enum {
+    FEEDBACK_INT_INT = 1,
+    FEEDBACK_FLOAT_FLOAT = 2,
+    FEEDBACK_STRING_STRING = 4,
+    FEEDBACK_OTHER = 8
+} TypeFeedback;
+
+typedef enum {
+    SPEC_GENERIC,
+    SPEC_INT,           // Both operands TYPE_INT
+    SPEC_FLOAT,         // Both operands TYPE_FLOAT
+    SPEC_STRING         // Both operands TYPE_STRING ('+' only)
+} Specialization;
+
+typedef enum {
+    TYPED_CONST, TYPED_LOAD, TYPED_STORE, TYPED_BINARY, TYPED_IF, TYPED_WHILE,
+    TYPED_RETURN, TYPED_BLOCK, TYPED_CALL, TYPED_PRINT
+} TypedKind;
+
+typedef struct TypedNode {
+    TypedKind kind;
+    char op;
+    uint8_t specialization;
+    uint8_t feedback;           // TypeFeedback bits seen while generic
+    uint16_t slot;
+    int function;               // Callee index for TYPED_CALL
+    Data constant;
+    struct TypedNode* a;
+    struct TypedNode* b;
+    struct TypedNode* c;
+    struct TypedNode** items;   // Block statements or call arguments
+    size_t count;
+} TypedNode;
+
+typedef struct {
+    char* name;
+    size_t arg_count;
+    char** slot_names;
+    size_t slot_count;
+    ASTNode* def;
+    TypedNode* body;            // Lowered on first call
+    TypedNode** sites;          // Every TYPED_BINARY node, for re-specialization and deopt
+    size_t site_count;
+    size_t site_capacity;
+    uint32_t hotness;
+    int specialized;
+    int deopt_count;
+} TypedFunction;
+
+typedef struct {
+    TypedFunction functions[TYPED_MAX_FUNCTIONS];
+    size_t count;
+} TypedProgram;
+
+TypedProgram typed_program = { .count = 0 };
+
+void typed_error(const char* message, const char* detail) {
+    fprintf(stderr, "Runtime error: %s%s%s\n", message, detail ? " " : "", detail ? detail : "");
+    exit(EXIT_FAILURE);
+}
+
+int find_typed_function(const char* name) {
+    for (size_t i = 0; i < typed_program.count; i++) {
+        if (strcmp(typed_program.functions[i].name, name) == 0) return (int)i;
+    }
+    return -1;
+}
+
+void collect_typed_functions(ASTNode* node) {
+    if (!node) return;
+    if (node->type == NODE_FUNCTION_DEF) {
+        if (find_typed_function(node->function_def.function_name) >= 0) typed_error("function defined twice:", node->function_def.function_name);
+        if (typed_program.count >= TYPED_MAX_FUNCTIONS) typed_error("too many functions", NULL);
+        TypedFunction* function = &typed_program.functions[typed_program.count++];
+        memset(function, 0, sizeof(TypedFunction));
+        function->name = node->function_def.function_name;
+        function->arg_count = node->function_def.arg_count;
+        function->def = node;
+        collect_typed_functions(node->function_def.body);
+    } else if (node->type == NODE_BLOCK) {
+        for (size_t i = 0; i < node->block.size; i++) collect_typed_functions(node->block.statements[i]);
+    } else if (node->type == NODE_IF) {
+        collect_typed_functions(node->if_node.then_branch);
+        collect_typed_functions(node->if_node.else_branch);
+    } else if (node->type == NODE_WHILE) {
+        collect_typed_functions(node->while_node.body);
+    }
+}
+
+uint16_t typed_slot(TypedFunction* function, const char* name) {
+    for (size_t i = 0; i < function->slot_count; i++) {
+        if (strcmp(function->slot_names[i], name) == 0) return (uint16_t)i;
+    }
+    if (function->slot_count >= UINT16_MAX) typed_error("too many locals in", function->name);
+    function->slot_names = realloc(function->slot_names, sizeof(char*) * (function->slot_count + 1));
+    function->slot_names[function->slot_count] = (char*)name;
+    return (uint16_t)function->slot_count++;
+}
+
+TypedNode* new_typed_node(TypedKind kind) {
+    TypedNode* node = (TypedNode*)calloc(1, sizeof(TypedNode));
+    if (!node) typed_error("out of memory lowering", NULL);
+    node->kind = kind;
+    return node;
+}
+
+Data parse_number_literal(const char* text) {
+    Data data;
+    if (strchr(text, '.')) {
+        data.type = TYPE_FLOAT;
+        data.value.float_value = strtof(text, NULL);
+    } else {
+        data.type = TYPE_INT;
+        data.value.int_value = atoi(text);
+    }
+    return data;
+}
+
+TypedNode* lower_typed(TypedFunction* function, ASTNode* node) {
+    if (!node) return NULL;
+
+    TypedNode* typed;
+    switch (node->type) {
+        case NODE_NUMBER:
+            typed = new_typed_node(TYPED_CONST);
+            typed->constant = parse_number_literal(node->number_value);
+            return typed;
+        case NODE_STRING:
+            typed = new_typed_node(TYPED_CONST);
+            typed->constant.type = TYPE_STRING;
+            typed->constant.value.string_value = string_from_cstr(node->string_value);
+            return typed;
+        case NODE_IDENTIFIER:
+            typed = new_typed_node(TYPED_LOAD);
+            typed->slot = typed_slot(function, node->identifier);
+            return typed;
+        case NODE_ASSIGNMENT:
+            typed = new_typed_node(TYPED_STORE);
+            typed->slot = typed_slot(function, node->assignment.identifier);
+            typed->a = lower_typed(function, node->assignment.value);
+            return typed;
+        case NODE_BINARY_EXPR:
+            typed = new_typed_node(TYPED_BINARY);
+            typed->op = node->binary.op;
+            typed->a = lower_typed(function, node->binary.left);
+            typed->b = lower_typed(function, node->binary.right);
+            if (function->site_count == function->site_capacity) {
+                function->site_capacity = function->site_capacity ? function->site_capacity * 2 : 16;
+                function->sites = realloc(function->sites, sizeof(TypedNode*) * function->site_capacity);
+            }
+            function->sites[function->site_count++] = typed;
+            return typed;
+        case NODE_IF:
+            typed = new_typed_node(TYPED_IF);
+            typed->a = lower_typed(function, node->if_node.condition);
+            typed->b = lower_typed(function, node->if_node.then_branch);
+            typed->c = lower_typed(function, node->if_node.else_branch);
+            return typed;
+        case NODE_WHILE:
+            typed = new_typed_node(TYPED_WHILE);
+            typed->a = lower_typed(function, node->while_node.condition);
+            typed->b = lower_typed(function, node->while_node.body);
+            return typed;
+        case NODE_RETURN:
+            typed = new_typed_node(TYPED_RETURN);
+            typed->a = lower_typed(function, node->return_node.value);
+            return typed;
+        case NODE_BLOCK:
+            typed = new_typed_node(TYPED_BLOCK);
+            typed->count = node->block.size;
+            typed->items = calloc(node->block.size ? node->block.size : 1, sizeof(TypedNode*));
+            for (size_t i = 0; i < node->block.size; i++) typed->items[i] = lower_typed(function, node->block.statements[i]);
+            return typed;
+        case NODE_FUNCTION_CALL: {
+            const char* name = node->function_call.function_name;
+            typed = new_typed_node(strcmp(name, "print") == 0 ? TYPED_PRINT : TYPED_CALL);
+            if (typed->kind == TYPED_CALL) {
+                typed->function = find_typed_function(name);
+                if (typed->function < 0) typed_error("undefined function", name);
+                if (typed_program.functions[typed->function].arg_count != node->function_call.arg_count) typed_error("wrong number of arguments to", name);
+            }
+            typed->count = node->function_call.arg_count;
+            typed->items = calloc(typed->count ? typed->count : 1, sizeof(TypedNode*));
+            for (size_t i = 0; i < typed->count; i++) typed->items[i] = lower_typed(function, node->function_call.arguments[i]);
+            return typed;
+        }
+        case NODE_FUNCTION_DEF:
+            return NULL; // Definitions are static; collected up front
+        default:
+            typed_error("unsupported node in typed interpreter", NULL);
+            return NULL;
+    }
+}
+
+uint8_t classify_operands(Data left, Data right) {
+    if (left.type == TYPE_INT && right.type == TYPE_INT) return FEEDBACK_INT_INT;
+    if (left.type == TYPE_FLOAT && right.type == TYPE_FLOAT) return FEEDBACK_FLOAT_FLOAT;
+    if (left.type == TYPE_STRING && right.type == TYPE_STRING) return FEEDBACK_STRING_STRING;
+    return FEEDBACK_OTHER;
+}
+
+float as_float(Data data) {
+    if (data.type == TYPE_INT) return (float)data.value.int_value;
+    if (data.type == TYPE_FLOAT) return data.value.float_value;
+    typed_error("expected a number", NULL);
+    return 0;
+}
+
+Data make_int(int value) {
+    Data data;
+    data.type = TYPE_INT;
+    data.value.int_value = value;
+    return data;
+}
+
+Data make_float(float value) {
+    Data data;
+    data.type = TYPE_FLOAT;
+    data.value.float_value = value;
+    return data;
+}
+
+Data concatenate_strings(const String* left, const String* right) {
+    Data data;
+    data.type = TYPE_STRING;
+    data.value.string_value = string_concat(left, right);
+    return data;
+}
+
+// The full dynamic semantics: ints stay ints, mixing with a float promotes
+Data generic_binary(char op, Data left, Data right) {
+    if (left.type == TYPE_STRING || right.type == TYPE_STRING) {
+        if (op == '+' && left.type == TYPE_STRING && right.type == TYPE_STRING) {
+            return concatenate_strings(&left.value.string_value, &right.value.string_value);
+        }
+        if ((op == '<' || op == '>') && left.type == TYPE_STRING && right.type == TYPE_STRING) {
+            int order = string_compare(&left.value.string_value, &right.value.string_value);
+            return make_int(op == '<' ? order < 0 : order > 0);
+        }
+        typed_error("invalid operands for", op == '+' ? "+" : op == '-' ? "-" : op == '*' ? "*" : op == '/' ? "/" : "comparison");
+    }
+    if (left.type == TYPE_INT && right.type == TYPE_INT) {
+        int x = left.value.int_value, y = right.value.int_value;
+        switch (op) {
+            case '+': return make_int((int)((unsigned)x + (unsigned)y));
+            case '-': return make_int((int)((unsigned)x - (unsigned)y));
+            case '*': return make_int((int)((unsigned)x * (unsigned)y));
+            case '/':
+                if (y == 0) typed_error("division by zero", NULL);
+                return make_int(y == -1 ? (int)(0u - (unsigned)x) : x / y); // INT_MIN / -1 wraps
+            case '<': return make_int(x < y);
+            case '>': return make_int(x > y);
+        }
+    } else {
+        float x = as_float(left), y = as_float(right);
+        switch (op) {
+            case '+': return make_float(x + y);
+            case '-': return make_float(x - y);
+            case '*': return make_float(x * y);
+            case '/': return make_float(x / y);
+            case '<': return make_int(x < y);
+            case '>': return make_int(x > y);
+        }
+    }
+    typed_error("unknown operator", NULL);
+    return make_int(0);
+}
+
+// Rewrite every monomorphic site to its specialized form
+void specialize_function(TypedFunction* function) {
+    for (size_t i = 0; i < function->site_count; i++) {
+        TypedNode* site = function->sites[i];
+        switch (site->feedback) {
+            case FEEDBACK_INT_INT: site->specialization = site->op == '/' ? SPEC_GENERIC : SPEC_INT; break;
+            case FEEDBACK_FLOAT_FLOAT: site->specialization = SPEC_FLOAT; break;
+            case FEEDBACK_STRING_STRING: site->specialization = site->op == '+' ? SPEC_STRING : SPEC_GENERIC; break;
+            default: site->specialization = SPEC_GENERIC; break; // Polymorphic or never reached
+        }
+    }
+    function->specialized = 1;
+}
+
+void deoptimize_function(TypedFunction* function) {
+    for (size_t i = 0; i < function->site_count; i++) function->sites[i]->specialization = SPEC_GENERIC;
+    function->specialized = 0;
+    function->hotness = 0;
+    function->deopt_count++;
+}
+
+void count_hotness(TypedFunction* function) {
+    if (!function->specialized && function->deopt_count < TYPED_MAX_DEOPTS && ++function->hotness >= TYPED_HOT_THRESHOLD) {
+        specialize_function(function);
+    }
+}
+
+typedef struct {
+    TypedFunction* function;
+    Data* slots;
+    int returned;
+    Data result;
+} TypedFrame;
+
+Data call_typed_function(int index, Data* args);
+
+Data evaluate_typed(TypedFrame* frame, TypedNode* node);
+
+Data evaluate_binary(TypedFrame* frame, TypedNode* node) {
+    Data left = evaluate_typed(frame, node->a);
+    Data right = evaluate_typed(frame, node->b);
+
+    switch (node->specialization) {
+        case SPEC_INT:
+            if (left.type == TYPE_INT && right.type == TYPE_INT) {
+                int x = left.value.int_value, y = right.value.int_value;
+                switch (node->op) {
+                    case '+': return make_int((int)((unsigned)x + (unsigned)y));
+                    case '-': return make_int((int)((unsigned)x - (unsigned)y));
+                    case '*': return make_int((int)((unsigned)x * (unsigned)y));
+                    case '<': return make_int(x < y);
+                    case '>': return make_int(x > y);
+                }
+            }
+            break;
+        case SPEC_FLOAT:
+            if (left.type == TYPE_FLOAT && right.type == TYPE_FLOAT) {
+                float x = left.value.float_value, y = right.value.float_value;
+                switch (node->op) {
+                    case '+': return make_float(x + y);
+                    case '-': return make_float(x - y);
+                    case '*': return make_float(x * y);
+                    case '/': return make_float(x / y);
+                    case '<': return make_int(x < y);
+                    case '>': return make_int(x > y);
+                }
+            }
+            break;
+        case SPEC_STRING:
+            if (left.type == TYPE_STRING && right.type == TYPE_STRING) {
+                return concatenate_strings(&left.value.string_value, &right.value.string_value);
+            }
+            break;
+        default:
+            node->feedback |= classify_operands(left, right);
+            return generic_binary(node->op, left, right);
+    }
+
+    // Guard failed: finish this operation generically, then drop the speculation
+    node->feedback |= classify_operands(left, right);
+    deoptimize_function(frame->function);
+    return generic_binary(node->op, left, right);
+}
+
+int is_truthy(Data data) {
+    switch (data.type) {
+        case TYPE_INT: return data.value.int_value != 0;
+        case TYPE_FLOAT: return data.value.float_value != 0;
+        case TYPE_STRING: return string_length(&data.value.string_value) != 0;
+        default: return 0;
+    }
+}
+
+void print_typed_value(Data data) {
+    switch (data.type) {
+        case TYPE_INT: printf("%d ", data.value.int_value); break;
+        case TYPE_FLOAT: printf("%g ", data.value.float_value); break;
+        case TYPE_STRING: printf("%s ", string_chars(&data.value.string_value)); break;
+        default: printf("none "); break;
+    }
+}
+
+Data evaluate_typed(TypedFrame* frame, TypedNode* node) {
+    Data none;
+    none.type = TYPE_NONE;
+    none.value.int_value = 0;
+    if (!node) return none;
+
+    switch (node->kind) {
+        case TYPED_CONST:
+            return node->constant;
+        case TYPED_LOAD:
+            if (frame->slots[node->slot].type == TYPE_NONE) typed_error("undefined variable", frame->function->slot_names[node->slot]);
+            return frame->slots[node->slot];
+        case TYPED_STORE:
+            frame->slots[node->slot] = evaluate_typed(frame, node->a);
+            return none;
+        case TYPED_BINARY:
+            return evaluate_binary(frame, node);
+        case TYPED_IF:
+            if (is_truthy(evaluate_typed(frame, node->a))) evaluate_typed(frame, node->b);
+            else evaluate_typed(frame, node->c);
+            return none;
+        case TYPED_WHILE:
+            while (!frame->returned && is_truthy(evaluate_typed(frame, node->a))) {
+                evaluate_typed(frame, node->b);
+                count_hotness(frame->function);
+            }
+            return none;
+        case TYPED_RETURN:
+            frame->result = node->a ? evaluate_typed(frame, node->a) : make_int(0);
+            frame->returned = 1;
+            return none;
+        case TYPED_BLOCK:
+            for (size_t i = 0; i < node->count && !frame->returned; i++) evaluate_typed(frame, node->items[i]);
+            return none;
+        case TYPED_CALL: {
+            Data stack_args[8];
+            Data* args = node->count <= 8 ? stack_args : malloc(sizeof(Data) * node->count);
+            for (size_t i = 0; i < node->count; i++) args[i] = evaluate_typed(frame, node->items[i]);
+            Data result = call_typed_function(node->function, args);
+            if (args != stack_args) free(args);
+            return result;
+        }
+        case TYPED_PRINT:
+            for (size_t i = 0; i < node->count; i++) print_typed_value(evaluate_typed(frame, node->items[i]));
+            printf("\n");
+            return make_int(0);
+    }
+    return none;
+}
+
+Data run_typed_body(TypedFunction* function, Data* args) {
+    Data* slots = calloc(function->slot_count ? function->slot_count : 1, sizeof(Data));
+    for (size_t i = 0; i < function->slot_count; i++) slots[i].type = TYPE_NONE;
+    for (size_t i = 0; i < function->arg_count; i++) slots[i] = args[i];
+
+    TypedFrame frame = { function, slots, 0, make_int(0) };
+    evaluate_typed(&frame, function->body);
+    free(slots);
+    return frame.result;
+}
+
+void lower_function(TypedFunction* function) {
+    for (size_t i = 0; i < function->arg_count; i++) typed_slot(function, function->def->function_def.parameters[i]);
+    function->body = lower_typed(function, function->def->function_def.body);
+}
+
+Data call_typed_function(int index, Data* args) {
+    TypedFunction* function = &typed_program.functions[index];
+    if (!function->body) lower_function(function);
+    count_hotness(function);
+    return run_typed_body(function, args);
+}
+
+void print_feedback_report() {
+    static const char* names[] = { "generic", "int", "float", "string" };
+    for (size_t f = 0; f < typed_program.count; f++) {
+        TypedFunction* function = &typed_program.functions[f];
+        printf("%s: %s, %d deopts\n", function->name, function->specialized ? "specialized" : "generic", function->deopt_count);
+        for (size_t i = 0; i < function->site_count; i++) {
+            printf("  site %zu '%c': %s\n", i, function->sites[i]->op, names[function->sites[i]->specialization]);
+        }
+    }
+}
+
+// Top-level statements run as an anonymous function so their loops get feedback too
+int typed_run_program(ASTNode* root) {
+    collect_typed_functions(root);
+    if (typed_program.count >= TYPED_MAX_FUNCTIONS) typed_error("too many functions", NULL);
+
+    TypedFunction* main_function = &typed_program.functions[typed_program.count++];
+    memset(main_function, 0, sizeof(TypedFunction));
+    main_function->name = "<main>";
+    main_function->body = lower_typed(main_function, root);
+    run_typed_body(main_function, NULL);
+    print_feedback_report();
+    return 0;
+}
+
+int main() {
+    const char* source_code =
+        "function scale(x, k) { return x * k; }"
+        "i = 0; total = 0;"
+        "while (i < 10000) { total = total + scale(i, 3); i = i + 1; }"
+        "print(total);";
+    Lexer* lexer = create_lexer(source_code);
+    Parser* parser = create_parser(lexer);
+
+    ASTNode* root = parse_block(parser);
+    typed_run_program(root);
+
+    // The lexer has no float literals, so feed 'scale' floats directly: its
+    // int-specialized '*' fails its guard and the function deoptimizes
+    Data args[2] = { make_float(1.5f), make_float(2.0f) };
+    print_typed_value(call_typed_function(find_typed_function("scale"), args));
+    printf("\n");
+    print_feedback_report();
+    return 0;
+}
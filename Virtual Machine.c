@@ -0,0 +1,418 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+// Bytecode virtual machine replacing the recursive execute_node walker.
+//
+// Code objects from the bytecode emitter are translated once into threaded
+// code: each instruction carries the address of its handler plus decoded
+// operands (constants inlined, jump targets as instruction indices, call
+// symbols resolved to function indices). With GCC/Clang each handler jumps
+// straight to the next one through a computed goto; other compilers fall back
+// to a switch over the same handlers.
+//
+// Values live on one contiguous operand stack. A call leaves its arguments on
+// the stack and they become the callee's first locals in place, so frames are
+// just windows into that stack, described by a preallocated frame array.
+// Every code object passes validate_code_object before it is threaded, so
+// no instruction can pop an empty stack, and each call checks that the
+// callee's locals plus its max_stack fit before entering it.
+//
+// Integer arithmetic wraps modulo 2^32, including INT32_MIN / -1, so every
+// tier computes the same result for the same program.
+#define VM_STACK_SIZE (1024 * 1024)   // Operand stack slots (locals included)
+#define VM_MAX_FRAMES 65536
+
+#if defined(__GNUC__) || defined(__clang__)
+#define VM_THREADED 1
+#endif
+
+typedef struct {
+    const void* handler;    // Label address (threaded) or opcode (switch)
+    int32_t a;              // Constant value, slot, jump target or function index
+    int32_t b;              // Argument count for calls
+} ThreadedInstruction;
+
+typedef struct {
+    const char* name;
+    ThreadedInstruction* code;
+    size_t length;
+    uint16_t arg_count;
+    uint16_t local_count;
+    uint32_t max_stack;     // Operand stack needed above the locals
+} ThreadedFunction;
+
+typedef struct {
+    ThreadedFunction* function;
+    ThreadedInstruction* return_ip;   // NULL for the frame entered from C
+    int32_t* locals;                  // Start of this frame's window on the stack
+} VMFrame;
+
+// Supplies code objects to a VM that threads each function on its first
+// call instead of up front (see Mapped Bytecode.c)
+typedef struct {
+    void* source;
+    CodeObject* (*load_function)(void* source, size_t index);
+    int32_t (*resolve_call)(void* source, uint16_t symbol);    // Function index, or -1
+    const char* (*symbol_name)(void* source, uint16_t symbol);
+} VMLoader;
+
+typedef struct {
+    CodeModule* module;
+    ThreadedFunction* functions;
+    size_t function_count;
+    int32_t* stack;
+    int32_t* stack_end;
+    VMFrame* frames;
+    size_t frame_count;
+    const void** labels;
+    VMLoader* loader;       // NULL when every function was threaded by create_vm
+} VM;
+
+int32_t vm_execute(VM* vm, size_t function_index, const int32_t* args, size_t arg_count, const void*** label_table);
+
+void vm_error(const char* message, const char* detail) {
+    fprintf(stderr, "Runtime error: %s%s%s\n", message, detail ? " " : "", detail ? detail : "");
+    exit(EXIT_FAILURE);
+}
+
+// Instruction index of every byte offset that starts an instruction
+int32_t* map_instruction_offsets(CodeObject* code, size_t* count) {
+    int32_t* index = malloc(sizeof(int32_t) * (code->code.size + 1));
+    size_t n = 0;
+    for (size_t pc = 0; pc < code->code.size; pc += opcode_sizes[code->code.data[pc]]) {
+        index[pc] = (int32_t)n++;
+    }
+    index[code->code.size] = (int32_t)n;
+    *count = n;
+    return index;
+}
+
+const char* vm_symbol_name(VM* vm, uint16_t symbol) {
+    return vm->loader ? vm->loader->symbol_name(vm->loader->source, symbol) : vm->module->symbols[symbol];
+}
+
+// Translate one code object into threaded instructions
+void thread_function(VM* vm, size_t f, const void** labels) {
+    CodeObject* code = vm->loader ? vm->loader->load_function(vm->loader->source, f) : &vm->module->functions[f];
+    if (!validate_code_object(vm->module, code)) vm_error("invalid bytecode in", code->name);
+    ThreadedFunction* threaded = &vm->functions[f];
+    size_t count;
+    int32_t* index = map_instruction_offsets(code, &count);
+
+    threaded->name = code->name;
+    threaded->arg_count = code->arg_count;
+    threaded->local_count = code->local_count;
+    threaded->max_stack = code->max_stack;
+    threaded->length = count;
+    threaded->code = malloc(sizeof(ThreadedInstruction) * (count + 1));
+
+    size_t i = 0;
+    for (size_t pc = 0; pc < code->code.size; pc += opcode_sizes[code->code.data[pc]], i++) {
+        const uint8_t* ip = code->code.data + pc;
+        OpCode op = (OpCode)ip[0];
+        ThreadedInstruction* instruction = &threaded->code[i];
+#ifdef VM_THREADED
+        instruction->handler = labels[op];
+#else
+        (void)labels;
+        instruction->handler = (const void*)(intptr_t)op;
+#endif
+        instruction->a = 0;
+        instruction->b = 0;
+
+        switch (op) {
+            case OP_PUSH_CONST:
+                instruction->a = vm->module->constants[read_u16(ip + 1)];
+                break;
+            case OP_LOAD:
+            case OP_STORE:
+                instruction->a = read_u16(ip + 1);
+                break;
+            case OP_JUMP:
+            case OP_JUMP_IF_FALSE:
+                instruction->a = index[read_u32(ip + 1)];
+                break;
+            case OP_CALL:
+            case OP_TAIL_CALL: {
+                uint16_t symbol = read_u16(ip + 1);
+                instruction->a = vm->loader ? vm->loader->resolve_call(vm->loader->source, symbol)
+                                            : find_code_object(vm->module, vm->module->symbols[symbol]);
+                instruction->b = ip[3];
+                if (instruction->a < 0) {
+                    // Reported when executed, matching the interpreter's behaviour
+                    instruction->b = read_u16(ip + 1);
+                }
+                break;
+            }
+            case OP_PRINT:
+                instruction->a = ip[1];
+                break;
+            default:
+                break;
+        }
+    }
+    free(index);
+}
+
+VM* create_vm(CodeModule* module) {
+    VM* vm = (VM*)calloc(1, sizeof(VM));
+    vm->module = module;
+    vm->function_count = module->function_count;
+    vm->functions = calloc(module->function_count ? module->function_count : 1, sizeof(ThreadedFunction));
+    vm->stack = malloc(sizeof(int32_t) * VM_STACK_SIZE);
+    vm->stack_end = vm->stack + VM_STACK_SIZE;
+    vm->frames = malloc(sizeof(VMFrame) * VM_MAX_FRAMES);
+    if (!vm->stack || !vm->frames) vm_error("out of memory creating VM", NULL);
+
+    vm_execute(vm, 0, NULL, 0, &vm->labels); // Fetch handler addresses only
+    for (size_t f = 0; f < module->function_count; f++) {
+        thread_function(vm, f, vm->labels);
+    }
+    return vm;
+}
+
+// A VM whose functions are loaded and threaded on first call. 'module' only
+// needs its constant pool.
+VM* create_lazy_vm(CodeModule* module, size_t function_count, VMLoader* loader) {
+    VM* vm = (VM*)calloc(1, sizeof(VM));
+    vm->module = module;
+    vm->loader = loader;
+    vm->function_count = function_count;
+    vm->functions = calloc(function_count ? function_count : 1, sizeof(ThreadedFunction));
+    vm->stack = malloc(sizeof(int32_t) * VM_STACK_SIZE);
+    vm->stack_end = vm->stack + VM_STACK_SIZE;
+    vm->frames = malloc(sizeof(VMFrame) * VM_MAX_FRAMES);
+    if (!vm->stack || !vm->frames) vm_error("out of memory creating VM", NULL);
+
+    vm_execute(vm, 0, NULL, 0, &vm->labels);
+    return vm;
+}
+
+void free_vm(VM* vm) {
+    for (size_t f = 0; f < vm->function_count; f++) free(vm->functions[f].code);
+    free(vm->functions);
+    free(vm->stack);
+    free(vm->frames);
+    free(vm);
+}
+
+#ifdef VM_THREADED
+#define VM_CASE(op) L_##op:
+#define VM_DISPATCH() goto *ip->handler
+#else
+#define VM_CASE(op) case op:
+#define VM_DISPATCH() goto dispatch
+#endif
+
+// Run function 'function_index' with the given arguments and return its
+// result. When 'label_table' is non-NULL only the handler table is returned.
+int32_t vm_execute(VM* vm, size_t function_index, const int32_t* args, size_t arg_count, const void*** label_table) {
+#ifdef VM_THREADED
+    static const void* labels[OP_COUNT] = {
+        &&L_OP_PUSH_CONST, &&L_OP_LOAD, &&L_OP_STORE, &&L_OP_ADD, &&L_OP_SUB, &&L_OP_MUL, &&L_OP_DIV,
+        &&L_OP_LT, &&L_OP_GT, &&L_OP_JUMP, &&L_OP_JUMP_IF_FALSE, &&L_OP_CALL, &&L_OP_TAIL_CALL,
+        &&L_OP_PRINT, &&L_OP_POP, &&L_OP_RETURN, &&L_OP_HALT
+    };
+    if (label_table) {
+        *label_table = labels;
+        return 0;
+    }
+#else
+    if (label_table) {
+        *label_table = NULL;
+        return 0;
+    }
+#endif
+
+    if (function_index >= vm->function_count) vm_error("no such function in module", NULL);
+    ThreadedFunction* function = &vm->functions[function_index];
+    if (!function->code) thread_function(vm, function_index, vm->labels);
+    if (arg_count != function->arg_count) vm_error("wrong number of arguments to", function->name);
+    if ((size_t)function->local_count + function->max_stack > (size_t)(vm->stack_end - vm->stack)) vm_error("operand stack overflow in", function->name);
+
+    int32_t* sp = vm->stack;
+    for (size_t i = 0; i < arg_count; i++) *sp++ = args[i];
+    for (size_t i = arg_count; i < function->local_count; i++) *sp++ = 0;
+
+    VMFrame* frame = &vm->frames[0];
+    frame->function = function;
+    frame->return_ip = NULL;
+    frame->locals = vm->stack;
+    vm->frame_count = 1;
+
+    int32_t* locals = frame->locals;
+    ThreadedInstruction* ip = function->code;
+
+#ifdef VM_THREADED
+    VM_DISPATCH();
+#else
+dispatch:
+    switch ((OpCode)(intptr_t)ip->handler) {
+#endif
+
+    VM_CASE(OP_PUSH_CONST)
+        *sp++ = ip->a;
+        ip++;
+        VM_DISPATCH();
+
+    VM_CASE(OP_LOAD)
+        *sp++ = locals[ip->a];
+        ip++;
+        VM_DISPATCH();
+
+    VM_CASE(OP_STORE)
+        locals[ip->a] = *--sp;
+        ip++;
+        VM_DISPATCH();
+
+    VM_CASE(OP_ADD)
+        sp[-2] = (int32_t)((uint32_t)sp[-2] + (uint32_t)sp[-1]);
+        sp--;
+        ip++;
+        VM_DISPATCH();
+
+    VM_CASE(OP_SUB)
+        sp[-2] = (int32_t)((uint32_t)sp[-2] - (uint32_t)sp[-1]);
+        sp--;
+        ip++;
+        VM_DISPATCH();
+
+    VM_CASE(OP_MUL)
+        sp[-2] = (int32_t)((uint32_t)sp[-2] * (uint32_t)sp[-1]);
+        sp--;
+        ip++;
+        VM_DISPATCH();
+
+    VM_CASE(OP_DIV)
+        if (sp[-1] == 0) vm_error("division by zero in", frame->function->name);
+        // INT32_MIN / -1 wraps like the other operators instead of trapping
+        sp[-2] = sp[-1] == -1 ? (int32_t)(0u - (uint32_t)sp[-2]) : sp[-2] / sp[-1];
+        sp--;
+        ip++;
+        VM_DISPATCH();
+
+    VM_CASE(OP_LT)
+        sp[-2] = sp[-2] < sp[-1];
+        sp--;
+        ip++;
+        VM_DISPATCH();
+
+    VM_CASE(OP_GT)
+        sp[-2] = sp[-2] > sp[-1];
+        sp--;
+        ip++;
+        VM_DISPATCH();
+
+    VM_CASE(OP_JUMP)
+        ip = frame->function->code + ip->a;
+        VM_DISPATCH();
+
+    VM_CASE(OP_JUMP_IF_FALSE)
+        if (*--sp == 0) {
+            ip = frame->function->code + ip->a;
+        } else {
+            ip++;
+        }
+        VM_DISPATCH();
+
+    VM_CASE(OP_CALL) {
+        if (ip->a < 0) vm_error("undefined function", vm_symbol_name(vm, (uint16_t)ip->b));
+        ThreadedFunction* callee = &vm->functions[ip->a];
+        if (!callee->code) thread_function(vm, ip->a, vm->labels);
+        if ((size_t)ip->b != callee->arg_count) vm_error("wrong number of arguments to", callee->name);
+        if (vm->frame_count >= VM_MAX_FRAMES) vm_error("call stack overflow in", callee->name);
+        // Arguments already on the stack become the callee's first locals
+        int32_t* callee_locals = sp - ip->b;
+        if ((size_t)(vm->stack_end - callee_locals) < (size_t)callee->local_count + callee->max_stack) vm_error("operand stack overflow in", callee->name);
+        for (size_t i = callee->arg_count; i < callee->local_count; i++) *sp++ = 0;
+
+        frame = &vm->frames[vm->frame_count++];
+        frame->function = callee;
+        frame->return_ip = ip + 1;
+        frame->locals = callee_locals;
+        locals = callee_locals;
+        ip = callee->code;
+        VM_DISPATCH();
+    }
+
+    VM_CASE(OP_TAIL_CALL) {
+        if (ip->a < 0) vm_error("undefined function", vm_symbol_name(vm, (uint16_t)ip->b));
+        ThreadedFunction* callee = &vm->functions[ip->a];
+        if (!callee->code) thread_function(vm, ip->a, vm->labels);
+        if ((size_t)ip->b != callee->arg_count) vm_error("wrong number of arguments to", callee->name);
+        if ((size_t)(vm->stack_end - locals) < (size_t)callee->local_count + callee->max_stack) vm_error("operand stack overflow in", callee->name);
+
+        // Slide the new arguments over the current frame and restart
+        memmove(locals, sp - ip->b, sizeof(int32_t) * ip->b);
+        sp = locals + ip->b;
+        for (size_t i = callee->arg_count; i < callee->local_count; i++) *sp++ = 0;
+
+        frame->function = callee;
+        ip = callee->code;
+        VM_DISPATCH();
+    }
+
+    VM_CASE(OP_PRINT) {
+        int32_t* args_start = sp - ip->a;
+        for (int32_t i = 0; i < ip->a; i++) printf("%d ", args_start[i]);
+        printf("\n");
+        sp = args_start;
+        ip++;
+        VM_DISPATCH();
+    }
+
+    VM_CASE(OP_POP)
+        sp--;
+        ip++;
+        VM_DISPATCH();
+
+    VM_CASE(OP_RETURN) {
+        int32_t result = *--sp;
+        ThreadedInstruction* return_ip = frame->return_ip;
+        sp = frame->locals;
+        if (--vm->frame_count == 0) return result;
+
+        frame = &vm->frames[vm->frame_count - 1];
+        locals = frame->locals;
+        *sp++ = result;
+        ip = return_ip;
+        VM_DISPATCH();
+    }
+
+    VM_CASE(OP_HALT)
+        vm->frame_count = 0;
+        return 0;
+
+#ifndef VM_THREADED
+    default:
+        vm_error("invalid opcode", NULL);
+    }
+#endif
+    return 0;
+}
+
+// Compile and run a parsed program on the VM
+int vm_run_program(ASTNode* root) {
+    CodeModule* module = compile_module(root);
+    VM* vm = create_vm(module);
+    int32_t result = vm_execute(vm, 0, NULL, 0, NULL);
+    free_vm(vm);
+    free_code_module(module);
+    return result;
+}
+
+int main() {
+    const char* source_code =
+        "function sum(n, acc) { if (n < 1) { return acc; } return sum(n - 1, acc + n); }"
+        "i = 0; total = 0;"
+        "while (i < 1000000) { total = total + i * 2; i = i + 1; }"
+        "print(total, sum(100000, 0));";
+    Lexer* lexer = create_lexer(source_code);
+    Parser* parser = create_parser(lexer);
+
+    ASTNode* root = parse_block(parser);
+    mark_program_tail_calls(root);
+    return vm_run_program(root);
+}